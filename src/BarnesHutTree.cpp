@@ -0,0 +1,433 @@
+/**
+ * Purpose: Implement the methods of the BarnesHutTree class that are declared in the BarnesHutTree.hpp header file.
+ *  The positions are mapped to a 65536 x 65536 grid over the bounding square of the bodies, so a Morton code has 32 bits
+ *  and the tree has at most 16 levels; a cell of the last level stays a leaf however many bodies it holds.
+ *  The codes are sorted with a radix sort (4 passes of 8 bits), which is linear in the number of bodies.
+ *  The cells of a subtree are built in a vector of its own, with indices from its start, so the threads don't share a vector.
+ *  A cell is opened when the body is closer than size / theta + offset to its center of mass: the offset (Barnes' "bmax" rule)
+ *  avoids the large errors of the plain size / distance test when the mass of a big cell sits in one of its corners.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include "BarnesHutTree.hpp"
+
+// Largest number of bodies of a leaf. Below this the direct sum is faster than opening more cells
+static const std::uint32_t leafSize = 8;
+// Number of levels of the tree, one per pair of bits of a Morton code
+static const int maxLevel = 16;
+// Smallest number of bodies given to one thread
+static const std::size_t minBodiesPerChunk = 256;
+// Number of subtrees per thread the first levels are split into, so a thread that finishes early can take another one,
+// and the smallest number of bodies of a subtree, below which splitting more costs more than it saves
+static const std::size_t subtreesPerThread = 8;
+static const std::size_t minBodiesPerSubtree = 2048;
+
+// Function to spread the 16 bits of a coordinate to the even bits of a 32-bit code
+static std::uint32_t spreadBits(std::uint32_t value) {
+    value &= 0xFFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+void BarnesHutTree::build(const double* x, const double* y, const float* mass, std::size_t count, ThreadPool& pool) {
+    nodes.clear();
+    if (count == 0) {
+        return;
+    }
+
+    // Bounding square of the bodies
+    double minX = std::numeric_limits<double>::infinity(), minY = minX, maxX = -minX, maxY = -minX;
+    std::mutex merge;
+    pool.parallelFor(count, minBodiesPerChunk * 8, [&](std::size_t begin, std::size_t end) {
+        double chunkMinX = std::numeric_limits<double>::infinity(), chunkMinY = chunkMinX, chunkMaxX = -chunkMinX, chunkMaxY = -chunkMinX;
+        for (std::size_t i = begin; i < end; ++i) {
+            chunkMinX = std::min(chunkMinX, x[i]);
+            chunkMaxX = std::max(chunkMaxX, x[i]);
+            chunkMinY = std::min(chunkMinY, y[i]);
+            chunkMaxY = std::max(chunkMaxY, y[i]);
+        }
+        std::lock_guard<std::mutex> lock(merge);
+        minX = std::min(minX, chunkMinX);
+        maxX = std::max(maxX, chunkMaxX);
+        minY = std::min(minY, chunkMinY);
+        maxY = std::max(maxY, chunkMaxY);
+    });
+    double extent = std::max({maxX - minX, maxY - minY, 1e-6}) * 1.0001; // A little larger, so the last body maps below 65536
+    double scale = 65536.0 / extent;
+
+    // Morton code of every body, in parallel
+    keys.resize(count);
+    order.resize(count);
+    pool.parallelFor(count, minBodiesPerChunk * 8, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::uint32_t cellX = static_cast<std::uint32_t>(std::min((x[i] - minX) * scale, 65535.0));
+            std::uint32_t cellY = static_cast<std::uint32_t>(std::min((y[i] - minY) * scale, 65535.0));
+            keys[i] = spreadBits(cellX) | (spreadBits(cellY) << 1);
+            order[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+
+    sortKeys(count, pool);
+
+    // Copy the bodies in the sorted order, so the leaves read consecutive memory
+    sortedX.resize(count);
+    sortedY.resize(count);
+    sortedMass.resize(count);
+    pool.parallelFor(count, minBodiesPerChunk * 8, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            sortedX[k] = x[order[k]];
+            sortedY[k] = y[order[k]];
+            sortedMass[k] = mass[order[k]];
+        }
+    });
+
+    // Cells: the first levels on this thread until there are about subtreesPerThread cells per thread, their subtrees on all threads.
+    // With one thread, or too few bodies to split, the whole tree is built in place
+    std::uint32_t grain = static_cast<std::uint32_t>(std::max(count / (pool.getThreadCount() * subtreesPerThread), minBodiesPerSubtree));
+    if (pool.getThreadCount() == 1 || count <= grain) {
+        buildNode(nodes, 0, static_cast<std::uint32_t>(count), 0, minX, minY, extent);
+        return;
+    }
+    topCells.clear();
+    splitTop(0, static_cast<std::uint32_t>(count), 0, minX, minY, extent, grain);
+    std::vector<std::size_t> pending; // Cells built with their subtree
+    for (std::size_t c = 0; c < topCells.size(); ++c) {
+        if (topCells[c].children == 0) {
+            topCells[c].subtree = pending.size();
+            pending.push_back(c);
+        }
+    }
+    if (subtrees.size() < pending.size()) {
+        subtrees.resize(pending.size());
+    }
+    pool.parallelFor(pending.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            const TopCell& cell = topCells[pending[p]];
+            subtrees[p].clear();
+            buildNode(subtrees[p], cell.begin, cell.end, cell.level, cell.left, cell.top, cell.size);
+        }
+    });
+    std::size_t next = 0;
+    placeTop(next);
+    // Copy the subtrees to their place, moving their indices by the index of their first cell
+    pool.parallelFor(pending.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; ++p) {
+            std::uint32_t base = topCells[pending[p]].base;
+            for (std::size_t k = 0; k < subtrees[p].size(); ++k) {
+                Node& node = nodes[base + k];
+                node = subtrees[p][k];
+                node.next += base;
+            }
+        }
+    });
+}
+
+/**
+ * This function sorts the codes with a radix sort, 8 bits per pass. The bodies are cut into chunks: every chunk counts its bytes in parallel,
+ * then the counts are turned into the place where each chunk writes each byte (all chunks for byte 0 first, in the order of the chunks,
+ * so the sort stays stable), and every chunk moves its bodies in parallel. A pass where all bodies have the same byte is skipped.
+ *
+ * */
+void BarnesHutTree::sortKeys(std::size_t count, ThreadPool& pool) {
+    scratchKeys.resize(count);
+    scratchOrder.resize(count);
+    std::size_t chunks = std::max<std::size_t>(1, std::min(pool.getThreadCount() * 4, count / (minBodiesPerChunk * 8)));
+    std::size_t chunkLength = (count + chunks - 1) / chunks;
+    histograms.resize(chunks * 256);
+    for (int shift = 0; shift < 32; shift += 8) {
+        pool.parallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; ++c) {
+                std::size_t* counts = &histograms[c * 256];
+                std::fill(counts, counts + 256, 0);
+                for (std::size_t i = c * chunkLength; i < std::min(count, (c + 1) * chunkLength); ++i) {
+                    ++counts[(keys[i] >> shift) & 0xFF];
+                }
+            }
+        });
+        std::uint32_t firstByte = (keys[0] >> shift) & 0xFF;
+        std::size_t same = 0;
+        for (std::size_t c = 0; c < chunks; ++c) {
+            same += histograms[c * 256 + firstByte];
+        }
+        if (same == count) {
+            continue;
+        }
+        std::size_t slot = 0;
+        for (std::size_t b = 0; b < 256; ++b) {
+            for (std::size_t c = 0; c < chunks; ++c) {
+                std::size_t bodies = histograms[c * 256 + b];
+                histograms[c * 256 + b] = slot;
+                slot += bodies;
+            }
+        }
+        pool.parallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; ++c) {
+                std::size_t* slots = &histograms[c * 256];
+                for (std::size_t i = c * chunkLength; i < std::min(count, (c + 1) * chunkLength); ++i) {
+                    std::size_t slot = slots[(keys[i] >> shift) & 0xFF]++;
+                    scratchKeys[slot] = keys[i];
+                    scratchOrder[slot] = order[i];
+                }
+            }
+        });
+        keys.swap(scratchKeys);
+        order.swap(scratchOrder);
+    }
+}
+
+// The codes of a cell are sorted and share their first bits, so the bodies of each quarter are a consecutive range, found with a binary search on the next two bits
+void BarnesHutTree::splitQuarters(std::uint32_t begin, std::uint32_t end, int level, std::uint32_t stops[4]) const {
+    int shift = 2 * (maxLevel - 1 - level); // Position of the two bits that choose the quarter at this level
+    std::uint32_t start = begin;
+    for (std::uint32_t quarter = 0; quarter < 3; ++quarter) {
+        start = static_cast<std::uint32_t>(std::partition_point(keys.begin() + start, keys.begin() + end, [shift, quarter](std::uint32_t key) {
+            return ((key >> shift) & 3) <= quarter;
+        }) - keys.begin());
+        stops[quarter] = start;
+    }
+    stops[3] = end;
+}
+
+void BarnesHutTree::splitTop(std::uint32_t begin, std::uint32_t end, int level, double left, double top, double size, std::uint32_t grain) {
+    std::size_t index = topCells.size();
+    topCells.emplace_back();
+    TopCell cell;
+    cell.begin = begin;
+    cell.end = end;
+    cell.level = level;
+    cell.left = left;
+    cell.top = top;
+    cell.size = size;
+    if (end - begin > std::max(grain, leafSize) && level < maxLevel) {
+        std::uint32_t stops[4];
+        splitQuarters(begin, end, level, stops);
+        double half = size / 2;
+        std::uint32_t start = begin;
+        for (std::uint32_t quarter = 0; quarter < 4; ++quarter) {
+            if (stops[quarter] > start) {
+                // Bit 0 of the quarter is the x bit, bit 1 the y bit (see spreadBits)
+                splitTop(start, stops[quarter], level + 1, left + (quarter & 1) * half, top + (quarter >> 1) * half, half, grain);
+                ++cell.children;
+            }
+            start = stops[quarter];
+        }
+    }
+    topCells[index] = cell; // Set last: the vector grows while the quarters are split
+}
+
+/**
+ * This function gives the top cell at index cell, and the cells after it that belong to it, their place in nodes, in the same depth-first order
+ * as buildNode. A subtree only gets room for its cells (filled by build) and its first cell, whose mass its parent needs.
+ * The index cell is moved past the cells that were placed, and the index of the cell in nodes is returned.
+ *
+ * */
+std::uint32_t BarnesHutTree::placeTop(std::size_t& cell) {
+    TopCell& top = topCells[cell++]; // topCells doesn't grow here, so the reference stays valid
+    std::uint32_t index = static_cast<std::uint32_t>(nodes.size());
+    top.base = index;
+    if (top.children == 0) {
+        const std::vector<Node>& subtree = subtrees[top.subtree];
+        nodes.resize(nodes.size() + subtree.size());
+        nodes[index] = subtree.front();
+        nodes[index].next += index;
+        return index;
+    }
+    nodes.emplace_back();
+    double mass = 0.0, momentX = 0.0, momentY = 0.0;
+    for (int c = 0; c < top.children; ++c) {
+        std::uint32_t child = placeTop(cell);
+        mass += nodes[child].mass;
+        momentX += nodes[child].mass * nodes[child].centerX;
+        momentY += nodes[child].mass * nodes[child].centerY;
+    }
+    finishNode(nodes[index], mass, momentX, momentY, top.left, top.top, top.size);
+    nodes[index].next = static_cast<std::uint32_t>(nodes.size());
+    return index;
+}
+
+/**
+ * This function creates a cell and, unless it is a leaf, its four quarters.
+ * The mass and the center of mass are summed from the children once they are built.
+ *
+ * */
+void BarnesHutTree::buildNode(std::vector<Node>& out, std::uint32_t begin, std::uint32_t end, int level, double left, double top, double size) const {
+    std::size_t index = out.size();
+    out.emplace_back(); // No reference is kept: the vector grows while the children are built
+    double mass = 0.0, momentX = 0.0, momentY = 0.0;
+
+    if (end - begin <= leafSize || level == maxLevel) {
+        for (std::uint32_t k = begin; k < end; ++k) {
+            mass += sortedMass[k];
+            momentX += static_cast<double>(sortedMass[k]) * sortedX[k];
+            momentY += static_cast<double>(sortedMass[k]) * sortedY[k];
+        }
+        out[index].leaf = true;
+        out[index].first = begin;
+        out[index].last = end;
+    } else {
+        std::uint32_t stops[4];
+        splitQuarters(begin, end, level, stops);
+        double half = size / 2;
+        std::uint32_t start = begin;
+        for (std::uint32_t quarter = 0; quarter < 4; ++quarter) {
+            if (stops[quarter] > start) {
+                std::size_t child = out.size();
+                buildNode(out, start, stops[quarter], level + 1, left + (quarter & 1) * half, top + (quarter >> 1) * half, half);
+                mass += out[child].mass;
+                momentX += out[child].mass * out[child].centerX;
+                momentY += out[child].mass * out[child].centerY;
+            }
+            start = stops[quarter];
+        }
+    }
+    finishNode(out[index], mass, momentX, momentY, left, top, size);
+    out[index].next = static_cast<std::uint32_t>(out.size());
+}
+
+void BarnesHutTree::finishNode(Node& node, double mass, double momentX, double momentY, double left, double top, double size) {
+    node.mass = mass;
+    node.size = size;
+    if (mass > 0.0) {
+        node.centerX = momentX / mass;
+        node.centerY = momentY / mass;
+    } else {
+        node.centerX = left + size / 2;
+        node.centerY = top + size / 2;
+    }
+    node.offset = std::hypot(node.centerX - (left + size / 2), node.centerY - (top + size / 2));
+}
+
+/**
+ * This function walks the tree for the body at sorted position k, without a stack: a cell is skipped (node.next) when it is far enough
+ * or without mass, and opened (index + 1) otherwise. interact(mass, dx, dy, d2) is called for every body of an opened leaf
+ * and for every cell far enough, with the offset to it and the squared distance.
+ *
+ * */
+template <typename Interaction>
+void BarnesHutTree::walk(std::size_t k, double inverseTheta, Interaction&& interact) const {
+    double px = sortedX[k];
+    double py = sortedY[k];
+    std::uint32_t nodeCount = static_cast<std::uint32_t>(nodes.size());
+    std::uint32_t i = 0;
+    while (i < nodeCount) {
+        const Node& node = nodes[i];
+        if (node.mass == 0.0) {
+            i = node.next;
+            continue;
+        }
+        if (node.leaf) {
+            for (std::uint32_t b = node.first; b < node.last; ++b) {
+                double dx = sortedX[b] - px;
+                double dy = sortedY[b] - py;
+                double d2 = dx * dx + dy * dy;
+                if (b != k) { // No force of a body on itself
+                    interact(sortedMass[b], dx, dy, d2);
+                }
+            }
+            i = node.next;
+            continue;
+        }
+        double dx = node.centerX - px;
+        double dy = node.centerY - py;
+        double d2 = dx * dx + dy * dy;
+        double open = node.size * inverseTheta + node.offset;
+        if (d2 > open * open) {
+            interact(node.mass, dx, dy, d2); // Far enough: the whole cell acts like one body at its center of mass
+            i = node.next;
+        } else {
+            i = i + 1; // Open the cell: its first child follows it
+        }
+    }
+}
+
+// The bodies are walked in the sorted order: neighbouring bodies open the same cells, so the cells stay in the cache
+void BarnesHutTree::accelerations(double* ax, double* ay, float theta, float softening, double gravity, ThreadPool& pool) const {
+    if (nodes.empty()) {
+        return;
+    }
+    double inverseTheta = theta > 0.0f ? 1.0 / theta : std::numeric_limits<double>::infinity();
+    double softening2 = static_cast<double>(softening) * softening;
+    pool.parallelFor(sortedX.size(), minBodiesPerChunk, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            double sumX = 0.0;
+            double sumY = 0.0;
+            walk(k, inverseTheta, [&sumX, &sumY, softening2](double mass, double dx, double dy, double d2) {
+                double d2Soft = d2 + softening2;
+                if (d2Soft > 0.0) { // Two bodies at the same place without softening don't pull on each other
+                    double inverse = 1.0 / std::sqrt(d2Soft);
+                    double strength = mass * inverse * inverse * inverse;
+                    sumX += dx * strength;
+                    sumY += dy * strength;
+                }
+            });
+            ax[order[k]] = gravity * sumX;
+            ay[order[k]] = gravity * sumY;
+        }
+    });
+}
+
+/**
+ * This function adds up m_i * phi_i / 2 over all bodies, where phi_i = -G * sum of m_j / sqrt(d^2 + softening^2) is the softened potential
+ * that matches the softened force. The sum of each chunk is kept in double, so a large catalog doesn't lose the small terms.
+ *
+ * */
+double BarnesHutTree::potentialEnergy(float theta, float softening, double gravity, ThreadPool& pool) const {
+    if (nodes.empty()) {
+        return 0.0;
+    }
+    double inverseTheta = theta > 0.0f ? 1.0 / theta : std::numeric_limits<double>::infinity();
+    double softening2 = static_cast<double>(softening) * softening;
+    double total = 0.0;
+    std::mutex merge;
+    pool.parallelFor(sortedX.size(), minBodiesPerChunk, [&](std::size_t begin, std::size_t end) {
+        double chunk = 0.0;
+        for (std::size_t k = begin; k < end; ++k) {
+            if (sortedMass[k] == 0.0f) {
+                continue; // A body without mass has no energy
+            }
+            double potential = 0.0;
+            walk(k, inverseTheta, [&potential, softening2](double mass, double, double, double d2) {
+                double d2Soft = d2 + softening2;
+                if (d2Soft > 0.0) {
+                    potential += mass / std::sqrt(d2Soft);
+                }
+            });
+            chunk += sortedMass[k] * potential;
+        }
+        std::lock_guard<std::mutex> lock(merge);
+        total += chunk;
+    });
+    return -0.5 * gravity * total;
+}
+
+void BarnesHutTree::directAccelerations(const double* x, const double* y, const float* mass, std::size_t count, std::size_t begin, std::size_t end,
+                                        double* ax, double* ay, float softening, double gravity, ThreadPool& pool) {
+    double softening2 = static_cast<double>(softening) * softening;
+    pool.parallelFor(end - begin, minBodiesPerChunk / 8, [&](std::size_t chunkBegin, std::size_t chunkEnd) {
+        for (std::size_t i = begin + chunkBegin; i < begin + chunkEnd; ++i) {
+            double sumX = 0.0;
+            double sumY = 0.0;
+            for (std::size_t j = 0; j < count; ++j) {
+                double dx = x[j] - x[i];
+                double dy = y[j] - y[i];
+                double d2 = dx * dx + dy * dy + softening2;
+                if (j == i || d2 == 0.0) {
+                    continue;
+                }
+                double inverse = 1.0 / std::sqrt(d2);
+                double strength = mass[j] * inverse * inverse * inverse;
+                sumX += dx * strength;
+                sumY += dy * strength;
+            }
+            ax[i] = gravity * sumX;
+            ay[i] = gravity * sumY;
+        }
+    });
+}
@@ -0,0 +1,100 @@
+/**
+ * This class calculates the gravitational accelerations of many bodies with the Barnes-Hut approximation, in O(N log N) instead of O(N^2).
+ * The bodies are put into a quadtree: every cell is split into four quarters until a cell holds at most a few bodies.
+ * A cell that is far enough from a body, compared to its size, acts on it like one body at its center of mass;
+ * the opening angle theta sets how far "far enough" is (0 gives the exact sum, 0.5 to 1 are usual values).
+ *
+ * The tree is rebuilt at every step, which is cheaper than updating it when every body moves:
+ * the bodies are sorted by the Morton code of their cell (the bits of x and y interleaved, so the bodies of a cell are consecutive),
+ * and the cells are created from the sorted codes in depth-first order. Each cell stores the index of the cell after its subtree,
+ * so the tree is walked with a loop and no stack. Every part of the build runs in parallel on a ThreadPool: the codes, the radix sort
+ * (each thread counts and moves its own chunk of the bodies) and the cells (the first levels are split on one thread, and their subtrees are
+ * built by the threads side by side, then copied to their place). The accelerations are calculated in parallel too.
+ *
+ */
+
+#ifndef BARNESHUTTREE_HPP
+#define BARNESHUTTREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.hpp"
+
+class BarnesHutTree {
+public:
+    // Function to build the tree over count bodies. The arrays must stay valid until the accelerations are calculated
+    void build(const double* x, const double* y, const float* mass, std::size_t count, ThreadPool& pool);
+
+    // Function to calculate the acceleration of every body from all others, a = G * m * d / (|d|^2 + softening^2)^(3/2).
+    // The softening keeps the force finite when two bodies come very close.
+    void accelerations(double* ax, double* ay, float theta, float softening, double gravity, ThreadPool& pool) const;
+
+    // Function to calculate the potential energy of the bodies, with the same softening as the force. Used to check the energy of the N-body mode
+    double potentialEnergy(float theta, float softening, double gravity, ThreadPool& pool) const;
+
+    // Function to calculate the same accelerations by summing over every pair, for the bodies [begin, end) only. Used to measure the error of the tree
+    static void directAccelerations(const double* x, const double* y, const float* mass, std::size_t count, std::size_t begin, std::size_t end,
+                                    double* ax, double* ay, float softening, double gravity, ThreadPool& pool);
+
+    std::size_t getNodeCount() const { return nodes.size(); } // Number of cells of the last build
+
+private:
+    // One cell of the tree. The children of a cell follow it directly, the first one at index + 1.
+    // Everything is in double, like the positions: in float the corners of the small cells far from the origin would be rounded by more than the cells themselves
+    struct Node {
+        double centerX = 0.0; // Center of mass
+        double centerY = 0.0;
+        double mass = 0.0;
+        double size = 0.0; // Side of the cell
+        double offset = 0.0; // Distance from the center of mass to the center of the cell
+        std::uint32_t next = 0; // Index of the cell after the subtree of this one
+        std::uint32_t first = 0; // Bodies of a leaf, in the sorted order: [first, last)
+        std::uint32_t last = 0;
+        bool leaf = false;
+    };
+
+    // Cell of the first levels of the tree, split on one thread. A cell holding few enough bodies is built with its subtree by one thread
+    struct TopCell {
+        std::uint32_t begin = 0; // Sorted bodies of the cell
+        std::uint32_t end = 0;
+        int level = 0;
+        double left = 0.0; // Corner and side of the cell
+        double top = 0.0;
+        double size = 0.0;
+        int children = 0; // Number of cells following this one that are its quarters, 0 for a subtree
+        std::size_t subtree = 0; // Index of its cells in subtrees
+        std::uint32_t base = 0; // Index of its first cell in nodes
+    };
+
+    // Function to sort the codes and the body indices by code, in parallel
+    void sortKeys(std::size_t count, ThreadPool& pool);
+    // Function to find the sorted bodies of the four quarters of a cell: quarter q holds [stops[q - 1], stops[q]), with stops[-1] = begin
+    void splitQuarters(std::uint32_t begin, std::uint32_t end, int level, std::uint32_t stops[4]) const;
+    // Function to list the cells of the first levels, in depth-first order, until the cells hold at most grain bodies
+    void splitTop(std::uint32_t begin, std::uint32_t end, int level, double left, double top, double size, std::uint32_t grain);
+    // Function to give the cells of the first levels their place in nodes, and sum their mass from their children, see BarnesHutTree.cpp
+    std::uint32_t placeTop(std::size_t& cell);
+    // Function to create the cell of the sorted bodies [begin, end), whose codes share their first 2 * level bits, and its subtree in out.
+    // The indices of next are relative to the start of out
+    void buildNode(std::vector<Node>& out, std::uint32_t begin, std::uint32_t end, int level, double left, double top, double size) const;
+    // Function to set the mass, the center of mass and the geometry of a cell
+    static void finishNode(Node& node, double mass, double momentX, double momentY, double left, double top, double size);
+    // Function to visit the bodies and cells that act on the sorted body k, see BarnesHutTree.cpp
+    template <typename Interaction>
+    void walk(std::size_t k, double inverseTheta, Interaction&& interact) const;
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> keys; // Morton code of every body, sorted
+    std::vector<std::uint32_t> order; // Index of the body of every sorted position
+    std::vector<std::uint32_t> scratchKeys; // Second buffers of the radix sort
+    std::vector<std::uint32_t> scratchOrder;
+    std::vector<std::size_t> histograms; // Counts of every byte in every chunk of the radix sort, then where the chunk writes them
+    std::vector<TopCell> topCells; // First levels of the last build, in depth-first order
+    std::vector<std::vector<Node>> subtrees; // Cells built by the threads, kept so the next build reuses their memory
+    std::vector<double> sortedX; // Positions and masses in the sorted order, read by the leaves. The positions stay in double, so two close bodies
+    std::vector<double> sortedY; // far from the origin still pull on each other with the right direction
+    std::vector<float> sortedMass;
+};
+
+#endif
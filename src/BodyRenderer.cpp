@@ -0,0 +1,278 @@
+/**
+ * Purpose: Implement the methods of the BodyRenderer class that are declared in the BodyRenderer.hpp header file.
+ *  A circle is drawn as "segments" triangles that share the center of the body, like a triangle fan.
+ *  sf::TriangleFan can't hold several bodies in one vertex array, so the triangles are stored as a list (sf::Triangles).
+ *  The points and texture coordinates follow sf::CircleShape: the first point is at the top, the texture rectangle covers the bounding box,
+ *  and the color is multiplied with the texture.
+ *  A point has no texture: it takes the color of the body multiplied with the average color of its texture.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include "BodyRenderer.hpp"
+#include "Log.hpp"
+
+// Largest distance in pixels between the outline of a drawn circle and a true circle
+static const float outlineTolerance = 0.25f;
+// Fewest triangles of a circle: a hexagon is already round at the size where it is used
+static const std::size_t minSegments = 6;
+// Radius in pixels below which a body is drawn as one point
+static const float pointRadius = 0.5f;
+// Radius in pixels below which a body shares its pixel: only the first small body on a pixel is drawn, with the color of all of them
+static const float impostorRadius = 1.5f;
+// Pixel of a body outside the target
+static const std::size_t noPixel = static_cast<std::size_t>(-1);
+
+// The unit circles of every number of triangles up to "segments" are calculated once
+BodyRenderer::BodyRenderer(std::size_t segments) : segments(std::max<std::size_t>(segments, minSegments)) {
+    const float pi = 3.14159265358979f;
+    unitCos.resize(this->segments + 1);
+    unitSin.resize(this->segments + 1);
+    for (std::size_t n = minSegments; n <= this->segments; ++n) {
+        for (std::size_t k = 0; k <= n; ++k) {
+            float angle = k * 2 * pi / n - pi / 2; // Same points as sf::CircleShape, starting at the top
+            unitCos[n].push_back(std::cos(angle));
+            unitSin[n].push_back(std::sin(angle));
+        }
+    }
+}
+
+/**
+ * This function chooses the number of triangles of a circle. A chord of angle a is r * (1 - cos(a / 2)) away from the circle,
+ * so n = pi / acos(1 - tolerance / r) triangles keep the outline within the tolerance.
+ *
+ * */
+std::size_t BodyRenderer::segmentsFor(float screenRadius) const {
+    if (screenRadius <= outlineTolerance * 2) {
+        return minSegments;
+    }
+    float needed = 3.14159265f / std::acos(1.0f - outlineTolerance / screenRadius);
+    if (!(needed < static_cast<float>(segments))) {
+        return segments;
+    }
+    return std::max(minSegments, static_cast<std::size_t>(std::ceil(needed)));
+}
+
+BodyRenderer::Batch& BodyRenderer::batchFor(const sf::Texture* texture) {
+    for (auto& batch : batches) {
+        if (batch.texture == texture) {
+            return batch;
+        }
+    }
+    batches.emplace_back();
+    batches.back().texture = texture;
+    return batches.back();
+}
+
+// Function to append the triangles of one body to a batch. The rotation is in degrees, like sf::Transformable::setRotation.
+void BodyRenderer::appendCircle(Batch& batch, std::size_t count, float x, float y, float radius, float rotation, sf::Color color,
+                                const sf::FloatRect& textureRect) {
+    std::size_t needed = batch.used + count * 3;
+    if (batch.vertices.getVertexCount() < needed) {
+        batch.vertices.resize(needed * 2); // Grow with room to spare, so the array is rarely resized
+    }
+
+    // Rotate the unit circle once per body instead of once per point
+    float radians = rotation * 3.14159265358979f / 180.0f;
+    float rotationCos = std::cos(radians) * radius;
+    float rotationSin = std::sin(radians) * radius;
+
+    float textureCenterX = textureRect.left + textureRect.width / 2;
+    float textureCenterY = textureRect.top + textureRect.height / 2;
+    float textureHalfWidth = textureRect.width / 2;
+    float textureHalfHeight = textureRect.height / 2;
+
+    sf::Vertex center(sf::Vector2f(x, y), color, sf::Vector2f(textureCenterX, textureCenterY));
+    const std::vector<float>& circleCos = unitCos[count];
+    const std::vector<float>& circleSin = unitSin[count];
+    sf::Vertex* out = &batch.vertices[batch.used];
+    for (std::size_t k = 0; k < count; ++k) {
+        const float c0 = circleCos[k], s0 = circleSin[k], c1 = circleCos[k + 1], s1 = circleSin[k + 1];
+        out[0] = center;
+        out[1] = sf::Vertex(sf::Vector2f(x + c0 * rotationCos - s0 * rotationSin, y + c0 * rotationSin + s0 * rotationCos), color,
+                            sf::Vector2f(textureCenterX + c0 * textureHalfWidth, textureCenterY + s0 * textureHalfHeight));
+        out[2] = sf::Vertex(sf::Vector2f(x + c1 * rotationCos - s1 * rotationSin, y + c1 * rotationSin + s1 * rotationCos), color,
+                            sf::Vector2f(textureCenterX + c1 * textureHalfWidth, textureCenterY + s1 * textureHalfHeight));
+        out += 3;
+    }
+    batch.used = needed;
+}
+
+void BodyRenderer::appendPoint(float x, float y, sf::Color color) {
+    if (points.vertices.getVertexCount() <= points.used) {
+        points.vertices.resize((points.used + 1) * 2);
+    }
+    points.vertices[points.used++] = sf::Vertex(sf::Vector2f(x, y), color);
+}
+
+// Function to map the position of a small body to its pixel on the target
+std::size_t BodyRenderer::pixelOf(const sf::Transform& transform, const sf::IntRect& viewport, float x, float y) const {
+    sf::Vector2f normalized = transform.transformPoint(x, y); // From -1 to 1 over the view, y pointing up
+    float pixelX = (normalized.x + 1.0f) / 2.0f * viewport.width + viewport.left;
+    float pixelY = (1.0f - normalized.y) / 2.0f * viewport.height + viewport.top;
+    if (!(pixelX >= 0.0f && pixelY >= 0.0f && pixelX < static_cast<float>(pixelWidth) && pixelY < static_cast<float>(pixelHeight))) {
+        return noPixel;
+    }
+    return static_cast<std::size_t>(pixelY) * pixelWidth + static_cast<std::size_t>(pixelX);
+}
+
+/**
+ * This function colors the drawn body of every group of small bodies with the light of the whole group.
+ * A point adds the colors of its bodies, clamped to 255: many faint asteroids on one pixel look like one brighter star.
+ * A small circle covers its pixel already, it gets the average color of its bodies instead.
+ *
+ * */
+void BodyRenderer::mergeGroups() {
+    for (const auto& group : groups) {
+        if (group.bodies < 2) {
+            continue; // Nothing was merged into this body
+        }
+        sf::Color color;
+        if (group.point) {
+            color = sf::Color(std::min<std::uint32_t>(group.red, 255), std::min<std::uint32_t>(group.green, 255),
+                              std::min<std::uint32_t>(group.blue, 255), std::min<std::uint32_t>(group.alpha, 255));
+        } else {
+            color = sf::Color(group.red / group.bodies, group.green / group.bodies, group.blue / group.bodies, group.alpha / group.bodies);
+        }
+        Batch& batch = group.point ? points : batches[group.batch];
+        for (std::size_t v = group.first; v < group.first + group.count; ++v) {
+            batch.vertices[v].color = color;
+        }
+    }
+}
+
+// Function to get the part of the world shown by a view around an origin. A rotated view shows the bounding box of its rotated rectangle
+static sf::Rect<double> visibleArea(const sf::View& view, sf::Vector2<double> origin) {
+    sf::Vector2f size = view.getSize();
+    float radians = view.getRotation() * 3.14159265358979f / 180.0f;
+    float c = std::abs(std::cos(radians));
+    float s = std::abs(std::sin(radians));
+    float width = size.x * c + size.y * s;
+    float height = size.x * s + size.y * c;
+    return sf::Rect<double>(origin.x + view.getCenter().x - width / 2.0, origin.y + view.getCenter().y - height / 2.0, width, height);
+}
+
+/**
+ * This function builds the vertex arrays of the bodies and draws them, one draw call per batch (and one for the points).
+ * With a grid, only the bodies it finds in the view are visited, in the order of the store, so the bodies that overlap are drawn in the same order as without it.
+ * The vertices beyond "used" are left over from bigger frames; they are not drawn because only the first "used" vertices are passed to draw.
+ *
+ * */
+void BodyRenderer::render(const BodyStore& bodies, sf::RenderTarget& target, float alpha, const SpatialGrid* grid, sf::Vector2<double> origin) {
+    for (auto& batch : batches) {
+        batch.used = 0;
+    }
+    points.used = 0;
+    std::size_t candidates = bodies.size();
+    if (grid) {
+        visible.clear();
+        grid->query(visibleArea(target.getView(), origin), visible);
+        candidates = visible.size();
+    }
+
+    // Scale from the world to the pixels of the target, to know how big a body looks
+    const sf::View& view = target.getView();
+    sf::IntRect viewport = target.getViewport(view);
+    float pixelsPerUnit = std::max(viewport.width / view.getSize().x, viewport.height / view.getSize().y);
+    const sf::Transform& transform = view.getTransform();
+    sf::Vector2u targetSize = target.getSize();
+    if (pixelWidth != targetSize.x || pixelHeight != targetSize.y) {
+        pixelWidth = targetSize.x;
+        pixelHeight = targetSize.y;
+        pixelFrame.assign(pixelWidth * pixelHeight, 0);
+        pixelGroup.assign(pixelWidth * pixelHeight, 0);
+        frame = 0;
+    }
+    if (++frame == 0) {
+        std::fill(pixelFrame.begin(), pixelFrame.end(), 0); // The counter wrapped around, forget the old frames
+        frame = 1;
+    }
+
+    const sf::FloatRect noTexture;
+    Batch* current = nullptr; // Batch of the previous body: consecutive bodies often have the same texture
+    groups.clear();
+    bodyCount = 0;
+    pointCount = 0;
+    mergedCount = 0;
+    for (std::size_t k = 0; k < candidates; ++k) {
+        std::size_t i = grid ? visible[k] : k;
+        if (i >= bodies.size() || !bodies.isAlive(i)) {
+            continue; // Slot of a removed body
+        }
+        // Interpolated in double, then moved to the origin: only the small difference is rounded to float
+        float x = static_cast<float>(bodies.previousX[i] + (bodies.positionX[i] - bodies.previousX[i]) * alpha - origin.x);
+        float y = static_cast<float>(bodies.previousY[i] + (bodies.positionY[i] - bodies.previousY[i]) * alpha - origin.y);
+        float screenRadius = std::abs(bodies.radius[i]) * pixelsPerUnit;
+        ++bodyCount;
+
+        // Small bodies: one per pixel, drawn as a point or a hexagon that stands for the others
+        PixelGroup* group = nullptr;
+        if (screenRadius < impostorRadius) {
+            std::size_t pixel = pixelOf(transform, viewport, x, y);
+            if (pixel == noPixel) {
+                ++mergedCount; // Not visible anyway
+                continue;
+            }
+            if (pixelFrame[pixel] == frame) {
+                PixelGroup& taken = groups[pixelGroup[pixel]];
+                // A point shows the color through the texture, a circle multiplies its own texture with the vertex color
+                sf::Color color = taken.point ? bodies.color[i] * bodies.textures.getAverageColor(bodies.texture[i]) : bodies.color[i];
+                taken.red += color.r;
+                taken.green += color.g;
+                taken.blue += color.b;
+                taken.alpha += color.a;
+                ++taken.bodies;
+                ++mergedCount;
+                continue;
+            }
+            pixelFrame[pixel] = frame;
+            pixelGroup[pixel] = static_cast<std::uint32_t>(groups.size());
+            groups.emplace_back();
+            group = &groups.back();
+        }
+        if (screenRadius < pointRadius) {
+            sf::Color color = bodies.color[i] * bodies.textures.getAverageColor(bodies.texture[i]);
+            if (group) {
+                *group = PixelGroup{0, points.used, 1, true, color.r, color.g, color.b, color.a, 1};
+            }
+            appendPoint(x, y, color);
+            ++pointCount;
+            continue;
+        }
+
+        const sf::Texture* texture = bodies.textures.getTexture(bodies.texture[i]);
+        if (!current || current->texture != texture) {
+            current = &batchFor(texture);
+        }
+        std::size_t count = segmentsFor(screenRadius);
+        if (group) {
+            const sf::Color& color = bodies.color[i];
+            *group = PixelGroup{static_cast<std::size_t>(current - batches.data()), current->used, count * 3, false,
+                                color.r, color.g, color.b, color.a, 1};
+        }
+        appendCircle(*current, count, x, y, bodies.radius[i], bodies.rotation[i], bodies.color[i],
+                     texture ? bodies.textureRect[i] : noTexture);
+    }
+    mergeGroups();
+
+    drawCalls = 0;
+    vertexCount = 0;
+    if (points.used > 0) {
+        target.draw(&points.vertices[0], points.used, sf::Points); // Under the circles, like stars
+        ++drawCalls;
+        vertexCount += points.used;
+    }
+    for (auto& batch : batches) {
+        if (batch.used == 0) {
+            continue;
+        }
+        sf::RenderStates states;
+        states.texture = batch.texture;
+        target.draw(&batch.vertices[0], batch.used, sf::Triangles, states);
+        ++drawCalls;
+        vertexCount += batch.used;
+    }
+    LOG_DEBUG("Drew %zu of %zu bodies (%zu points, %zu merged) with %zu vertices in %zu draw calls",
+              bodyCount, bodies.size(), pointCount, mergedCount, vertexCount, drawCalls);
+}
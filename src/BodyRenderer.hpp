@@ -0,0 +1,91 @@
+/**
+ * This class draws all bodies of a BodyStore with a few draw calls instead of one window.draw(shape) per body.
+ * Every body is turned into a fan of triangles and appended to one sf::VertexArray per texture,
+ * so the number of draw calls is the number of different textures (plus one for the bodies without texture), not the number of bodies.
+ * Bodies whose textures are packed into the same atlas share a texture, and therefore a draw call.
+ * The vertex arrays are kept between frames, so no memory is allocated once the body count is stable.
+ * With a SpatialGrid, only the bodies inside the view of the target are turned into triangles.
+ *
+ * The positions of the store are world coordinates in double; the renderer subtracts an origin (the center of the Camera) from them
+ * before they become the float coordinates of the vertices, so the view of the target is in coordinates relative to that origin.
+ *
+ * The level of detail follows the size of a body on the screen: a circle gets just enough triangles that its outline is
+ * less than a quarter of a pixel from a true circle (7 for a radius of 2 pixels, 15 for 10 pixels, all 30 from about 45 pixels).
+ * A body smaller than a pixel is drawn as a single point, and when several small bodies fall on the same pixel, the first one
+ * stands for all of them (an impostor of the group). A dense catalog seen from far away then costs at most one vertex per pixel.
+ * The impostor takes the light of the whole group: a point gets the sum of the colors of its bodies (they each cover a part of the pixel),
+ * a small circle gets their average color (it already covers the pixel), so the result doesn't depend on which body came first.
+ *
+ */
+
+#ifndef BODYRENDERER_HPP
+#define BODYRENDERER_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BodyStore.hpp"
+#include "SpatialGrid.hpp"
+
+class BodyRenderer {
+public:
+    explicit BodyRenderer(std::size_t segments = 30); // Constructor with the number of triangles per circle, 30 like sf::CircleShape
+
+    // Function to draw all bodies on the target, at alpha between the previous (0) and the current (1) position of each body.
+    // If a grid built from the current positions is given, the bodies outside the view of the target are skipped.
+    // The origin is the world point at 0 in the view of the target, see Camera
+    void render(const BodyStore& bodies, sf::RenderTarget& target, float alpha = 1.0f, const SpatialGrid* grid = nullptr,
+                sf::Vector2<double> origin = sf::Vector2<double>());
+    std::size_t getBodyCount() const { return bodyCount; } // Number of bodies drawn by the last render, including the ones merged into another
+    std::size_t getPointCount() const { return pointCount; } // Number of bodies drawn as a single point by the last render
+    std::size_t getMergedCount() const { return mergedCount; } // Number of small bodies skipped because another one was drawn on the same pixel
+    std::size_t getDrawCallCount() const { return drawCalls; } // Number of draw calls of the last render
+    std::size_t getVertexCount() const { return vertexCount; } // Number of vertices of the last render
+
+private:
+    // All bodies with the same texture
+    struct Batch {
+        const sf::Texture* texture = nullptr; // nullptr for the bodies without texture
+        sf::VertexArray vertices{sf::Triangles};
+        std::size_t used = 0; // Number of vertices written in this frame
+    };
+
+    Batch& batchFor(const sf::Texture* texture); // Function to find (or create) the batch of a texture
+    std::size_t segmentsFor(float screenRadius) const; // Function to choose the number of triangles of a circle from its radius in pixels
+    void appendCircle(Batch& batch, std::size_t count, float x, float y, float radius, float rotation, sf::Color color, const sf::FloatRect& textureRect);
+    void appendPoint(float x, float y, sf::Color color);
+    // Function to find the pixel of a small body on the target, noPixel if it is outside
+    std::size_t pixelOf(const sf::Transform& transform, const sf::IntRect& viewport, float x, float y) const;
+    void mergeGroups(); // Function to give the vertices of every impostor the color of its group
+
+    // Small bodies that fell on one pixel: the vertices of the one that was drawn, and the sum of the colors of all of them
+    struct PixelGroup {
+        std::size_t batch = 0; // Index of the batch of the drawn body in batches, unused for a point
+        std::size_t first = 0; // First vertex and number of vertices of the drawn body
+        std::size_t count = 0;
+        bool point = false; // The drawn body is a point: the colors are added, otherwise they are averaged
+        std::uint32_t red = 0, green = 0, blue = 0, alpha = 0;
+        std::uint32_t bodies = 0;
+    };
+
+    std::size_t segments;
+    std::vector<std::vector<float>> unitCos; // Cosine of the angle of every point of a circle of n triangles is unitCos[n][k], calculated once
+    std::vector<std::vector<float>> unitSin; // Sine of the same angles
+    std::vector<Batch> batches;
+    Batch points; // Bodies smaller than a pixel, all colors in one draw call of sf::Points
+    std::vector<std::uint32_t> pixelFrame; // Frame in which each pixel of the target was last taken by a small body
+    std::vector<std::uint32_t> pixelGroup; // Group of each pixel taken in this frame, an index in groups
+    std::vector<PixelGroup> groups; // Groups of this frame, kept between frames
+    std::size_t pixelWidth = 0; // Size of the target that pixelFrame was made for
+    std::size_t pixelHeight = 0;
+    std::uint32_t frame = 0;
+    std::vector<std::uint32_t> visible; // Bodies inside the view, found with the grid, kept between frames
+    std::size_t bodyCount = 0;
+    std::size_t pointCount = 0;
+    std::size_t mergedCount = 0;
+    std::size_t drawCalls = 0;
+    std::size_t vertexCount = 0;
+};
+
+#endif
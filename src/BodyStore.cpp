@@ -0,0 +1,478 @@
+/**
+ * Purpose: Implement the methods of the BodyStore class that are declared in the BodyStore.hpp header file.
+ *  The update loop walks the hot arrays from the first to the last body, so the memory is read sequentially
+ *  and every byte brought into the cache is used.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include "BodyStore.hpp"
+#include "OrbitKernel.hpp"
+
+/**
+ * This function adds a body to the store. The slot of a removed body is reused if there is one,
+ * otherwise one element is appended to every array. The generation of a reused slot was incremented by removeBody,
+ * so the handles to the removed body don't resolve to the new one.
+ * Children that were waiting for a parent with this name (see setParentByName) are attached to it.
+ *
+ * */
+std::size_t BodyStore::addBody(const std::string& name, float radius, float distance, float orbitSpeed, float rotationSpeed,
+                               sf::Color color, sf::Vector2f position) {
+    std::size_t index = size();
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        // New slot: grow every array, the values are set below
+        angle.emplace_back(); rotation.emplace_back(); this->distance.emplace_back(); phase.emplace_back();
+        this->orbitSpeed.emplace_back(); this->rotationSpeed.emplace_back(); rotationPhase.emplace_back(); parent.emplace_back();
+        eccentricity.emplace_back(); axisPX.emplace_back(); axisPY.emplace_back(); axisQX.emplace_back(); axisQY.emplace_back();
+        offsetX.emplace_back(); offsetY.emplace_back(); positionX.emplace_back(); positionY.emplace_back(); previousX.emplace_back(); previousY.emplace_back();
+        this->name.emplace_back(); this->radius.emplace_back(); this->color.emplace_back(); texture.emplace_back(); textureRect.emplace_back();
+        inclination.emplace_back(); periapsisArgument.emplace_back(); meanAnomaly.emplace_back(); mass.emplace_back(); trail.emplace_back(); orbitVersion.emplace_back();
+        generation.push_back(0);
+        alive.push_back(0);
+        firstChild.push_back(-1); nextSibling.push_back(-1); previousSibling.push_back(-1);
+    }
+
+    angle[index] = 0.0f;
+    rotation[index] = 0.0f;
+    this->distance[index] = distance / 10; // The distances are scaled down to fit within the window
+    phase[index] = 0.0;
+    this->orbitSpeed[index] = orbitSpeed;
+    this->rotationSpeed[index] = rotationSpeed;
+    rotationPhase[index] = 0.0;
+    parent[index] = -1; // The parent is set later with setParent or setParentByName
+    eccentricity[index] = 0.0f; // A circle in the plane of the screen until setOrbitElements is called
+    axisPX[index] = 1.0f;
+    axisPY[index] = 0.0f;
+    axisQX[index] = 0.0f;
+    axisQY[index] = 1.0f;
+    offsetX[index] = this->distance[index];
+    offsetY[index] = 0.0f;
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    previousX[index] = position.x;
+    previousY[index] = position.y;
+
+    this->name[index] = name;
+    this->radius[index] = radius;
+    this->color[index] = color;
+    texture[index] = noTexture; // No texture until Planet::setTexture is called
+    textureRect[index] = sf::FloatRect();
+    inclination[index] = 0.0f;
+    periapsisArgument[index] = 0.0f;
+    meanAnomaly[index] = 0.0;
+    mass[index] = 0.0f; // Set with Planet::setMass
+    trail[index] = 0; // Set with Planet::setTrail
+    ++orbitVersion[index]; // A cached path of the old body of this slot is out of date
+    ++orbitsVersion;
+    alive[index] = 1;
+
+    if (!nameIndex.emplace(name, index).second) { // If two bodies have the same name, the first one keeps it
+        duplicateNames.emplace(name, index);
+    }
+    if (!waitingChildren.empty()) { // Nothing to look up when the parents come before their children
+        auto waiting = waitingChildren.equal_range(name);
+        for (auto it = waiting.first; it != waiting.second; ++it) {
+            attach(it->second, static_cast<int>(index));
+            waitingParent.erase(it->second);
+        }
+        waitingChildren.erase(waiting.first, waiting.second);
+    }
+
+    ++hierarchyVersion;
+    return index;
+}
+
+/**
+ * This function removes a body. Its slot stays in the arrays, but it is no longer drawn and it is given to the next body that is added.
+ * The children of the body are attached to its parent, so no parent index ever points to a removed body. Only the child list of the body
+ * is walked, so removing many bodies costs the number of their children, not the size of the store for each of them.
+ * If another body has the same name, it takes over the name in the index.
+ *
+ * */
+void BodyStore::removeBody(std::size_t index) {
+    if (!alive[index]) {
+        return;
+    }
+    auto named = nameIndex.find(name[index]);
+    auto duplicates = duplicateNames.equal_range(name[index]);
+    if (named != nameIndex.end() && named->second == index) {
+        if (duplicates.first != duplicates.second) {
+            named->second = duplicates.first->second; // The next body with this name is found by name again
+            duplicateNames.erase(duplicates.first);
+        } else {
+            nameIndex.erase(named);
+        }
+    } else {
+        for (auto it = duplicates.first; it != duplicates.second; ++it) {
+            if (it->second == index) {
+                duplicateNames.erase(it);
+                break;
+            }
+        }
+    }
+    for (int child = firstChild[index]; child >= 0;) {
+        int next = nextSibling[child]; // attach() unlinks the child from this list
+        attach(static_cast<std::size_t>(child), parent[index] == child ? -1 : parent[index]);
+        child = next;
+    }
+    stopWaiting(index);
+    attach(index, -1);
+    distance[index] = 0.0f; // Keep the slot harmless for the update loops
+    orbitSpeed[index] = 0.0f;
+    rotationSpeed[index] = 0.0f;
+    eccentricity[index] = 0.0f;
+    mass[index] = 0.0f;
+    if (trail[index]) {
+        trail[index] = 0;
+        ++trailVersion;
+    }
+    textures.release(texture[index]);
+    texture[index] = noTexture;
+    alive[index] = 0;
+    ++generation[index];
+    freeSlots.push_back(index);
+    ++hierarchyVersion;
+}
+
+/**
+ * This function removes every body at once, in one pass instead of one removeBody per body.
+ * The slots are freed in reverse order, so the next bodies added get the slots 0, 1, 2... again. The handles to the old bodies stop resolving.
+ *
+ * */
+void BodyStore::clear() {
+    freeSlots.clear();
+    for (std::size_t i = size(); i-- > 0;) {
+        firstChild[i] = -1;
+        nextSibling[i] = -1;
+        previousSibling[i] = -1;
+        if (alive[i]) {
+            parent[i] = -1;
+            distance[i] = 0.0f;
+            orbitSpeed[i] = 0.0f;
+            rotationSpeed[i] = 0.0f;
+            eccentricity[i] = 0.0f;
+            mass[i] = 0.0f;
+            if (trail[i]) {
+                trail[i] = 0;
+                ++trailVersion;
+            }
+            textures.release(texture[i]);
+            texture[i] = noTexture;
+            alive[i] = 0;
+            ++generation[i];
+        }
+        freeSlots.push_back(i);
+    }
+    nameIndex.clear();
+    duplicateNames.clear();
+    waitingChildren.clear();
+    waitingParent.clear();
+    ++hierarchyVersion;
+}
+
+// Function to find the index of a body by its name, in constant time with the hash index
+int BodyStore::findIndex(const std::string& name) const {
+    auto found = nameIndex.find(name);
+    if (found == nameIndex.end()) {
+        return -1; // No body with this name
+    }
+    return static_cast<int>(found->second);
+}
+
+BodyHandle BodyStore::handleOf(std::size_t index) const {
+    return BodyHandle{static_cast<std::uint32_t>(index), generation[index]};
+}
+
+int BodyStore::resolve(BodyHandle handle) const {
+    if (handle.index >= size() || generation[handle.index] != handle.generation || !alive[handle.index]) {
+        return -1; // The body was removed, and maybe replaced by another one
+    }
+    return static_cast<int>(handle.index);
+}
+
+/**
+ * This function updates the state of all bodies based on the elapsed time.
+ * First the orbit kernel advances the angle of every body and calculates its position relative to its parent, many bodies at once with SIMD instructions.
+ * Then the rotations are advanced, and the relative positions are added to the positions of the parents.
+ * A body reads the position of its parent, so a parent must come before its children in the store to use the position of the current frame.
+ * The UpdateScheduler doesn't have this limitation and runs on several threads; this function is the single-threaded version.
+ *
+ * */
+void BodyStore::update(float deltaTime) {
+    std::size_t count = size();
+    propagateOrbits(angle.data(), orbitSpeed.data(), distance.data(), offsetX.data(), offsetY.data(), count, deltaTime);
+    applyKeplerOrbits(0, count);
+    for (std::size_t i = 0; i < count; ++i) {
+        rotation[i] += rotationSpeed[i] * deltaTime;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        updatePosition(i);
+    }
+}
+
+// Function to update a single body, the same as one step of the loops in update()
+void BodyStore::updateBody(std::size_t index, float deltaTime) {
+    propagateOrbits(&angle[index], &orbitSpeed[index], &distance[index], &offsetX[index], &offsetY[index], 1, deltaTime);
+    applyKeplerOrbits(index, index + 1);
+    rotation[index] += rotationSpeed[index] * deltaTime;
+    updatePosition(index);
+}
+
+/**
+ * This function computes the angle of every body in [begin, end) directly from the simulated time, in double precision:
+ * angle = phase + orbitSpeed * time, wrapped to [-pi, pi] before it is stored as a float.
+ * Nothing is accumulated from frame to frame, so there is no drift, and jumping to any time costs the same as a normal frame.
+ * The rotation, rotationPhase + rotationSpeed * time, is wrapped to [0, 360) degrees the same way.
+ *
+ * */
+void BodyStore::evaluateAnglesAt(double time, std::size_t begin, std::size_t end) {
+    const double twoPi = 6.283185307179586;
+    for (std::size_t i = begin; i < end; ++i) {
+        double a = phase[i] + static_cast<double>(orbitSpeed[i]) * time;
+        angle[i] = static_cast<float>(a - twoPi * std::nearbyint(a / twoPi));
+        double r = rotationPhase[i] + static_cast<double>(rotationSpeed[i]) * time;
+        rotation[i] = static_cast<float>(r - 360.0 * std::floor(r / 360.0));
+    }
+}
+
+/**
+ * This function calculates the position of a single body at any simulated time, without changing the store.
+ * It adds up the offsets of the body and of all its parents, each one computed from the time in double precision.
+ * Kepler's equation is solved with Newton-Raphson steps until the step is negligible, so the cost is a few sines and cosines
+ * per level of the hierarchy, whatever the time.
+ *
+ * */
+sf::Vector2<double> BodyStore::positionAt(std::size_t index, double time) const {
+    const double twoPi = 6.283185307179586;
+    sf::Vector2<double> position(0.0, 0.0); // The bodies without a parent orbit the world origin
+    int current = static_cast<int>(index);
+    for (std::size_t depth = 0; current >= 0 && depth <= size(); ++depth) { // The depth limit stops at a cycle of parents
+        double m = phase[current] + static_cast<double>(orbitSpeed[current]) * time;
+        m -= twoPi * std::nearbyint(m / twoPi);
+        double e = eccentricity[current];
+        double anomaly = m + std::copysign(0.85 * e, m); // Same starting guess as the SIMD solver
+        for (int k = 0; k < 50; ++k) {
+            double step = (anomaly - e * std::sin(anomaly) - m) / (1.0 - e * std::cos(anomaly));
+            anomaly -= step;
+            if (std::fabs(step) < 1e-14) {
+                break;
+            }
+        }
+        double x = distance[current] * (std::cos(anomaly) - e);
+        double y = distance[current] * std::sin(anomaly);
+        position.x += x * axisPX[current] + y * axisQX[current];
+        position.y += x * axisPY[current] + y * axisQY[current];
+        current = parent[current];
+    }
+    return position;
+}
+
+/**
+ * This function runs the Kepler solver on bodies [begin, end), after the orbit kernel has advanced their angles (mean anomalies).
+ * While every orbit is a circle in the plane of the screen, the offsets of the orbit kernel are already right and nothing is done.
+ *
+ * */
+void BodyStore::applyKeplerOrbits(std::size_t begin, std::size_t end) {
+    if (!keplerOrbits || begin >= end) {
+        return;
+    }
+    solveKeplerOrbits(&angle[begin], &eccentricity[begin], &distance[begin], &axisPX[begin], &axisPY[begin], &axisQX[begin], &axisQY[begin],
+                      &offsetX[begin], &offsetY[begin], end - begin);
+}
+
+void BodyStore::savePreviousPositions() {
+    previousX = positionX; // Same size, so no memory is allocated
+    previousY = positionY;
+}
+
+sf::Vector2<double> BodyStore::interpolatedPosition(std::size_t index, float alpha) const {
+    return sf::Vector2<double>(previousX[index] + (positionX[index] - previousX[index]) * alpha,
+                               previousY[index] + (positionY[index] - previousY[index]) * alpha);
+}
+
+// Function to calculate the position of a body on its orbit around its parent, or around the world origin if it has no parent
+void BodyStore::updatePosition(std::size_t index) {
+    double centerX = 0.0;
+    double centerY = 0.0;
+    if (parent[index] >= 0) {
+        centerX = positionX[parent[index]];
+        centerY = positionY[parent[index]];
+    }
+    positionX[index] = centerX + offsetX[index]; // Added in double: a moon far from the origin keeps the digits of its small orbit
+    positionY[index] = centerY + offsetY[index];
+}
+
+// Function to set the semi-major axis, the version tells OrbitPaths to draw the orbit again
+void BodyStore::setDistance(std::size_t index, float distance) {
+    this->distance[index] = distance;
+    ++orbitVersion[index];
+    ++orbitsVersion;
+}
+
+// The angle at time t is phase + orbitSpeed * t: adding (old speed - new speed) * t to the phase keeps the same angle at t
+void BodyStore::setOrbitSpeed(std::size_t index, float speed, double time) {
+    phase[index] += (static_cast<double>(orbitSpeed[index]) - speed) * time;
+    orbitSpeed[index] = speed;
+}
+
+// Same for the rotation, rotationPhase + rotationSpeed * t
+void BodyStore::setRotationSpeed(std::size_t index, float speed, double time) {
+    rotationPhase[index] += (static_cast<double>(rotationSpeed[index]) - speed) * time;
+    rotationSpeed[index] = speed;
+}
+
+// Function to show or hide the trail of a body, the version tells OrbitTrails to give it a part of its buffer
+void BodyStore::setTrail(std::size_t index, bool shown) {
+    if (trail[index] != static_cast<std::uint8_t>(shown)) {
+        trail[index] = shown;
+        ++trailVersion;
+    }
+}
+
+// Function to set the parent of a body, the version tells the update scheduler to sort the bodies again
+void BodyStore::setParent(std::size_t index, int parentIndex) {
+    attach(index, parentIndex);
+    ++hierarchyVersion;
+}
+
+// Function to move a body from the child list of its parent to the child list of its new parent, in constant time
+void BodyStore::attach(std::size_t index, int parentIndex) {
+    int self = static_cast<int>(index);
+    if (parent[index] >= 0) {
+        if (previousSibling[index] >= 0) {
+            nextSibling[previousSibling[index]] = nextSibling[index];
+        } else {
+            firstChild[parent[index]] = nextSibling[index];
+        }
+        if (nextSibling[index] >= 0) {
+            previousSibling[nextSibling[index]] = previousSibling[index];
+        }
+    }
+    parent[index] = parentIndex;
+    previousSibling[index] = -1;
+    nextSibling[index] = -1;
+    if (parentIndex >= 0) {
+        nextSibling[index] = firstChild[parentIndex];
+        if (firstChild[parentIndex] >= 0) {
+            previousSibling[firstChild[parentIndex]] = self;
+        }
+        firstChild[parentIndex] = self;
+    }
+}
+
+// Function to cancel the wait of a child for a parent that isn't loaded yet
+void BodyStore::stopWaiting(std::size_t index) {
+    if (waitingParent.empty()) {
+        return;
+    }
+    auto waiting = waitingParent.find(index);
+    if (waiting == waitingParent.end()) {
+        return;
+    }
+    auto children = waitingChildren.equal_range(waiting->second);
+    for (auto it = children.first; it != children.second; ++it) {
+        if (it->second == index) {
+            waitingChildren.erase(it);
+            break;
+        }
+    }
+    waitingParent.erase(waiting);
+}
+
+/**
+ * This function sets the parent of a body by name. If no body has this name yet, the child orbits the world origin
+ * and is attached when a body with this name is added, so the rows of the catalog can come in any order.
+ * An empty name makes the body orbit the world origin.
+ *
+ * */
+void BodyStore::setParentByName(std::size_t index, const std::string& parentName) {
+    stopWaiting(index); // Forget an earlier request of this child that is still waiting
+    int parentIndex = parentName.empty() ? -1 : findIndex(parentName);
+    if (parentIndex < 0 && !parentName.empty()) {
+        waitingChildren.emplace(parentName, index);
+        waitingParent.emplace(index, parentName);
+    }
+    if (parentIndex == static_cast<int>(index)) {
+        parentIndex = -1; // A body can't orbit itself
+    }
+    setParent(index, parentIndex);
+}
+
+/**
+ * This function gives a body the texture of a file. The file is loaded only if no other body uses it yet.
+ * The new texture is acquired before the old one is released, so setting the same file again doesn't reload it.
+ * If the file can't be loaded, the body keeps its texture and false is returned.
+ *
+ * */
+bool BodyStore::setTexture(std::size_t index, const std::string& texturePath) {
+    TextureHandle handle = textures.acquire(texturePath);
+    if (handle == noTexture && !texturePath.empty()) {
+        return false;
+    }
+    textures.release(texture[index]);
+    texture[index] = handle;
+    textureRect[index] = textures.getRect(handle); // The image is only a part of its atlas page
+    return true;
+}
+
+/**
+ * This function sets the orbital elements of a body and calculates the two axes used by the Kepler solver.
+ * The orbit is first turned by the argument of periapsis in its plane, then the plane is tilted around the screen x axis by the inclination,
+ * and the tilted orbit is seen from above (the z coordinate is dropped):
+ *   P = (cos(w), sin(w) * cos(i))
+ *   Q = sqrt(1 - e^2) * (-sin(w), cos(w) * cos(i))
+ * The eccentricity is clamped to [0, maxEccentricity] because the float solver isn't accurate for longer ellipses.
+ *
+ * */
+void BodyStore::setOrbitElements(std::size_t index, float eccentricity, float inclination, float periapsisArgument, double meanAnomaly) {
+    const double twoPi = 6.283185307179586;
+    float e = std::min(std::max(eccentricity, 0.0f), maxEccentricity);
+    float cosW = std::cos(periapsisArgument);
+    float sinW = std::sin(periapsisArgument);
+    float cosI = std::cos(inclination);
+    float minorAxis = std::sqrt(1.0f - e * e); // Semi-minor axis relative to the semi-major axis
+
+    this->eccentricity[index] = e;
+    this->inclination[index] = inclination;
+    this->periapsisArgument[index] = periapsisArgument;
+    this->meanAnomaly[index] = meanAnomaly;
+    axisPX[index] = cosW;
+    axisPY[index] = sinW * cosI;
+    axisQX[index] = -sinW * minorAxis;
+    axisQY[index] = cosW * cosI * minorAxis;
+    phase[index] = meanAnomaly;
+    angle[index] = static_cast<float>(meanAnomaly - twoPi * std::nearbyint(meanAnomaly / twoPi));
+    ++orbitVersion[index];
+    ++orbitsVersion;
+
+    if (e != 0.0f || inclination != 0.0f || periapsisArgument != 0.0f) {
+        keplerOrbits = true; // From now on the solver runs after the orbit kernel
+    }
+}
+
+/**
+ * The purpose of this function is to draw a single body on a specified window.
+ * A circle shape is created from the data of the body for this draw call only.
+ * Drawing every body this way costs one draw call per body, the main loop uses BodyRenderer instead.
+ *
+ * */
+void BodyStore::drawBody(std::size_t index, sf::RenderWindow& window) const {
+    if (!alive[index]) {
+        return;
+    }
+    sf::CircleShape shape(radius[index]);
+    shape.setOrigin(radius[index], radius[index]); // Origin is set to the center of the circle
+    shape.setFillColor(color[index]);
+    if (texture[index] != noTexture) {
+        shape.setTexture(textures.getTexture(texture[index]));
+        shape.setTextureRect(sf::IntRect(static_cast<int>(textureRect[index].left), static_cast<int>(textureRect[index].top),
+                                         static_cast<int>(textureRect[index].width), static_cast<int>(textureRect[index].height)));
+    }
+    shape.setPosition(sf::Vector2f(static_cast<float>(positionX[index]), static_cast<float>(positionY[index]))); // In world coordinates, for the default view only
+    shape.setRotation(rotation[index]);
+    window.draw(shape);
+}
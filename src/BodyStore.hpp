@@ -0,0 +1,133 @@
+/**
+ * This class stores the state of every body (sun, planet, moon, asteroid) of the simulation.
+ * Instead of keeping one object per body (array of structures), it keeps one contiguous array per property (structure of arrays).
+ * The update loop only touches the "hot" arrays it needs (angle, rotation, distance, speeds, parent and position),
+ * so the time spent per frame scales with the bytes that are actually used, not with the size of a whole Planet object.
+ * The "cold" data (name, radius, color and texture) is only read when a body is drawn or looked up.
+ *
+ * The positions are world coordinates in double precision: the bodies without a parent orbit the world origin, and a Camera
+ * subtracts its own origin from them before they become float vertices (see BodyRenderer). The offsets from the parents stay in float,
+ * their error is relative to the size of their own orbit and doesn't grow with the distance from the origin.
+ *
+ * Orbits are Keplerian ellipses: "angle" is the mean anomaly, "distance" the semi-major axis, and the eccentricity, inclination and
+ * argument of periapsis are set with setOrbitElements. Bodies without elements keep the circular orbit in the plane of the screen.
+ *
+ */
+
+#ifndef BODYSTORE_HPP
+#define BODYSTORE_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TextureCache.hpp"
+
+// Stable reference to a body: the index of its slot and the generation of the slot when the handle was made.
+// A slot's generation changes when its body is removed, so an old handle can be detected instead of silently pointing to another body.
+struct BodyHandle {
+    std::uint32_t index = 0;
+    std::uint32_t generation = 0;
+};
+
+class BodyStore {
+public:
+    // Function to add a body to the store. It returns the index of the new body, which is used as a handle by the Planet class.
+    std::size_t addBody(const std::string& name, float radius, float distance, float orbitSpeed, float rotationSpeed,
+                        sf::Color color, sf::Vector2f position);
+    void removeBody(std::size_t index); // Function to remove a body, its children are attached to its parent
+    void clear(); // Function to remove every body, faster than removing them one by one
+
+    std::size_t size() const { return angle.size(); } // Number of slots in the store, including the slots of removed bodies
+    bool isAlive(std::size_t index) const { return alive[index] != 0; } // False for the slot of a removed body
+    int findIndex(const std::string& name) const; // Function to find the index of a body by its name in constant time, returns -1 if there is no such body
+    BodyHandle handleOf(std::size_t index) const; // Function to make a stable handle to a body
+    int resolve(BodyHandle handle) const; // Function to get the index of a handle, returns -1 if the body was removed
+
+    void update(float deltaTime); // Function to update the orbit and rotation of all bodies
+    void updateBody(std::size_t index, float deltaTime); // Function to update a single body
+    void evaluateAnglesAt(double time, std::size_t begin, std::size_t end); // Function to set the angle and rotation of bodies [begin, end) to their values at a simulated time
+    sf::Vector2<double> positionAt(std::size_t index, double time) const; // Function to calculate the position of a body at any simulated time, in constant time per parent
+    void applyKeplerOrbits(std::size_t begin, std::size_t end); // Function to replace the circular offsets of bodies [begin, end) with their positions on their ellipses
+    void savePreviousPositions(); // Function to copy the current positions to the previous positions, called before the last tick of a frame
+    sf::Vector2<double> interpolatedPosition(std::size_t index, float alpha) const; // Function to get the position drawn at alpha between the previous (0) and the current (1) position
+    void updatePosition(std::size_t index); // Function to calculate the position of a body from its offset and the position of its parent
+    void drawBody(std::size_t index, sf::RenderWindow& window) const; // Function to draw a single body on the window, BodyRenderer draws all bodies at once
+
+    void setParent(std::size_t index, int parentIndex); // Function to set the body that a body is orbiting around
+    void setParentByName(std::size_t index, const std::string& parentName); // Function to set the parent by name, it can be added later
+    bool setTexture(std::size_t index, const std::string& texturePath); // Function to give a body the texture of a file (shared through the cache), an empty path removes it
+    void setTrail(std::size_t index, bool shown); // Function to show or hide the recent path of a body, see OrbitTrails
+    void setDistance(std::size_t index, float distance); // Function to change the semi-major axis of the orbit of a body
+    // Function to change the orbit speed of a body at a simulated time. The phase is moved so the body stays where it is at that time instead of jumping
+    void setOrbitSpeed(std::size_t index, float speed, double time);
+    // Function to change the rotation speed of a body at a simulated time, the rotation phase is moved the same way so the body doesn't turn at once
+    void setRotationSpeed(std::size_t index, float speed, double time);
+    // Function to set the shape of the orbit of a body. The angles are in radians, the mean anomaly is the one at simulated time 0
+    void setOrbitElements(std::size_t index, float eccentricity, float inclination, float periapsisArgument, double meanAnomaly);
+    bool hasKeplerOrbits() const { return keplerOrbits; } // True once a body has an orbit that isn't a circle in the plane of the screen
+    std::size_t getHierarchyVersion() const { return hierarchyVersion; } // Incremented every time a body is added or a parent changes
+    std::size_t getTrailVersion() const { return trailVersion; } // Incremented every time a trail is shown or hidden
+    std::size_t getOrbitVersion() const { return orbitsVersion; } // Incremented every time the shape of an orbit changes, see orbitVersion
+
+    // Hot data: read and written by the update loop every frame. Each vector has one element per body.
+    std::vector<float> angle; // Current angle for the orbit
+    std::vector<float> rotation; // Current rotation angle around its own axis
+    std::vector<float> distance; // Distance from the body it's orbiting around (semi-major axis of the orbit)
+    std::vector<double> phase; // Angle of the orbit (mean anomaly) at simulated time 0, the angle at time t is phase + orbitSpeed * t
+    std::vector<float> orbitSpeed; // Speed of orbiting around another body or point
+    std::vector<float> rotationSpeed; // Speed of rotation around its own axis
+    std::vector<double> rotationPhase; // Rotation at simulated time 0, the rotation at time t is rotationPhase + rotationSpeed * t
+    std::vector<int> parent; // Index of the body this body is orbiting around, -1 if it orbits the world origin. Changed with setParent
+    std::vector<float> eccentricity; // 0 for a circle, up to maxEccentricity (see OrbitKernel.hpp)
+    std::vector<float> axisPX; // Screen direction of the periapsis, projected with the inclination
+    std::vector<float> axisPY;
+    std::vector<float> axisQX; // Screen direction 90 degrees ahead of the periapsis, projected and scaled by sqrt(1 - eccentricity^2)
+    std::vector<float> axisQY;
+    std::vector<float> offsetX; // x coordinate relative to the parent, calculated by the orbit kernel
+    std::vector<float> offsetY; // y coordinate relative to the parent, calculated by the orbit kernel
+    std::vector<double> positionX; // Current x coordinate in the world, in double so a body far from the origin keeps its small motions
+    std::vector<double> positionY; // Current y coordinate in the world
+    std::vector<double> previousX; // x coordinate before the last tick, used to interpolate the rendering between two ticks
+    std::vector<double> previousY; // y coordinate before the last tick
+
+    // Cold data: only needed for drawing and lookups.
+    std::vector<std::string> name;
+    std::vector<float> radius;
+    std::vector<sf::Color> color;
+    std::vector<TextureHandle> texture; // Texture for the body's appearance, the pixels are in "textures"
+    std::vector<sf::FloatRect> textureRect; // Part of the texture (atlas page) that is mapped on the body, in pixels
+    std::vector<float> inclination; // Tilt of the orbit plane from the plane of the screen, in radians
+    std::vector<float> periapsisArgument; // Angle from the screen x axis to the periapsis, measured in the orbit plane, in radians
+    std::vector<double> meanAnomaly; // Mean anomaly at time 0 as set by setOrbitElements. phase differs from it once the orbit speed is changed while running
+    std::vector<float> mass; // Gravitational mass, only used by the N-body mode (see GravitySimulation). 0 for a body that doesn't attract the others
+    std::vector<std::uint8_t> trail; // 1 if the recent path of the body is drawn, changed with setTrail
+    std::vector<std::uint32_t> orbitVersion; // Incremented when the shape of the orbit of the body changes (setDistance, setOrbitElements) or its slot is reused
+
+    TextureCache textures; // Every texture file used by the bodies, loaded once
+
+private:
+    void stopWaiting(std::size_t index); // Function to cancel a setParentByName that is waiting for its parent
+    void attach(std::size_t index, int parentIndex); // Function to set parent[index] and move the body to the child list of its new parent
+
+    std::vector<std::uint32_t> generation; // Generation of every slot, incremented when its body is removed
+    std::vector<std::uint8_t> alive; // 1 for a body, 0 for the slot of a removed body
+    std::vector<std::size_t> freeSlots; // Slots of removed bodies, reused by addBody
+    // Children of every body as a linked list through the slots, so removing a body only visits its own children. -1 ends a list
+    std::vector<int> firstChild;
+    std::vector<int> nextSibling;
+    std::vector<int> previousSibling;
+    std::unordered_map<std::string, std::size_t> nameIndex; // Index of every body by name, built as the bodies are added
+    std::unordered_multimap<std::string, std::size_t> duplicateNames; // Bodies whose name was already taken, one of them gets the name when its holder is removed
+    std::unordered_multimap<std::string, std::size_t> waitingChildren; // Children whose parent (the key) isn't in the store yet
+    std::unordered_map<std::size_t, std::string> waitingParent; // The same, from the child to the name of its parent
+    std::size_t hierarchyVersion = 0;
+    std::size_t trailVersion = 0;
+    std::size_t orbitsVersion = 0;
+    bool keplerOrbits = false;
+};
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * This file declares the functions that write and read numbers in little-endian order, whatever the processor,
+ * so the binary files of the program (the catalog snapshot, the ephemeris) can be moved between machines.
+ * The values are written and read byte by byte. The bytes are spelled out instead of looped over: the compiler recognizes that pattern
+ * and turns it into a single load or store on a little-endian processor, which matters when coefficients are read straight from a mapped file.
+ *
+ */
+
+#ifndef BYTEORDER_HPP
+#define BYTEORDER_HPP
+
+#include <cstdint>
+#include <cstring>
+
+// Functions to write numbers in little-endian order
+inline void putU32(unsigned char* out, std::uint32_t value) {
+    out[0] = static_cast<unsigned char>(value);
+    out[1] = static_cast<unsigned char>(value >> 8);
+    out[2] = static_cast<unsigned char>(value >> 16);
+    out[3] = static_cast<unsigned char>(value >> 24);
+}
+
+inline void putU64(unsigned char* out, std::uint64_t value) {
+    putU32(out, static_cast<std::uint32_t>(value));
+    putU32(out + 4, static_cast<std::uint32_t>(value >> 32));
+}
+
+inline void putFloat(unsigned char* out, float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU32(out, bits);
+}
+
+inline void putDouble(unsigned char* out, double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+// Functions to read numbers in little-endian order
+inline std::uint32_t getU32(const unsigned char* in) {
+    return static_cast<std::uint32_t>(in[0]) | static_cast<std::uint32_t>(in[1]) << 8 | static_cast<std::uint32_t>(in[2]) << 16 |
+           static_cast<std::uint32_t>(in[3]) << 24;
+}
+
+inline std::uint64_t getU64(const unsigned char* in) {
+    return static_cast<std::uint64_t>(in[0]) | static_cast<std::uint64_t>(in[1]) << 8 | static_cast<std::uint64_t>(in[2]) << 16 |
+           static_cast<std::uint64_t>(in[3]) << 24 | static_cast<std::uint64_t>(in[4]) << 32 | static_cast<std::uint64_t>(in[5]) << 40 |
+           static_cast<std::uint64_t>(in[6]) << 48 | static_cast<std::uint64_t>(in[7]) << 56;
+}
+
+inline float getFloat(const unsigned char* in) {
+    std::uint32_t bits = getU32(in);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline double getDouble(const unsigned char* in) {
+    std::uint64_t bits = getU64(in);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#endif
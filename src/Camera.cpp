@@ -0,0 +1,80 @@
+/**
+ * Purpose: Implement the methods of the Camera class that are declared in the Camera.hpp header file.
+ *  The zoom moves towards its target in log scale, so a zoom by 1000 takes as long as a zoom by 2 and looks the same at every scale.
+ *  While it moves, the center is calculated again from the anchor at every frame instead of being interpolated on its own:
+ *  the point under the mouse then stays exactly under it, without a wobble.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include "Camera.hpp"
+
+// Limits of the zoom in pixels per world unit, from a system of 10^15 units on the screen to a thousand pixels per unit.
+// A double keeps about 16 digits: a body 10^10 units from the origin is placed to 10^-6 units, a thousandth of a pixel at the largest zoom
+static const double minZoom = 1e-12;
+static const double maxZoom = 1e3;
+// Time for the zoom to cover about two thirds of the way to its target, in seconds
+static const float zoomSmoothing = 0.08f;
+
+Camera::Camera(sf::Vector2u size, double zoom)
+    : center(0.0, 0.0), zoom(std::min(std::max(zoom, minZoom), maxZoom)), targetZoom(this->zoom),
+      size(static_cast<float>(size.x), static_cast<float>(size.y)) {
+}
+
+void Camera::setSize(sf::Vector2u size) {
+    this->size = sf::Vector2f(static_cast<float>(size.x), static_cast<float>(size.y));
+}
+
+void Camera::lookAt(sf::Vector2<double> center, double zoom) {
+    this->center = center;
+    this->zoom = std::min(std::max(zoom, minZoom), maxZoom);
+    targetZoom = this->zoom;
+    anchored = false;
+}
+
+// The world follows the mouse: dragging it to the right moves the camera to the left
+void Camera::pan(sf::Vector2f pixels) {
+    sf::Vector2<double> distance(-pixels.x / zoom, -pixels.y / zoom);
+    center += distance;
+    anchorWorld += distance; // A zoom in progress keeps the same pixel under the mouse
+}
+
+void Camera::move(sf::Vector2<double> distance) {
+    center += distance;
+    anchorWorld += distance;
+}
+
+void Camera::zoomAt(double factor, sf::Vector2i pixel) {
+    anchorPixel = sf::Vector2f(pixel.x - size.x / 2, pixel.y - size.y / 2);
+    anchorWorld = sf::Vector2<double>(center.x + anchorPixel.x / zoom, center.y + anchorPixel.y / zoom);
+    anchored = true;
+    targetZoom = std::min(std::max(targetZoom * factor, minZoom), maxZoom);
+}
+
+void Camera::anchorCenter() {
+    center = sf::Vector2<double>(anchorWorld.x - anchorPixel.x / zoom, anchorWorld.y - anchorPixel.y / zoom);
+}
+
+void Camera::update(float deltaTime) {
+    if (zoom == targetZoom) {
+        return;
+    }
+    double logZoom = std::log(zoom);
+    double logTarget = std::log(targetZoom);
+    double step = 1.0 - std::exp(-deltaTime / zoomSmoothing); // The same speed at any frame rate
+    logZoom += (logTarget - logZoom) * step;
+    zoom = std::abs(logTarget - logZoom) < 1e-4 ? targetZoom : std::exp(logZoom); // Close enough: land exactly on the target
+    if (anchored) {
+        anchorCenter();
+        anchored = zoom != targetZoom;
+    }
+}
+
+sf::View Camera::getView() const {
+    return sf::View(sf::Vector2f(0.0f, 0.0f), sf::Vector2f(static_cast<float>(size.x / zoom), static_cast<float>(size.y / zoom)));
+}
+
+sf::Vector2<double> Camera::mapPixelToWorld(sf::Vector2i pixel) const {
+    return sf::Vector2<double>(center.x + (pixel.x - size.x / 2) / zoom, center.y + (pixel.y - size.y / 2) / zoom);
+}
@@ -0,0 +1,47 @@
+/**
+ * This class is the camera of the window: the point of the world at the center of the screen and the zoom, in pixels per world unit.
+ * It makes the "floating origin" of the renderer: the world positions are doubles, and every frame the center of the camera is
+ * subtracted from them before they are turned into float vertices. A vertex is then a small number near 0 wherever the camera is,
+ * so zooming on a moon far from the origin doesn't make it shake from the rounding of float coordinates.
+ * The sf::View given to SFML is always centered on 0 in these rebased coordinates.
+ *
+ * The zoom goes from far beyond the outer planets to a few meters of the surface of a planet. A zoom with the wheel moves smoothly
+ * towards its target and keeps the point under the mouse in place, a drag with the mouse moves the world with the mouse.
+ *
+ */
+
+#ifndef CAMERA_HPP
+#define CAMERA_HPP
+
+#include <SFML/Graphics.hpp>
+
+class Camera {
+public:
+    // Constructor with the size of the window in pixels and the zoom, looking at the world origin
+    Camera(sf::Vector2u size, double zoom = 1.0);
+
+    void setSize(sf::Vector2u size); // Function to follow the size of the window, the center and the zoom don't change
+    void lookAt(sf::Vector2<double> center, double zoom); // Function to jump to a center and a zoom, without moving smoothly
+    void pan(sf::Vector2f pixels); // Function to move the world by a number of pixels on the screen, at once (a drag or the arrow keys)
+    void move(sf::Vector2<double> distance); // Function to move the camera in world units, at once, to follow a moving body
+    void zoomAt(double factor, sf::Vector2i pixel); // Function to multiply the zoom by a factor, smoothly, keeping the world point under a pixel in place
+    void update(float deltaTime); // Function to move the zoom towards its target, called once per frame
+
+    sf::Vector2<double> getOrigin() const { return center; } // World point at the center of the screen, subtracted from every position before drawing
+    double getZoom() const { return zoom; } // Pixels per world unit
+    sf::View getView() const; // Function to get the view for the rebased coordinates: centered on 0, one pixel is 1 / zoom
+    sf::Vector2<double> mapPixelToWorld(sf::Vector2i pixel) const; // Function to get the world point under a pixel of the window
+
+private:
+    void anchorCenter(); // Function to place the center so the anchor stays under its pixel at the current zoom
+
+    sf::Vector2<double> center; // The floating origin
+    double zoom;
+    double targetZoom;
+    sf::Vector2f size; // Size of the window in pixels
+    bool anchored = false; // Set while a zoom with the mouse is in progress
+    sf::Vector2<double> anchorWorld; // World point that stays under anchorPixel while zooming
+    sf::Vector2f anchorPixel; // Pixel of the anchor, relative to the center of the window
+};
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * Purpose: Implement the methods of the CatalogListener class that are declared in the CatalogListener.hpp header file.
+ *  Several notifications for the same planet that arrive together are merged, so a burst of updates fetches each row once.
+ *  If the connection is lost, the thread connects again every few seconds; changes made in the meantime are picked up at the next start.
+ *
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <iostream>
+#include <memory>
+#include "CatalogListener.hpp"
+#include "Log.hpp"
+
+// Longest time the thread waits for a notification before it checks whether it has to stop
+static const long pollingMilliseconds = 200;
+// Time between two attempts to connect again after the connection was lost
+static const int reconnectSeconds = 5;
+
+CatalogListener::CatalogListener(const std::string& connectionString, const std::string& channel)
+    : worker(&CatalogListener::run, this, connectionString, channel) {
+}
+
+CatalogListener::~CatalogListener() {
+    stopping.store(true);
+    worker.join();
+}
+
+void CatalogListener::run(const std::string& connectionString, const std::string& channel) {
+    while (!stopping.load()) {
+        std::unique_ptr<Database> db(new Database(connectionString));
+        if (!db->listen(channel)) {
+            // Wait before trying again, but stop quickly when asked
+            for (int i = 0; i < reconnectSeconds * 1000 / pollingMilliseconds && !stopping.load(); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(pollingMilliseconds));
+            }
+            continue;
+        }
+        LOG_INFO("Listening for changes of the planets on '%s'", channel.c_str());
+        try {
+            while (!stopping.load()) {
+                std::vector<std::string> names = db->awaitNotifications(pollingMilliseconds);
+                if (names.empty()) {
+                    continue;
+                }
+                std::sort(names.begin(), names.end());
+                names.erase(std::unique(names.begin(), names.end()), names.end());
+
+                std::vector<PlanetRecord> records;
+                if (!db->readPlanetsByName(names, records)) {
+                    continue;
+                }
+                // A name without a row was deleted
+                std::vector<std::string> deleted;
+                std::vector<std::string> found;
+                for (const auto& record : records) {
+                    found.push_back(record.name);
+                }
+                std::sort(found.begin(), found.end());
+                std::set_difference(names.begin(), names.end(), found.begin(), found.end(), std::back_inserter(deleted));
+                LOG_DEBUG("Fetched %zu changed and %zu deleted planets", records.size(), deleted.size());
+
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto& record : records) {
+                    changes.push_back(std::move(record));
+                }
+                for (auto& name : deleted) {
+                    removals.push_back(std::move(name));
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Lost the notification connection: " << e.what() << std::endl;
+        }
+    }
+}
+
+std::size_t CatalogListener::poll(BodyStore& bodies, std::vector<Planet>& planets, double time) {
+    std::vector<PlanetRecord> ready;
+    std::vector<std::string> removed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(changes);
+        removed.swap(removals);
+    }
+    if (!removed.empty()) {
+        for (const auto& name : removed) {
+            int index = bodies.findIndex(name);
+            if (index >= 0) {
+                bodies.removeBody(static_cast<std::size_t>(index));
+            }
+        }
+        // Drop the handles of the removed planets: their generation no longer matches the store
+        planets.erase(std::remove_if(planets.begin(), planets.end(), [](const Planet& planet) { return !planet.isValid(); }), planets.end());
+    }
+    for (const auto& record : ready) {
+        int index = bodies.findIndex(record.name);
+        if (index >= 0) {
+            updatePlanet(bodies, static_cast<std::size_t>(index), record, time);
+        } else {
+            planets.push_back(addPlanet(bodies, record)); // A new row
+        }
+    }
+    if (!ready.empty() || !removed.empty()) {
+        LOG_INFO("Applied %zu changed and %zu deleted planets", ready.size(), removed.size());
+    }
+    return ready.size() + removed.size();
+}
@@ -0,0 +1,45 @@
+/**
+ * This class applies the changes of the planets table to the running simulation, without reloading the catalog.
+ * A trigger on the table sends the name of every inserted, updated or deleted row on a notification channel (see the README).
+ * A background thread listens on its own connection, fetches only the changed rows by name, and queues them.
+ * The main loop calls poll() between two frames to apply them: changed planets are updated in place, new planets are added
+ * and deleted planets are removed from the store.
+ *
+ */
+
+#ifndef CATALOGLISTENER_HPP
+#define CATALOGLISTENER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BodyStore.hpp"
+#include "Database.hpp"
+#include "Planet.hpp"
+
+class CatalogListener {
+public:
+    // Constructor to start listening on the channel in the background
+    explicit CatalogListener(const std::string& connectionString, const std::string& channel = "planets_changed");
+    ~CatalogListener(); // Destructor to stop the background thread, it waits at most one polling interval
+
+    CatalogListener(const CatalogListener&) = delete; // The background thread uses this object, so it can't be copied
+    CatalogListener& operator=(const CatalogListener&) = delete;
+
+    // Function to apply the changes that have arrived, at simulated time "time", without waiting. It returns the number of planets changed, added or removed
+    std::size_t poll(BodyStore& bodies, std::vector<Planet>& planets, double time);
+
+private:
+    void run(const std::string& connectionString, const std::string& channel); // Function run by the background thread
+
+    std::mutex mutex; // Protects the queue
+    std::vector<PlanetRecord> changes; // Rows fetched but not applied yet
+    std::vector<std::string> removals; // Names of the deleted rows not applied yet
+    std::atomic<bool> stopping{false};
+    std::thread worker; // Declared last, so the thread starts after the other members are initialized
+};
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * Purpose: Implement the methods of the CatalogLoader class that are declared in the CatalogLoader.hpp header file.
+ *  The queue is protected by a mutex, which is held only to push or swap out whole batches, never while a row is read or a body is added.
+ *  The queue is bounded: the worker waits while it is full, so a catalog larger than the memory of the program streams through it.
+ *
+ * */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include "CatalogLoader.hpp"
+#include "CatalogSnapshot.hpp"
+#include "Log.hpp"
+
+// Largest number of batches waiting for the main thread, this bounds the memory used by a load of any size
+static const std::size_t maxQueuedBatches = 64;
+
+CatalogLoader::CatalogLoader(const std::string& connectionString, const std::string& snapshotPath, std::size_t batchSize)
+    : batchSize(batchSize == 0 ? 1 : batchSize), worker(&CatalogLoader::run, this, connectionString, snapshotPath) {
+}
+
+CatalogLoader::~CatalogLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all(); // Wake up the worker if it waits for room in the queue
+    worker.join(); // libpqxx can't cancel a query from another thread, so the destructor waits until the worker sees the flag
+}
+
+// Function to hand a batch to the main thread. When the main thread is behind, the worker waits, so at most maxQueuedBatches are in memory.
+bool CatalogLoader::queueBatch(std::vector<PlanetRecord>& batch) {
+    LOG_DEBUG("Loaded a batch of %zu planets", batch.size());
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return batches.size() < maxQueuedBatches || stopping; });
+        if (stopping) {
+            return false; // Nobody will take the batch anymore
+        }
+        batches.push_back(std::move(batch));
+    }
+    changed.notify_all();
+    batch.clear(); // The moved-from vector is reused for the next batch
+    return true;
+}
+
+/**
+ * This function is run by the worker thread. It decides where the planets come from:
+ * - the snapshot, if it was written from a table with the same fingerprint, or if the database can't be reached;
+ * - the table otherwise, and then the snapshot is rewritten with the fingerprint read before the rows.
+ * If the table changes between the fingerprint and the rows, the new snapshot has the old fingerprint and is simply rewritten at the next start.
+ *
+ * */
+void CatalogLoader::run(const std::string& connectionString, const std::string& snapshotPath) {
+    auto start = std::chrono::steady_clock::now();
+    CatalogSnapshot snapshot;
+    bool hasSnapshot = !snapshotPath.empty() && snapshot.open(snapshotPath);
+
+    std::unique_ptr<Database> db;
+    std::uint64_t fingerprint = 0;
+    bool hasFingerprint = false;
+    if (!connectionString.empty()) {
+        LOG_INFO("Connecting to the database");
+        db.reset(new Database(connectionString));
+        hasFingerprint = db->readFingerprint(fingerprint);
+    }
+
+    bool ok = true;
+    if (hasSnapshot && (!hasFingerprint || fingerprint == snapshot.getFingerprint())) {
+        if (!hasFingerprint) {
+            std::cerr << "The database can't be reached, the planets are loaded from the snapshot " << snapshotPath << std::endl;
+        }
+        LOG_INFO("Loading %zu planets from the snapshot %s", snapshot.size(), snapshotPath.c_str());
+        std::vector<PlanetRecord> batch;
+        for (std::size_t i = 0; i < snapshot.size(); ++i) {
+            batch.push_back(snapshot.record(i));
+            if (batch.size() >= batchSize && !queueBatch(batch)) {
+                break;
+            }
+        }
+        if (!batch.empty()) {
+            queueBatch(batch);
+        }
+    } else if (db) {
+        // Stream the table, and write the new snapshot while the records go by
+        std::unique_ptr<SnapshotWriter> writer;
+        if (!snapshotPath.empty() && hasFingerprint) {
+            writer.reset(new SnapshotWriter(snapshotPath));
+        }
+        ok = db->readPlanets(batchSize, [this, &writer](std::vector<PlanetRecord>& batch) {
+            if (writer) {
+                for (const auto& record : batch) {
+                    writer->add(record);
+                }
+            }
+            return queueBatch(batch);
+        });
+        if (ok && writer && writer->finish(fingerprint)) {
+            LOG_INFO("Wrote the snapshot %s", snapshotPath.c_str());
+        }
+    } else {
+        ok = false; // Neither a database nor a snapshot
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ok && !stopping) {
+            std::cerr << "Can't load the planets from the database" << std::endl;
+        }
+        done = true;
+        failed = !ok;
+        loadSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    }
+    changed.notify_all();
+}
+
+std::size_t CatalogLoader::addBatches(std::deque<std::vector<PlanetRecord>>& ready, BodyStore& bodies, std::vector<Planet>& planets, ThreadPool& pool) {
+    // Decode the new texture files on all threads first, so addPlanet finds them in the cache
+    std::vector<std::string> texturePaths;
+    for (const auto& batch : ready) {
+        for (const auto& record : batch) {
+            if (!record.texturePath.empty()) {
+                texturePaths.push_back(record.texturePath);
+            }
+        }
+    }
+    if (!texturePaths.empty()) {
+        bodies.textures.preload(texturePaths, pool);
+    }
+
+    std::size_t added = 0;
+    for (auto& batch : ready) {
+        for (const auto& record : batch) {
+            planets.push_back(addPlanet(bodies, record));
+        }
+        added += batch.size();
+    }
+    return added;
+}
+
+std::size_t CatalogLoader::poll(BodyStore& bodies, std::vector<Planet>& planets, ThreadPool& pool) {
+    std::deque<std::vector<PlanetRecord>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(batches); // Take everything at once, so the worker is never blocked while the bodies are added
+    }
+    changed.notify_all(); // The worker may be waiting for room in the queue
+    return addBatches(ready, bodies, planets, pool);
+}
+
+std::size_t CatalogLoader::wait(BodyStore& bodies, std::vector<Planet>& planets, ThreadPool& pool) {
+    std::size_t added = 0;
+    while (true) {
+        std::deque<std::vector<PlanetRecord>> ready;
+        bool finished;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return done || !batches.empty(); });
+            ready.swap(batches);
+            finished = done;
+        }
+        changed.notify_all();
+        added += addBatches(ready, bodies, planets, pool);
+        if (finished) {
+            return added; // The worker pushes its last batch before it sets done, so nothing is left
+        }
+    }
+}
+
+bool CatalogLoader::isFinished() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done && batches.empty();
+}
+
+bool CatalogLoader::hasFailed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+float CatalogLoader::getLoadSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return loadSeconds;
+}
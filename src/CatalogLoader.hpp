@@ -0,0 +1,65 @@
+/**
+ * This class loads the planets from the database on a background thread, so the window opens and renders before the database answers.
+ * The worker thread connects, runs the query and puts the rows into a queue in batches. The main loop calls poll() once per frame:
+ * it takes the batches that have arrived and adds them to the BodyStore, so the planets appear progressively while the rest is still loading.
+ * Only the main thread touches the BodyStore; the worker only sees PlanetRecords.
+ * The texture files of the new planets are decoded in parallel on a ThreadPool before the planets are added, each file once.
+ *
+ * With a snapshot file (see CatalogSnapshot.hpp), the worker compares the fingerprint of the table with the one of the snapshot.
+ * If they match, or if the database can't be reached, the planets are read from the snapshot instead of the table.
+ * Otherwise they are read from the table and the snapshot is written again.
+ *
+ */
+
+#ifndef CATALOGLOADER_HPP
+#define CATALOGLOADER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BodyStore.hpp"
+#include "Database.hpp"
+#include "Planet.hpp"
+#include "ThreadPool.hpp"
+
+class CatalogLoader {
+public:
+    // Constructor to start loading in the background. The connection string or the snapshot path can be empty.
+    // batchSize is the number of rows handed over at once.
+    CatalogLoader(const std::string& connectionString, const std::string& snapshotPath = "", std::size_t batchSize = 256);
+    ~CatalogLoader(); // Destructor to stop the worker thread. A running query can't be interrupted, so it waits for the next batch
+
+    CatalogLoader(const CatalogLoader&) = delete; // The worker thread uses this object, so it can't be copied
+    CatalogLoader& operator=(const CatalogLoader&) = delete;
+
+    // Function to add the batches that have arrived, without waiting. The textures are decoded on the pool. It returns the number of planets added
+    std::size_t poll(BodyStore& bodies, std::vector<Planet>& planets, ThreadPool& pool);
+    // Function to wait until everything is loaded and add it, used when nothing has to be drawn meanwhile
+    std::size_t wait(BodyStore& bodies, std::vector<Planet>& planets, ThreadPool& pool);
+
+    bool isFinished() const; // True when the worker is done and every batch has been added
+    bool hasFailed() const; // True if the connection or the query failed
+    float getLoadSeconds() const; // Time from the start to the last row read, in seconds, valid once finished
+
+private:
+    void run(const std::string& connectionString, const std::string& snapshotPath); // Function run by the worker thread
+    bool queueBatch(std::vector<PlanetRecord>& batch); // Function to hand a batch to the main thread, called by the worker. It returns false when the loader stops
+    // Function to add batches taken from the queue
+    std::size_t addBatches(std::deque<std::vector<PlanetRecord>>& ready, BodyStore& bodies, std::vector<Planet>& planets, ThreadPool& pool);
+
+    std::size_t batchSize;
+    mutable std::mutex mutex; // Protects the members below, up to the worker thread
+    std::condition_variable changed; // Signaled when a batch arrives or the worker is done
+    std::deque<std::vector<PlanetRecord>> batches; // Batches read but not added yet
+    bool done = false;
+    bool failed = false;
+    bool stopping = false; // Set by the destructor, the worker then stops at the next batch
+    float loadSeconds = 0.0f;
+    std::thread worker; // Declared last, so the thread starts after the other members are initialized
+};
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * Purpose: Implement the snapshot file declared in CatalogSnapshot.hpp.
+ *  The values are written and read in little-endian order (see ByteOrder.hpp), so a snapshot can be moved between machines.
+ *  The file is mapped into memory (see MappedFile.hpp), so opening a snapshot only costs the pages that are actually read.
+ *
+ * */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "CatalogSnapshot.hpp"
+#include "ByteOrder.hpp"
+
+static const char snapshotMagic[8] = {'S', 'O', 'L', 'A', 'R', 'C', 'A', 'T'};
+
+// Function to fill the header of a snapshot
+static void putHeader(unsigned char* out, std::size_t recordCount, std::uint64_t fingerprint, std::size_t namesSize) {
+    std::memset(out, 0, snapshotHeaderSize);
+    std::memcpy(out, snapshotMagic, sizeof(snapshotMagic));
+    putU32(out + 8, snapshotVersion);
+    putU32(out + 12, static_cast<std::uint32_t>(snapshotRecordSize));
+    putU64(out + 16, recordCount);
+    putU64(out + 24, fingerprint);
+    putU64(out + 32, snapshotHeaderSize + recordCount * snapshotRecordSize);
+    putU64(out + 40, namesSize);
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path)
+    : path(path), recordsPath(path + ".tmp"), namesPath(path + ".names.tmp"),
+      records(recordsPath, std::ios::binary | std::ios::trunc), names(namesPath, std::ios::binary | std::ios::trunc) {
+    unsigned char header[snapshotHeaderSize] = {};
+    records.write(reinterpret_cast<const char*>(header), sizeof(header)); // Placeholder, written again by finish()
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    records.close();
+    names.close();
+    std::remove(recordsPath.c_str()); // Nothing to remove after a successful finish()
+    std::remove(namesPath.c_str());
+}
+
+/**
+ * Layout of a record:
+ *   0 name offset in the string table (u32)   4 name length (u32)
+ *   8 radius   12 distance   16 orbit speed   20 rotation speed (floats)
+ *  24 color as 0xRRGGBBAA (u32)
+ *  28 position x   32 position y (floats)
+ *  36 eccentricity   40 inclination   44 argument of periapsis (floats)
+ *  48 mean anomaly (double)
+ *  56 parent name offset in the string table (u32)   60 parent name length (u32), 0 for no parent
+ *  64 texture path offset in the string table (u32)   68 texture path length (u32), 0 for no texture
+ *  72 mass (float)   76 reserved, 0
+ *
+ * */
+void SnapshotWriter::add(const PlanetRecord& record) {
+    unsigned char out[snapshotRecordSize];
+    putU32(out + 0, static_cast<std::uint32_t>(namesSize));
+    putU32(out + 4, static_cast<std::uint32_t>(record.name.size()));
+    putFloat(out + 8, record.radius);
+    putFloat(out + 12, record.distance);
+    putFloat(out + 16, record.orbitSpeed);
+    putFloat(out + 20, record.rotationSpeed);
+    putU32(out + 24, record.color.toInteger());
+    putFloat(out + 28, record.position.x);
+    putFloat(out + 32, record.position.y);
+    putFloat(out + 36, record.eccentricity);
+    putFloat(out + 40, record.inclination);
+    putFloat(out + 44, record.periapsisArgument);
+    putDouble(out + 48, record.meanAnomaly);
+    putU32(out + 56, static_cast<std::uint32_t>(namesSize + record.name.size()));
+    putU32(out + 60, static_cast<std::uint32_t>(record.parentName.size()));
+    putU32(out + 64, static_cast<std::uint32_t>(namesSize + record.name.size() + record.parentName.size()));
+    putU32(out + 68, static_cast<std::uint32_t>(record.texturePath.size()));
+    putFloat(out + 72, record.mass);
+    putU32(out + 76, 0);
+    records.write(reinterpret_cast<const char*>(out), sizeof(out));
+    names.write(record.name.data(), static_cast<std::streamsize>(record.name.size()));
+    names.write(record.parentName.data(), static_cast<std::streamsize>(record.parentName.size()));
+    names.write(record.texturePath.data(), static_cast<std::streamsize>(record.texturePath.size()));
+    namesSize += record.name.size() + record.parentName.size() + record.texturePath.size();
+    ++recordCount;
+}
+
+bool SnapshotWriter::finish(std::uint64_t fingerprint) {
+    // Append the string table after the records
+    names.close();
+    std::ifstream table(namesPath, std::ios::binary);
+    if (namesSize > 0) {
+        records << table.rdbuf();
+    }
+    table.close();
+
+    // Fill in the header now that the sizes are known
+    unsigned char header[snapshotHeaderSize];
+    putHeader(header, recordCount, fingerprint, namesSize);
+    records.seekp(0);
+    records.write(reinterpret_cast<const char*>(header), sizeof(header));
+    records.close();
+    if (!records) {
+        std::cerr << "Can't write the snapshot " << recordsPath << std::endl;
+        return false;
+    }
+    if (std::rename(recordsPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Can't replace the snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+CatalogSnapshot::~CatalogSnapshot() {
+    close();
+}
+
+void CatalogSnapshot::close() {
+    file.close();
+    data = nullptr;
+    length = 0;
+    recordCount = 0;
+}
+
+bool CatalogSnapshot::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false; // No snapshot yet
+    }
+    if (file.size() < snapshotHeaderSize) {
+        file.close();
+        return false;
+    }
+    data = file.data();
+    length = file.size();
+
+    // Check the header: a snapshot of another version or a truncated file is ignored
+    std::uint64_t count = getU64(data + 16);
+    std::uint64_t tableOffset = getU64(data + 32);
+    std::uint64_t tableSize = getU64(data + 40);
+    bool valid = std::memcmp(data, snapshotMagic, sizeof(snapshotMagic)) == 0
+                 && getU32(data + 8) == snapshotVersion
+                 && getU32(data + 12) == snapshotRecordSize
+                 && count <= (length - snapshotHeaderSize) / snapshotRecordSize
+                 && tableOffset == snapshotHeaderSize + count * snapshotRecordSize
+                 && tableSize == length - tableOffset;
+    if (!valid) {
+        std::cerr << "Ignoring the snapshot " << path << ": it is damaged or of another version" << std::endl;
+        close();
+        return false;
+    }
+    recordCount = static_cast<std::size_t>(count);
+    fingerprint = getU64(data + 24);
+    stringTableOffset = static_cast<std::size_t>(tableOffset);
+    stringTableSize = static_cast<std::size_t>(tableSize);
+    return true;
+}
+
+// Function to read a string of the string table. A damaged string is left empty instead of reading outside the file
+std::string CatalogSnapshot::readString(std::size_t offset, std::size_t length) const {
+    if (offset > stringTableSize || length > stringTableSize - offset) {
+        return std::string();
+    }
+    return std::string(reinterpret_cast<const char*>(data + stringTableOffset + offset), length);
+}
+
+PlanetRecord CatalogSnapshot::record(std::size_t index) const {
+    const unsigned char* in = data + snapshotHeaderSize + index * snapshotRecordSize;
+    PlanetRecord record;
+    record.name = readString(getU32(in + 0), getU32(in + 4));
+    record.parentName = readString(getU32(in + 56), getU32(in + 60));
+    record.texturePath = readString(getU32(in + 64), getU32(in + 68));
+    record.radius = getFloat(in + 8);
+    record.distance = getFloat(in + 12);
+    record.orbitSpeed = getFloat(in + 16);
+    record.rotationSpeed = getFloat(in + 20);
+    record.color = sf::Color(getU32(in + 24));
+    record.position = sf::Vector2f(getFloat(in + 28), getFloat(in + 32));
+    record.eccentricity = getFloat(in + 36);
+    record.inclination = getFloat(in + 40);
+    record.periapsisArgument = getFloat(in + 44);
+    record.meanAnomaly = getDouble(in + 48);
+    record.mass = getFloat(in + 72);
+    return record;
+}
@@ -0,0 +1,86 @@
+/**
+ * This file declares the binary snapshot of the planets table, used to start without waiting for PostgreSQL.
+ * The file is mapped into memory and read in place, there is no text to parse:
+ *
+ *   header (64 bytes): magic "SOLARCAT", format version, record size, record count, fingerprint of the table,
+ *                      offset and size of the string table
+ *   records:           one fixed-size record (snapshotRecordSize bytes) per planet, in the order of the table
+ *   string table:      the names of the planets and of their parents and the paths of their textures, one after the other, without terminating zeros
+ *
+ * All numbers are little-endian, whatever the processor. The fingerprint is computed by the database (see Database::readFingerprint):
+ * when it doesn't match the table anymore, the snapshot is stale and is written again from the database.
+ *
+ */
+
+#ifndef CATALOGSNAPSHOT_HPP
+#define CATALOGSNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Database.hpp"
+#include "MappedFile.hpp"
+
+// Version of the file format. It must be incremented when the records or the units of their values change, so old snapshots are rewritten.
+const std::uint32_t snapshotVersion = 4;
+// Size of the header and of one record, in bytes
+const std::size_t snapshotHeaderSize = 64;
+const std::size_t snapshotRecordSize = 80;
+
+/**
+ * This class writes a snapshot one record at a time, so the catalog never has to be held in memory.
+ * The records go to a temporary file and the names to a second one; finish() appends the names, fills in the header and renames the file,
+ * so a program that has the old snapshot mapped keeps reading a complete file.
+ */
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path); // Constructor to create the temporary files
+    ~SnapshotWriter(); // Destructor to delete the temporary files if finish() wasn't called or failed
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    void add(const PlanetRecord& record); // Function to append a record
+    bool finish(std::uint64_t fingerprint); // Function to complete the file and replace the old snapshot, returns false on error
+
+private:
+    std::string path;
+    std::string recordsPath; // Temporary file with the header and the records, renamed to path at the end
+    std::string namesPath; // Temporary file with the string table
+    std::ofstream records;
+    std::ofstream names;
+    std::size_t recordCount = 0;
+    std::size_t namesSize = 0;
+};
+
+class CatalogSnapshot {
+public:
+    CatalogSnapshot() = default;
+    ~CatalogSnapshot(); // Destructor to unmap the file
+
+    CatalogSnapshot(const CatalogSnapshot&) = delete; // The mapping belongs to one object
+    CatalogSnapshot& operator=(const CatalogSnapshot&) = delete;
+
+    // Function to map a snapshot file and check its header and size. It returns false if the file is missing, damaged or of another version.
+    bool open(const std::string& path);
+
+    std::size_t size() const { return recordCount; } // Number of planets in the snapshot
+    std::uint64_t getFingerprint() const { return fingerprint; } // Fingerprint of the table the snapshot was written from
+    PlanetRecord record(std::size_t index) const; // Function to decode one record
+
+private:
+    void close(); // Function to unmap the file
+    std::string readString(std::size_t offset, std::size_t length) const; // Function to read a string of the string table
+
+    MappedFile file;
+    const unsigned char* data = nullptr; // Start of the mapped file
+    std::size_t length = 0; // Size of the mapped file in bytes
+    std::size_t recordCount = 0;
+    std::uint64_t fingerprint = 0;
+    std::size_t stringTableOffset = 0;
+    std::size_t stringTableSize = 0;
+};
+
+#endif
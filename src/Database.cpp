@@ -1,5 +1,8 @@
 #include "Database.hpp"
 #include <iostream>
+#include <optional>
+#include <set>
+#include <tuple>
 #define _USE_MATH_DEFINES
 #include <cmath>
 
@@ -13,6 +16,49 @@ sf::Color intToColor(int color) {
     return sf::Color(r, g, b);
 }
 
+// Factor to control the speed of the simulation, applied to the orbit and rotation speeds
+static const float timeFactor = 2 * M_PI / 5.0f;
+// The angles of the orbital elements are stored in degrees
+static const double degreesToRadians = M_PI / 180.0;
+
+// Columns of the planets table that every row has, in the column order of PlanetRow
+static const char* requiredColumns = "name, radius, distance, orbit_speed, rotation_speed, color, position_x, position_y";
+// Columns added by later versions, with the type of their NULL when an older table doesn't have them. They are read as NULL: circular orbit, no parent, no texture, no mass
+static const std::pair<const char*, const char*> optionalColumns[] = {
+    {"eccentricity", "float8"}, {"inclination", "float8"}, {"arg_periapsis", "float8"}, {"mean_anomaly", "float8"},
+    {"parent", "text"}, {"texture_path", "text"}, {"mass", "float8"}};
+
+/**
+ * This function builds the query of the planets from the columns that the table really has, so a table created before the orbital elements,
+ * the parents, the textures or the masses still loads. A missing column is replaced by a NULL of its type and reported once;
+ * README.md shows the ALTER TABLE that adds it.
+ *
+ * */
+static std::string buildPlanetsQuery(pqxx::connection& connection, bool& complete) {
+    std::set<std::string> present;
+    pqxx::work W(connection);
+    const std::string columnsQuery = "SELECT column_name FROM information_schema.columns "
+                                     "WHERE table_name = 'planets' AND table_schema = ANY(current_schemas(false))";
+    pqxx::result R = W.exec(columnsQuery);
+    W.commit();
+    for (const auto& row : R) {
+        present.insert(row[0].as<std::string>());
+    }
+
+    std::string query = std::string("SELECT ") + requiredColumns;
+    complete = true;
+    for (const auto& column : optionalColumns) {
+        if (present.count(column.first)) {
+            query += std::string(", ") + column.first;
+        } else {
+            query += std::string(", NULL::") + column.second + " AS " + column.first;
+            std::cerr << "The planets table has no column " << column.first << ", it is read as NULL" << std::endl;
+            complete = false;
+        }
+    }
+    return query + " FROM planets";
+}
+
 // Constructor to initialize(represent) the database connection and provide functionality to load planets from the database.
 Database::Database(const std::string& connectionString){ // This constructor takes a single parameter, const std::string& connectionString, which is a string containing the connection details for the PostgreSQL database.
     try{
@@ -21,6 +67,13 @@ Database::Database(const std::string& connectionString){ // This constructor tak
             if(!db->is_open()){
                std::cerr << "Can't open database" << std::endl;
             }
+            // Statements that run more than once are parsed and planned only once by the server.
+            // Every row is hashed as text, with all its columns, and the hashes are summed so the order of the rows doesn't matter
+            db->prepare("planet_fingerprint", "SELECT count(*), "
+                        "COALESCE(sum(hashtextextended(p::text, 0)) % 9223372036854775807, 0)::bigint FROM planets p");
+            planetsQuery = buildPlanetsQuery(*db, allColumns);
+            db->prepare("planets", planetsQuery);
+            db->prepare("planet_by_name", planetsQuery + " WHERE name = $1");
         } catch (const std::exception &e){ // for example, if the connection string is invalid or the database server is not running.
             std::cerr << e.what() << std::endl; // output the error message to the standard error stream.
         }
@@ -29,42 +82,251 @@ Database::Database(const std::string& connectionString){ // This constructor tak
 
 // Destructor to close the database connection
 Database::~Database(){
-    db->disconnect(); // Disconnect from the database
-    delete db; // Delete the database connection object
+    if (db) { // The connection doesn't exist if the constructor failed
+        db->disconnect(); // Disconnect from the database
+        delete db; // Delete the database connection object
+    }
 }
 
-// Function to load planets from the database
-std::vector<Planet> Database::loadPlanets(){
-    std::vector<Planet> planets; // Create a vector to store the loaded planets: std::vector is a dynamic array that can grow or shrink in size.
-    try {
-        pqxx::work W(*db); // Start a database transaction using the connection object
-        std::string query = "SELECT name, radius, distance, orbit_speed, rotation_speed, color, position_x, position_y FROM planets"; // SQL query to select all planets from the database
-        pqxx::result R = W.exec(query); // Execute the query and store the result in R
+/**
+ * One row of the planets stream. The columns are read by position, in the order of planetsQuery, and converted straight from the COPY text.
+ * The orbital elements are optional: a NULL is read as a circular orbit. A NULL parent means the planet orbits the world origin, a NULL texture path that it has no texture,
+ * a NULL mass that it doesn't attract the other bodies in the N-body mode.
+ *
+ * */
+typedef std::tuple<std::string, float, float, float, float, int, float, float,
+                   std::optional<double>, std::optional<double>, std::optional<double>, std::optional<double>, std::optional<std::string>, std::optional<std::string>,
+                   std::optional<double>> PlanetRow;
 
-        float timeFactor = 2 * M_PI / 5.0f; // Factor to control the speed of the simulation
+// Function to convert a row of the planets table to the units of the simulation
+static PlanetRecord toRecord(PlanetRow& row) {
+    PlanetRecord record;
+    record.name = std::move(std::get<0>(row));
+    record.radius = std::get<1>(row);
+    record.distance = std::get<2>(row);
+    record.orbitSpeed = std::get<3>(row) * timeFactor; // Multiply the orbit speed by the time factor
+    record.rotationSpeed = std::get<4>(row) * timeFactor; // Multiply the rotation speed by the time factor
+    record.color = intToColor(std::get<5>(row));
+    record.position = sf::Vector2f(std::get<6>(row), std::get<7>(row)); // 2D vector representing the position of the planet
 
-        // Iterate over the result set and create a Planet object for each row
-        for(auto row : R){
-            // Extract the values from the row
-            std::string name = row["name"].c_str();
-            float radius = row["radius"].as<float>();
-            float distance = row["distance"].as<float>();
-            float orbitSpeed = row["orbit_speed"].as<float>() * timeFactor; // Multiply the orbit speed by the time factor
-            float rotationSpeed = row["rotation_speed"].as<float>() * timeFactor; // Multiply the rotation speed by the time factor
-            int colorInt = row["color"].as<int>();
-            sf::Color color = intToColor(colorInt);
+    // Shape of the orbit
+    record.eccentricity = static_cast<float>(std::get<8>(row).value_or(0.0));
+    record.inclination = static_cast<float>(std::get<9>(row).value_or(0.0) * degreesToRadians);
+    record.periapsisArgument = static_cast<float>(std::get<10>(row).value_or(0.0) * degreesToRadians);
+    record.meanAnomaly = std::get<11>(row).value_or(0.0) * degreesToRadians;
+    record.parentName = std::get<12>(row).value_or("");
+    record.texturePath = std::get<13>(row).value_or("");
+    record.mass = static_cast<float>(std::get<14>(row).value_or(0.0));
+    return record;
+}
+
+// Function to read an optional column of a row
+static std::optional<double> optionalColumn(const pqxx::field& field) {
+    if (field.is_null()) {
+        return std::nullopt;
+    }
+    return field.as<double>();
+}
 
-            float position_X = row["position_x"].as<float>();
-            float position_Y = row["position_y"].as<float>();
+static std::optional<std::string> optionalText(const pqxx::field& field) {
+    if (field.is_null()) {
+        return std::nullopt;
+    }
+    return field.as<std::string>();
+}
 
-            sf::Vector2f position(position_X, position_Y); // Create a 2D vector representing the position of the planet
+// Function to convert a row of a materialized result, in the column order of the query
+static PlanetRecord toRecord(const pqxx::row& r) {
+    PlanetRow row(r[0].as<std::string>(), r[1].as<float>(), r[2].as<float>(), r[3].as<float>(), r[4].as<float>(), r[5].as<int>(),
+                  r[6].as<float>(), r[7].as<float>(), optionalColumn(r[8]), optionalColumn(r[9]), optionalColumn(r[10]), optionalColumn(r[11]),
+                  optionalText(r[12]), optionalText(r[13]), optionalColumn(r[14]));
+    return toRecord(row);
+}
 
-            planets.emplace_back(name, radius, distance, orbitSpeed, rotationSpeed, color, sf::Vector2f(position_X, position_Y)); // Create a new Planet object and add it to the vector of planets
+/**
+ * This function reads the planets with COPY ... TO STDOUT through pqxx::stream_from, instead of materializing a pqxx::result:
+ * the rows arrive one by one and only the current batch is kept in memory, however large the table is.
+ * COPY can't run a prepared statement, so the query is sent as text; it is only parsed once per load anyway.
+ *
+ * */
+bool Database::readPlanets(std::size_t batchSize, const std::function<bool(std::vector<PlanetRecord>&)>& onBatch){
+    if (!isOpen()) {
+        return false;
+    }
+    std::vector<PlanetRecord> batch; // Records that haven't been handed to onBatch yet
+    batch.reserve(batchSize);
+    try {
+        pqxx::work W(*db); // Start a database transaction using the connection object
+#if PQXX_VERSION_MAJOR >= 7
+        auto stream = pqxx::stream_from::query(W, planetsQuery);
+#else
+        if (!allColumns) {
+            // libpqxx 6 can only stream the columns that the table has: an older table is read in one result, with NULL for the missing columns
+            pqxx::result R = W.exec_prepared("planets");
+            W.commit();
+            for (const auto& r : R) {
+                batch.push_back(toRecord(r));
+                if (batch.size() >= batchSize) {
+                    if (!onBatch(batch)) {
+                        return false;
+                    }
+                    batch.clear();
+                }
+            }
+            return batch.empty() || onBatch(batch);
         }
+        // libpqxx 6 can only stream a table, with the columns in the order given
+        const std::vector<std::string> columns = {"name", "radius", "distance", "orbit_speed", "rotation_speed", "color", "position_x", "position_y",
+                                                  "eccentricity", "inclination", "arg_periapsis", "mean_anomaly", "parent", "texture_path", "mass"};
+        pqxx::stream_from stream(W, "planets", columns);
+#endif
+        PlanetRow row;
+        while (stream >> row) {
+            batch.push_back(toRecord(row));
+            if (batch.size() >= batchSize) {
+                if (!onBatch(batch)) {
+                    return false; // The caller doesn't want more rows: the stream and the transaction are closed by their destructors
+                }
+                batch.clear();
+            }
+        }
+        stream.complete();
         W.commit(); // Commit the transaction
     } catch (const std::exception &e) { // Catch any exceptions that occur during the database operation
         std::cerr << e.what() << std::endl; // Output the error message to the standard error stream
+        return false;
+    }
+    if (!batch.empty()) {
+        return onBatch(batch); // The last, incomplete batch
+    }
+    return true;
+}
+
+// Function to compute the fingerprint of the planets table
+bool Database::readFingerprint(std::uint64_t& fingerprint){
+    if (!isOpen()) {
+        return false;
+    }
+    try {
+        pqxx::work W(*db);
+        pqxx::result R = W.exec_prepared("planet_fingerprint");
+        W.commit();
+        std::uint64_t rowCount = R[0][0].as<long long>();
+        std::uint64_t rowHash = R[0][1].as<long long>();
+        fingerprint = rowHash ^ (rowCount * 0x9E3779B97F4A7C15ull); // Mix in the number of rows
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
     }
+    return true;
+}
+
+// Function to read the rows of some planets with the prepared statement, in one transaction
+bool Database::readPlanetsByName(const std::vector<std::string>& names, std::vector<PlanetRecord>& records){
+    if (!isOpen()) {
+        return false;
+    }
+    try {
+        pqxx::work W(*db);
+        for (const auto& name : names) {
+            pqxx::result R = W.exec_prepared("planet_by_name", name);
+            if (R.empty()) {
+                continue; // The row was deleted
+            }
+            records.push_back(toRecord(R[0]));
+        }
+        W.commit();
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Receiver that collects the payloads of the notifications of one channel
+class PayloadReceiver : public pqxx::notification_receiver {
+public:
+    PayloadReceiver(pqxx::connection& connection, const std::string& channel, std::vector<std::string>& payloads)
+        : pqxx::notification_receiver(connection, channel), payloads(payloads) {
+    }
+
+    void operator()(const std::string& payload, int) override {
+        payloads.push_back(payload);
+    }
+
+private:
+    std::vector<std::string>& payloads;
+};
+
+// Function to subscribe to a channel: libpqxx sends LISTEN when the receiver is created
+bool Database::listen(const std::string& channel){
+    if (!isOpen()) {
+        return false;
+    }
+    try {
+        receiver.reset(new PayloadReceiver(*db, channel, notifications));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> Database::awaitNotifications(long timeoutMilliseconds){
+    // Wait for the first notification, then take the ones that arrived with it without waiting again
+    if (db->await_notification(timeoutMilliseconds / 1000, (timeoutMilliseconds % 1000) * 1000) > 0) {
+        db->get_notifs();
+    }
+    std::vector<std::string> payloads;
+    payloads.swap(notifications);
+    return payloads;
+}
 
-    return planets; // Return the vector of loaded planets
-}
\ No newline at end of file
+// Function to add a planet to the store
+Planet addPlanet(BodyStore& bodies, const PlanetRecord& record){
+    std::size_t index = bodies.addBody(record.name, record.radius, record.distance, record.orbitSpeed, record.rotationSpeed,
+                                       record.color, record.position); // Add the planet to the store
+    Planet planet(bodies, index); // Create a handle to the new planet
+    planet.setOrbitElements(record.eccentricity, record.inclination, record.periapsisArgument, record.meanAnomaly);
+    planet.setMass(record.mass);
+    if (!record.texturePath.empty()) {
+        planet.setTexture(record.texturePath); // Shared with the other planets that use the same file
+    }
+    if (!record.parentName.empty()) {
+        planet.setOrbitingPlanet(record.parentName); // Resolved in constant time, or as soon as the parent is added
+    }
+    return planet;
+}
+
+/**
+ * This function applies a changed row to a planet that is already simulated.
+ * setOrbitElements sets the phase to the mean anomaly of the row, which would move the planet to another point of its orbit.
+ * The phase is kept instead, with only the change of the mean anomaly in the row added on top of it, so the planet only jumps
+ * when the operator asks for it. The speeds are set last: BodyStore::setOrbitSpeed and setRotationSpeed keep the planet where it is
+ * and turned the way it is at this time.
+ *
+ * */
+void updatePlanet(BodyStore& bodies, std::size_t index, const PlanetRecord& record, double time){
+    double anomalyShift = record.meanAnomaly - bodies.meanAnomaly[index];
+    double phase = bodies.phase[index] + anomalyShift;
+    float angle = bodies.angle[index] + static_cast<float>(anomalyShift); // For the stepped orbits
+
+    Planet planet(bodies, index);
+    planet.setRadius(record.radius);
+    planet.setDistance(record.distance / 10); // The distances are scaled down like in BodyStore::addBody
+    planet.setColor(record.color);
+    planet.setMass(record.mass);
+    planet.setOrbitElements(record.eccentricity, record.inclination, record.periapsisArgument, record.meanAnomaly);
+    bodies.phase[index] = phase;
+    bodies.angle[index] = angle;
+    planet.setOrbitSpeed(record.orbitSpeed, time);
+    planet.setRotationSpeed(record.rotationSpeed, time);
+    if (record.texturePath != bodies.textures.getPath(bodies.texture[index])) {
+        planet.setTexture(record.texturePath);
+    }
+
+    int parentIndex = record.parentName.empty() ? -1 : bodies.findIndex(record.parentName);
+    if (parentIndex != bodies.parent[index] || (parentIndex < 0 && !record.parentName.empty())) {
+        planet.setOrbitingPlanet(record.parentName);
+    }
+}
@@ -8,22 +8,72 @@
 #ifndef DATABASE_HPP
 #define DATABASE_HPP
 
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include <pqxx/pqxx> // Include the PostgreSQL library
 #include "Planet.hpp" // Include the Planet class header file: It is like an interface class in Java
 
+// One row of the planets table, already converted to the units of the simulation (speeds scaled, angles in radians)
+struct PlanetRecord {
+    std::string name;
+    float radius = 0.0f;
+    float distance = 0.0f;
+    float orbitSpeed = 0.0f;
+    float rotationSpeed = 0.0f;
+    sf::Color color;
+    sf::Vector2f position;
+    float eccentricity = 0.0f;
+    float inclination = 0.0f;
+    float periapsisArgument = 0.0f;
+    double meanAnomaly = 0.0;
+    std::string parentName; // Name of the body it orbits, empty for the world origin
+    std::string texturePath; // Image file mapped on the body, empty for a plain color
+    float mass = 0.0f; // Mass for the N-body mode, 0 when the column is NULL
+};
+
 class Database {
 public:
     Database(const std::string& connectionString); // Constructor to initialize the database connection
     ~Database(); // Destructor to close the database connection
 
-    std::vector<Planet> loadPlanets(); // Function to load planets from the database
+    bool isOpen() const { return db && db->is_open(); } // True if the connection was made
+
+    // Function to stream all planets from the database. The rows are handed to onBatch in groups of at most batchSize records,
+    // and the reading stops early if onBatch returns false. It doesn't touch a BodyStore, so it can run on another thread than the simulation.
+    // It returns true if every row was read.
+    bool readPlanets(std::size_t batchSize, const std::function<bool(std::vector<PlanetRecord>&)>& onBatch);
+
+    // Function to compute a fingerprint of the planets table on the server: it changes when a row is added, removed or modified.
+    // Only two numbers are sent back, so it is much faster than reading the table. It returns false on error.
+    bool readFingerprint(std::uint64_t& fingerprint);
+
+    // Function to read the current rows of some planets, by name. A name without a row (a deleted planet) is skipped. It returns false on error.
+    bool readPlanetsByName(const std::vector<std::string>& names, std::vector<PlanetRecord>& records);
+
+    // Functions for live updates. listen() subscribes the connection to a notification channel, then awaitNotifications() waits
+    // at most timeoutMilliseconds for notifications and returns their payloads. A lost connection throws pqxx::broken_connection.
+    bool listen(const std::string& channel);
+    std::vector<std::string> awaitNotifications(long timeoutMilliseconds);
 
 private:
-    pqxx::connection* db; // Pointer to the database connection object
+    pqxx::connection* db = nullptr; // Pointer to the database connection object, nullptr if the connection failed
+    std::string planetsQuery; // Query of the planets, built from the columns that the table has
+    bool allColumns = true; // False if the table lacks some optional columns, which are then read as NULL
+    std::unique_ptr<pqxx::notification_receiver> receiver; // Receives the notifications of the channel passed to listen()
+    std::vector<std::string> notifications; // Payloads received but not returned by awaitNotifications() yet
 };
 
+// Function to add a planet read from the database to the store, it returns a handle to the new planet
+Planet addPlanet(BodyStore& bodies, const PlanetRecord& record);
+// Function to apply a changed row to a planet of the store while the simulation is running, at simulated time "time".
+// The planet continues from where it is: a new orbit speed doesn't make it jump along its orbit.
+void updatePlanet(BodyStore& bodies, std::size_t index, const PlanetRecord& record, double time);
+
 
 
 
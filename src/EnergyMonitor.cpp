@@ -0,0 +1,153 @@
+/**
+ * Purpose: Implement the methods of the EnergyMonitor class that are declared in the EnergyMonitor.hpp header file.
+ *  The sums are made in double around the center of mass, so a system far from the origin doesn't lose the digits of its small motions.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include "EnergyMonitor.hpp"
+#include "BarnesHutTree.hpp"
+#include "Log.hpp"
+
+// Largest number of bodies whose potential energy is summed over all pairs, above this the tree is used
+static const std::size_t maxDirectBodies = 4096;
+// Largest opening angle of the tree for the potential energy: the error of the check must stay below the drift it looks for
+static const float maxCheckTheta = 0.3f;
+
+EnergyMonitor::EnergyMonitor(double gravity, float theta, float softening)
+    : gravity(gravity), theta(theta), softening(softening), worker(&EnergyMonitor::run, this) {
+}
+
+EnergyMonitor::~EnergyMonitor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_one();
+    worker.join();
+}
+
+bool EnergyMonitor::submit(const double* x, const double* y, const double* vx, const double* vy, const float* mass, std::size_t count, double time) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (busy) {
+            return false; // Still checking the previous copy: skip this one rather than wait
+        }
+        // The thread is waiting, so the copy can be written without racing with it
+        this->x.clear(); this->y.clear(); this->vx.clear(); this->vy.clear(); this->mass.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (mass[i] > 0.0f) {
+                this->x.push_back(x[i]);
+                this->y.push_back(y[i]);
+                this->vx.push_back(vx[i]);
+                this->vy.push_back(vy[i]);
+                this->mass.push_back(mass[i]);
+            }
+        }
+        checkTime = time;
+        checkedGeneration = generation;
+        busy = true;
+    }
+    workAvailable.notify_one();
+    return true;
+}
+
+void EnergyMonitor::restart() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++generation;
+}
+
+void EnergyMonitor::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    workFinished.wait(lock, [this] { return !busy; });
+}
+
+EnergyReport EnergyMonitor::getReport() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return report;
+}
+
+void EnergyMonitor::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        workAvailable.wait(lock, [this] { return busy || stopping; });
+        if (!busy) {
+            return; // Stopping, with no check left
+        }
+        lock.unlock();
+        check(); // Without the lock: submit() doesn't touch the copy while busy is set
+        lock.lock();
+        busy = false;
+        workFinished.notify_all();
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void EnergyMonitor::check() {
+    std::size_t count = mass.size();
+    // Center of mass and its velocity
+    double totalMass = 0.0, centerX = 0.0, centerY = 0.0, centerVX = 0.0, centerVY = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        totalMass += mass[i];
+        centerX += mass[i] * x[i];
+        centerY += mass[i] * y[i];
+        centerVX += mass[i] * vx[i];
+        centerVY += mass[i] * vy[i];
+    }
+    if (totalMass > 0.0) {
+        centerX /= totalMass; centerY /= totalMass; centerVX /= totalMass; centerVY /= totalMass;
+    }
+
+    // Kinetic energy and angular momentum. The kinetic energy includes the motion of the center of mass, which is conserved too
+    double kinetic = 0.0, angularMomentum = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        kinetic += 0.5 * mass[i] * (vx[i] * vx[i] + vy[i] * vy[i]);
+        angularMomentum += mass[i] * ((x[i] - centerX) * (vy[i] - centerVY) - (y[i] - centerY) * (vx[i] - centerVX));
+    }
+
+    // Potential energy with the softened potential that matches the softened force
+    double potential = 0.0;
+    if (count <= maxDirectBodies) {
+        double softening2 = static_cast<double>(softening) * softening;
+        for (std::size_t i = 0; i < count; ++i) {
+            double sum = 0.0;
+            for (std::size_t j = i + 1; j < count; ++j) {
+                double dx = x[j] - x[i];
+                double dy = y[j] - y[i];
+                double d2 = dx * dx + dy * dy + softening2;
+                if (d2 > 0.0) {
+                    sum += mass[j] / std::sqrt(d2);
+                }
+            }
+            potential -= gravity * mass[i] * sum;
+        }
+    } else {
+        tree.build(x.data(), y.data(), mass.data(), count, pool);
+        potential = tree.potentialEnergy(std::min(theta, maxCheckTheta), softening, gravity, pool);
+    }
+    double energy = kinetic + potential;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (report.samples == 0 || checkedGeneration != reportGeneration) {
+        // First check after a restart: the reference values
+        report = EnergyReport();
+        firstEnergy = energy;
+        firstAngularMomentum = angularMomentum;
+        reportGeneration = checkedGeneration;
+    }
+    ++report.samples;
+    report.bodies = count;
+    report.time = checkTime;
+    report.energy = energy;
+    report.angularMomentum = angularMomentum;
+    // Relative to the reference, or absolute when the reference is 0 (a system at rest, or a single body)
+    report.energyDrift = (energy - firstEnergy) / (firstEnergy != 0.0 ? std::abs(firstEnergy) : 1.0);
+    report.angularMomentumDrift = (angularMomentum - firstAngularMomentum) / (firstAngularMomentum != 0.0 ? std::abs(firstAngularMomentum) : 1.0);
+    report.maxEnergyDrift = std::max(report.maxEnergyDrift, std::abs(report.energyDrift));
+    report.maxAngularMomentumDrift = std::max(report.maxAngularMomentumDrift, std::abs(report.angularMomentumDrift));
+    LOG_DEBUG("N-body check at t=%.3f: %zu bodies, energy %.9g (drift %.3g), angular momentum %.9g (drift %.3g)", checkTime, count,
+              energy, report.energyDrift, angularMomentum, report.angularMomentumDrift);
+}
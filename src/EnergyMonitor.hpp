@@ -0,0 +1,77 @@
+/**
+ * This class checks the N-body mode on a background thread: it calculates the total energy (kinetic + potential) and the angular momentum
+ * of the bodies now and then, and how far they have drifted from their values at the start. Both are conserved by the real motion,
+ * so their drift measures the error of the integrator and of the time step: a time step is safe as long as the drift stays small and doesn't grow.
+ *
+ * The main thread hands over a copy of the bodies that have a mass (the others have no energy) when the thread is idle, and never waits for it.
+ * The potential energy is summed over all pairs for up to a few thousand bodies, and approximated with a BarnesHutTree above that;
+ * the error of the tree then sets the smallest drift that can be seen.
+ *
+ */
+
+#ifndef ENERGYMONITOR_HPP
+#define ENERGYMONITOR_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BarnesHutTree.hpp"
+#include "ThreadPool.hpp"
+
+// Result of the last check. The drifts are relative to the first check after the last restart: (value - first) / |first|
+struct EnergyReport {
+    std::size_t samples = 0; // Number of checks since the last restart
+    std::size_t bodies = 0; // Number of bodies with a mass in the last check
+    double time = 0.0; // Simulated time of the last check
+    double energy = 0.0;
+    double angularMomentum = 0.0; // Around the center of mass, perpendicular to the screen
+    double energyDrift = 0.0;
+    double angularMomentumDrift = 0.0;
+    double maxEnergyDrift = 0.0; // Largest absolute drift since the last restart
+    double maxAngularMomentumDrift = 0.0;
+};
+
+class EnergyMonitor {
+public:
+    // Constructor to start the thread, with the constant, the opening angle and the softening of the forces
+    EnergyMonitor(double gravity, float theta, float softening);
+    ~EnergyMonitor(); // Destructor to stop the thread, it finishes the check in progress first
+
+    EnergyMonitor(const EnergyMonitor&) = delete; // The thread uses this object, so it can't be copied
+    EnergyMonitor& operator=(const EnergyMonitor&) = delete;
+
+    // Function to start a check of the bodies at a simulated time. It returns false without copying anything if the previous check isn't finished
+    bool submit(const double* x, const double* y, const double* vx, const double* vy, const float* mass, std::size_t count, double time);
+    void restart(); // Function to take the next check as the new reference, after a jump in time or when bodies were added
+    void wait(); // Function to wait until the check in progress is finished
+    EnergyReport getReport(); // Function to get the result of the last check
+
+private:
+    void run(); // Function run by the background thread
+    void check(); // Function to calculate the energy and the angular momentum of the copied bodies
+
+    double gravity;
+    float theta;
+    float softening;
+    std::mutex mutex; // Protects the flags and the report. The copy belongs to the thread while busy is set
+    std::condition_variable workAvailable;
+    std::condition_variable workFinished;
+    bool busy = false;
+    bool stopping = false;
+    std::size_t generation = 0; // Incremented by restart()
+    std::size_t checkedGeneration = 0; // Generation of the copy being checked
+    std::size_t reportGeneration = 0; // Generation of the reference values in the report
+    double checkTime = 0.0;
+    std::vector<double> x, y, vx, vy; // Copy of the bodies with a mass
+    std::vector<float> mass;
+    ThreadPool pool{1}; // Only the thread of the monitor (the pool of the simulation is busy with the next steps), for the tree of the large checks
+    BarnesHutTree tree; // Kept from check to check, so its arrays are only allocated once
+    double firstEnergy = 0.0; // Reference values
+    double firstAngularMomentum = 0.0;
+    EnergyReport report;
+    std::thread worker; // Declared last, so the thread starts after the other members are initialized
+};
+
+#endif
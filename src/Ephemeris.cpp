@@ -0,0 +1,462 @@
+/**
+ * Purpose: Implement the ephemeris declared in Ephemeris.hpp: reading the table, and fitting it from a motion model.
+ *  A sum of Chebyshev polynomials is evaluated with the Clenshaw recurrence: b(k) = 2 * tau * b(k + 1) - b(k + 2) + c(k), from the last coefficient down,
+ *  then x = tau * b(1) - b(2) + c(0). It needs no cosines and is stable at any degree.
+ *  The model is sampled at evenly spaced times (a model that is stepped can't jump to the Chebyshev nodes), and every piece is fitted by least squares
+ *  to twice as many samples as it has coefficients. The matrix of the least squares only depends on the number of pieces, so it is calculated once.
+ *
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include "Ephemeris.hpp"
+#include "ByteOrder.hpp"
+#include "Log.hpp"
+
+static const char ephemerisMagic[8] = {'S', 'O', 'L', 'A', 'R', 'E', 'P', 'H'};
+// Size of the header and of one entry of the body table, in bytes
+static const std::size_t ephemerisHeaderSize = 64;
+static const std::size_t ephemerisBodySize = 8;
+
+// Function to evaluate c[0] * T0(tau) + ... + c[count - 1] * T(count - 1)(tau) with the Clenshaw recurrence
+static double chebyshevSum(const double* c, std::size_t count, double tau) {
+    double b1 = 0.0, b2 = 0.0;
+    for (std::size_t k = count - 1; k > 0; --k) {
+        double b0 = 2.0 * tau * b1 - b2 + c[k];
+        b2 = b1;
+        b1 = b0;
+    }
+    return tau * b1 - b2 + c[0];
+}
+
+// Function to evaluate the x and the y of a piece together: the two recurrences are independent, so the processor runs them side by side.
+// in points to the count x coefficients followed by the count y coefficients, in the file
+static sf::Vector2<double> chebyshevPosition(const unsigned char* in, std::size_t count, double tau) {
+    const unsigned char* inY = in + count * sizeof(double);
+    double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+    double twoTau = 2.0 * tau;
+    for (std::size_t k = count - 1; k > 0; --k) {
+        double x0 = twoTau * x1 - x2 + getDouble(in + k * sizeof(double));
+        double y0 = twoTau * y1 - y2 + getDouble(inY + k * sizeof(double));
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+    }
+    return sf::Vector2<double>(tau * x1 - x2 + getDouble(in), tau * y1 - y2 + getDouble(inY));
+}
+
+bool Ephemeris::open(const std::string& path) {
+    mapped = false;
+    if (!file.open(path) || file.size() < ephemerisHeaderSize) {
+        std::cerr << "Can't open the ephemeris " << path << std::endl;
+        file.close();
+        return false;
+    }
+    const unsigned char* data = file.data();
+    std::size_t length = file.size();
+    coefficients = getU32(data + 12);
+    std::uint64_t count = getU64(data + 16);
+    std::uint64_t windows = getU64(data + 24);
+    startTime = getDouble(data + 32);
+    windowSeconds = getDouble(data + 40);
+    std::uint64_t index = getU64(data + 48);
+    std::uint64_t tableSize = getU64(data + 56);
+
+    // Check the header, and that the window index and the string table end the file. The records are checked when they are read,
+    // so opening a table doesn't read all of it
+    std::size_t recordsOffset = 0;
+    bool valid = std::memcmp(data, ephemerisMagic, sizeof(ephemerisMagic)) == 0
+                 && getU32(data + 8) == ephemerisVersion
+                 && coefficients >= 1 && coefficients <= maxEphemerisCoefficients
+                 && count >= 1 && windows >= 1 && windowSeconds > 0.0 && std::isfinite(startTime)
+                 && count <= (length - ephemerisHeaderSize) / ephemerisBodySize
+                 && index <= length && (length - index) / 8 > windows && tableSize == length - index - (windows + 1) * 8;
+    if (valid) {
+        recordsOffset = ephemerisHeaderSize + static_cast<std::size_t>(count) * ephemerisBodySize;
+        std::uint64_t previous = recordsOffset;
+        for (std::size_t w = 0; w <= windows && valid; ++w) {
+            std::uint64_t position = getU64(data + index + w * 8);
+            valid = position >= previous && position <= index && (w == 0 ? position == recordsOffset : position - previous >= (count + 1) * 4);
+            previous = position;
+        }
+        valid = valid && previous == index;
+    }
+    if (valid) {
+        bodyCount = static_cast<std::size_t>(count);
+        windowCount = static_cast<std::size_t>(windows);
+        indexOffset = static_cast<std::size_t>(index);
+        names.resize(bodyCount);
+        const char* table = reinterpret_cast<const char*>(data + indexOffset + (windowCount + 1) * 8);
+        for (std::size_t e = 0; e < bodyCount && valid; ++e) {
+            const unsigned char* in = data + ephemerisHeaderSize + e * ephemerisBodySize;
+            std::uint32_t nameOffset = getU32(in), nameLength = getU32(in + 4);
+            valid = nameOffset <= tableSize && nameLength <= tableSize - nameOffset;
+            if (valid) {
+                names[e].assign(table + nameOffset, nameLength);
+            }
+        }
+    }
+    if (!valid) {
+        std::cerr << "Ignoring the ephemeris " << path << ": it is damaged or of another version" << std::endl;
+        file.close();
+        return false;
+    }
+    LOG_INFO("Ephemeris %s: %zu bodies, %zu windows of %g s from %g s", path.c_str(), bodyCount, windowCount, windowSeconds, startTime);
+    return true;
+}
+
+bool Ephemeris::mapBodies(const BodyStore& bodies) {
+    if (mapped && bodies.size() == mappedSize && bodies.getHierarchyVersion() == mappedHierarchy) {
+        return coversAll;
+    }
+    mapped = true;
+    mappedSize = bodies.size();
+    mappedHierarchy = bodies.getHierarchyVersion();
+    std::unordered_map<std::string, int> entries;
+    for (std::size_t e = 0; e < bodyCount; ++e) {
+        entries.emplace(names[e], static_cast<int>(e));
+    }
+    entryOf.assign(bodies.size(), -1);
+    std::size_t missing = 0;
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        if (!bodies.isAlive(i)) {
+            continue;
+        }
+        auto found = entries.find(bodies.name[i]);
+        if (found != entries.end()) {
+            entryOf[i] = found->second;
+        } else {
+            ++missing;
+        }
+    }
+    coversAll = missing == 0;
+    if (missing > 0) {
+        LOG_WARNING("Ephemeris: %zu bodies aren't in the table, they keep their scripted orbits", missing);
+    }
+    return coversAll;
+}
+
+void Ephemeris::evaluate(BodyStore& bodies, double time, std::size_t begin, std::size_t end) const {
+    double local = std::min(std::max((time - startTime) / windowSeconds, 0.0), static_cast<double>(windowCount));
+    std::size_t window = std::min(static_cast<std::size_t>(local), windowCount - 1);
+    sf::Vector2<double> position;
+    for (std::size_t i = begin; i < end && i < entryOf.size(); ++i) {
+        if (entryOf[i] >= 0 && positionInWindow(static_cast<std::size_t>(entryOf[i]), window, local - window, position)) {
+            bodies.positionX[i] = position.x;
+            bodies.positionY[i] = position.y;
+        }
+    }
+}
+
+bool Ephemeris::positionOf(std::size_t entry, double time, sf::Vector2<double>& position) const {
+    double local = std::min(std::max((time - startTime) / windowSeconds, 0.0), static_cast<double>(windowCount));
+    std::size_t window = std::min(static_cast<std::size_t>(local), windowCount - 1);
+    return positionInWindow(entry, window, local - window, position);
+}
+
+/**
+ * This function finds the coefficients of the body in the record of the window, and the piece and tau of the time.
+ * The sums are done straight from the mapped file with the Clenshaw recurrence: one multiply-add and a subtraction per coefficient and coordinate.
+ *
+ * */
+bool Ephemeris::positionInWindow(std::size_t entry, std::size_t window, double u, sf::Vector2<double>& position) const {
+    const unsigned char* data = file.data();
+    std::uint64_t record = getU64(data + indexOffset + window * 8);
+    std::uint64_t recordEnd = getU64(data + indexOffset + (window + 1) * 8);
+    std::uint32_t first = getU32(data + record + entry * 4);
+    std::uint32_t last = getU32(data + record + (entry + 1) * 4);
+    std::uint64_t coefficientsStart = record + (bodyCount + 1) * 4;
+    std::size_t pieceSize = 2 * coefficients; // In doubles
+    std::size_t pieceCount = last > first ? (last - first) / pieceSize : 0;
+    if (pieceCount == 0 || pieceCount > maxEphemerisPieces || pieceCount * pieceSize != last - first ||
+        (recordEnd - coefficientsStart) / sizeof(double) < last) {
+        return false; // Damaged record
+    }
+
+    double scaled = u * pieceCount; // From 0 to the number of pieces across the window
+    std::size_t piece = std::min(static_cast<std::size_t>(scaled), pieceCount - 1);
+    double tau = 2.0 * (scaled - piece) - 1.0;
+    position = chebyshevPosition(data + coefficientsStart + (first + piece * pieceSize) * sizeof(double), coefficients, tau);
+    return true;
+}
+
+/**
+ * This function calculates the matrix that turns the samples of one piece into its coefficients by least squares: (A^T A)^-1 A^T,
+ * where A[j][k] = Tk(tau_j) at the evenly spaced samples tau_j = -1 + 2j / intervals. It is returned row by row, coefficients x (intervals + 1).
+ * A^T A is small (coefficients x coefficients) and well conditioned for the Chebyshev polynomials, so a Gaussian elimination is enough.
+ *
+ * */
+static std::vector<double> fitMatrix(std::size_t coefficients, std::size_t intervals) {
+    std::size_t samples = intervals + 1;
+    std::vector<double> a(samples * coefficients);
+    for (std::size_t j = 0; j < samples; ++j) {
+        double tau = -1.0 + 2.0 * j / intervals;
+        double previous = 1.0, current = tau;
+        a[j * coefficients] = 1.0;
+        for (std::size_t k = 1; k < coefficients; ++k) {
+            a[j * coefficients + k] = current;
+            double next = 2.0 * tau * current - previous;
+            previous = current;
+            current = next;
+        }
+    }
+    // Augmented matrix [A^T A | A^T], reduced until the left part is the identity
+    std::size_t width = coefficients + samples;
+    std::vector<double> m(coefficients * width, 0.0);
+    for (std::size_t r = 0; r < coefficients; ++r) {
+        for (std::size_t k = 0; k < coefficients; ++k) {
+            for (std::size_t j = 0; j < samples; ++j) {
+                m[r * width + k] += a[j * coefficients + r] * a[j * coefficients + k];
+            }
+        }
+        for (std::size_t j = 0; j < samples; ++j) {
+            m[r * width + coefficients + j] = a[j * coefficients + r];
+        }
+    }
+    for (std::size_t col = 0; col < coefficients; ++col) {
+        std::size_t pivot = col;
+        for (std::size_t r = col + 1; r < coefficients; ++r) {
+            if (std::abs(m[r * width + col]) > std::abs(m[pivot * width + col])) {
+                pivot = r;
+            }
+        }
+        for (std::size_t k = 0; k < width; ++k) {
+            std::swap(m[col * width + k], m[pivot * width + k]);
+        }
+        double scale = 1.0 / m[col * width + col];
+        for (std::size_t k = 0; k < width; ++k) {
+            m[col * width + k] *= scale;
+        }
+        for (std::size_t r = 0; r < coefficients; ++r) {
+            double factor = m[r * width + col];
+            if (r == col || factor == 0.0) {
+                continue;
+            }
+            for (std::size_t k = 0; k < width; ++k) {
+                m[r * width + k] -= factor * m[col * width + k];
+            }
+        }
+    }
+    std::vector<double> fit(coefficients * samples);
+    for (std::size_t r = 0; r < coefficients; ++r) {
+        std::copy(m.begin() + r * width + coefficients, m.begin() + (r + 1) * width, fit.begin() + r * samples);
+    }
+    return fit;
+}
+
+// Function to fit the samples of one coordinate of a body with a number of pieces. It writes pieces * coefficients coefficients, with the
+// stride between two pieces, and returns the largest distance between the fit and the samples
+static double fitCoordinate(const double* samples, std::size_t totalIntervals, std::size_t coefficients, std::size_t pieceCount,
+                            const std::vector<double>& fit, double* out, std::size_t stride) {
+    std::size_t intervals = totalIntervals / pieceCount;
+    double error = 0.0;
+    for (std::size_t piece = 0; piece < pieceCount; ++piece) {
+        const double* s = samples + piece * intervals;
+        double* c = out + piece * stride;
+        for (std::size_t k = 0; k < coefficients; ++k) {
+            double sum = 0.0;
+            for (std::size_t j = 0; j <= intervals; ++j) {
+                sum += fit[k * (intervals + 1) + j] * s[j];
+            }
+            c[k] = sum;
+        }
+        for (std::size_t j = 0; j <= intervals; ++j) {
+            error = std::max(error, std::abs(chebyshevSum(c, coefficients, -1.0 + 2.0 * j / intervals) - s[j]));
+        }
+    }
+    return error;
+}
+
+/**
+ * This function samples the model window by window, moving it forward only, and writes every window as soon as it is fitted,
+ * so the table can be much larger than the memory. In every window a body gets the smallest number of pieces that keeps the fit
+ * within the tolerance; the largest error over the whole table is printed at the end.
+ *
+ * */
+int runEphemerisBuild(const SimulationOptions& options, BodyStore& bodies, UpdateScheduler& scheduler, GravitySimulation* gravity, ThreadPool& pool) {
+    EphemerisFitSettings settings;
+    settings.startTime = options.startTime;
+    settings.spanSeconds = options.ephemerisSpan;
+    settings.windowSeconds = options.ephemerisWindow;
+    settings.coefficients = options.ephemerisCoefficients;
+    settings.tolerance = options.ephemerisTolerance;
+    auto started = std::chrono::steady_clock::now();
+
+    // The bodies of the table: every living body, in the order of the store
+    std::vector<std::size_t> slots;
+    std::string table; // Their names, written at the end of the file
+    std::vector<unsigned char> bodyTable;
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        if (bodies.isAlive(i)) {
+            unsigned char entry[ephemerisBodySize];
+            putU32(entry, static_cast<std::uint32_t>(table.size()));
+            putU32(entry + 4, static_cast<std::uint32_t>(bodies.name[i].size()));
+            bodyTable.insert(bodyTable.end(), entry, entry + ephemerisBodySize);
+            table += bodies.name[i];
+            slots.push_back(i);
+        }
+    }
+    if (slots.empty()) {
+        std::cerr << "No bodies to write to the ephemeris" << std::endl;
+        return 1;
+    }
+    std::size_t count = slots.size();
+    std::size_t n = settings.coefficients;
+    std::size_t windows = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(settings.spanSeconds / settings.windowSeconds - 1e-9)));
+    std::size_t intervals = maxEphemerisPieces * 2 * n; // Samples of a window, minus one: twice the coefficients of the smallest piece
+    std::vector<std::vector<double>> fits; // fits[level] for 2^level pieces
+    for (std::size_t p = 1; p <= maxEphemerisPieces; p *= 2) {
+        fits.push_back(fitMatrix(n, intervals / p));
+    }
+
+    // The model, moved forward to a time: the N-body integrator in steps of at most one tick, or the scripted orbits in closed form
+    double modelTime = settings.startTime;
+    if (gravity) {
+        gravity->reset(bodies, modelTime);
+    } else {
+        scheduler.evaluateAt(bodies, modelTime);
+    }
+    auto moveTo = [&](double time) {
+        if (gravity) {
+            int steps = static_cast<int>(std::ceil((time - modelTime) / options.tickSeconds - 1e-9));
+            for (int s = steps; s > 0; --s) {
+                double step = (time - modelTime) / s;
+                gravity->step(bodies, step);
+                modelTime += step;
+            }
+        } else {
+            scheduler.evaluateAt(bodies, time);
+        }
+        modelTime = time;
+    };
+
+    // The records go to a temporary file, renamed at the end like the snapshot, so a program reading the old table keeps a complete file
+    std::string temporaryPath = options.ephemerisOutput + ".tmp";
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Can't write " << temporaryPath << std::endl;
+        return 1;
+    }
+    unsigned char header[ephemerisHeaderSize] = {};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header)); // Placeholder, written again at the end
+    out.write(reinterpret_cast<const char*>(bodyTable.data()), static_cast<std::streamsize>(bodyTable.size()));
+
+    std::vector<double> sampleX(count * (intervals + 1)), sampleY(count * (intervals + 1)); // Body by body
+    std::vector<double> fitted(count * maxEphemerisPieces * 2 * n); // Coefficients of every body in the window, at most maxEphemerisPieces pieces each
+    std::vector<std::uint32_t> pieceCount(count, 1);
+    std::vector<double> errors(count, 0.0); // Largest error of every body over the table
+    std::vector<std::uint64_t> windowIndex;
+    std::vector<unsigned char> record;
+    std::uint64_t position = ephemerisHeaderSize + bodyTable.size();
+    std::size_t totalPieces = 0;
+    for (std::size_t e = 0; e < count; ++e) {
+        sampleX[e * (intervals + 1)] = bodies.positionX[slots[e]];
+        sampleY[e * (intervals + 1)] = bodies.positionY[slots[e]];
+    }
+
+    for (std::size_t w = 0; w < windows; ++w) {
+        double windowStart = settings.startTime + w * settings.windowSeconds;
+        for (std::size_t j = 1; j <= intervals; ++j) {
+            moveTo(windowStart + settings.windowSeconds * j / intervals);
+            for (std::size_t e = 0; e < count; ++e) {
+                sampleX[e * (intervals + 1) + j] = bodies.positionX[slots[e]];
+                sampleY[e * (intervals + 1) + j] = bodies.positionY[slots[e]];
+            }
+        }
+
+        // Fit every body with 1, 2, 4 or 8 pieces, the first that is within the tolerance
+        pool.parallelFor(count, 64, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t e = begin; e < end; ++e) {
+                double* c = &fitted[e * maxEphemerisPieces * 2 * n];
+                std::size_t p = 1;
+                for (std::size_t level = 0;; ++level, p *= 2) {
+                    double error = std::max(fitCoordinate(&sampleX[e * (intervals + 1)], intervals, n, p, fits[level], c, 2 * n),
+                                            fitCoordinate(&sampleY[e * (intervals + 1)], intervals, n, p, fits[level], c + n, 2 * n));
+                    if (error <= settings.tolerance || p == maxEphemerisPieces) {
+                        errors[e] = std::max(errors[e], error);
+                        break;
+                    }
+                }
+                pieceCount[e] = static_cast<std::uint32_t>(p);
+            }
+        });
+
+        // Encode the record: the offsets of the bodies, then their coefficients one after the other
+        std::size_t doubles = 0;
+        for (std::size_t e = 0; e < count; ++e) {
+            doubles += pieceCount[e] * 2 * n;
+            totalPieces += pieceCount[e];
+        }
+        record.resize((count + 1) * 4 + doubles * sizeof(double));
+        std::size_t offset = 0;
+        for (std::size_t e = 0; e < count; ++e) {
+            putU32(&record[e * 4], static_cast<std::uint32_t>(offset));
+            const double* c = &fitted[e * maxEphemerisPieces * 2 * n];
+            for (std::size_t k = 0; k < pieceCount[e] * 2 * n; ++k) {
+                putDouble(&record[(count + 1) * 4 + (offset + k) * sizeof(double)], c[k]);
+            }
+            offset += pieceCount[e] * 2 * n;
+        }
+        putU32(&record[count * 4], static_cast<std::uint32_t>(offset));
+        out.write(reinterpret_cast<const char*>(record.data()), static_cast<std::streamsize>(record.size()));
+        windowIndex.push_back(position);
+        position += record.size();
+
+        // The last sample of this window is the first of the next one
+        for (std::size_t e = 0; e < count; ++e) {
+            sampleX[e * (intervals + 1)] = sampleX[e * (intervals + 1) + intervals];
+            sampleY[e * (intervals + 1)] = sampleY[e * (intervals + 1) + intervals];
+        }
+    }
+    windowIndex.push_back(position);
+
+    // Window index and names after the records, then the header now that the index is placed
+    std::vector<unsigned char> index(windowIndex.size() * 8);
+    for (std::size_t w = 0; w < windowIndex.size(); ++w) {
+        putU64(&index[w * 8], windowIndex[w]);
+    }
+    out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+    out.write(table.data(), static_cast<std::streamsize>(table.size()));
+    std::memcpy(header, ephemerisMagic, sizeof(ephemerisMagic));
+    putU32(header + 8, ephemerisVersion);
+    putU32(header + 12, static_cast<std::uint32_t>(n));
+    putU64(header + 16, count);
+    putU64(header + 24, windows);
+    putDouble(header + 32, settings.startTime);
+    putDouble(header + 40, settings.windowSeconds);
+    putU64(header + 48, position);
+    putU64(header + 56, table.size());
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::cerr << "Can't write " << temporaryPath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return 1;
+    }
+    if (std::rename(temporaryPath.c_str(), options.ephemerisOutput.c_str()) != 0) {
+        std::cerr << "Can't replace " << options.ephemerisOutput << std::endl;
+        std::remove(temporaryPath.c_str());
+        return 1;
+    }
+
+    // Report the size of the table and how well it follows the model
+    std::size_t worst = static_cast<std::size_t>(std::max_element(errors.begin(), errors.end()) - errors.begin());
+    std::size_t over = static_cast<std::size_t>(std::count_if(errors.begin(), errors.end(), [&](double error) { return error > settings.tolerance; }));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Ephemeris " << options.ephemerisOutput << ": " << count << " bodies, " << windows << " windows of " << settings.windowSeconds << " s from "
+              << settings.startTime << " s, " << n << " coefficients, " << static_cast<double>(totalPieces) / (count * windows) << " pieces per window on average, "
+              << (position + index.size() + table.size()) / 1024 << " KiB, built in " << seconds << " s" << std::endl;
+    std::cout << "Largest error " << errors[worst] << " world units (" << bodies.name[slots[worst]] << "), tolerance " << settings.tolerance << std::endl;
+    if (over > 0) {
+        std::cerr << over << " bodies are off by more than the tolerance in some windows: use a shorter --ephemeris-window or more coefficients" << std::endl;
+    }
+    return 0;
+}
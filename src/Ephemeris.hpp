@@ -0,0 +1,97 @@
+/**
+ * This file declares the ephemeris: a table of the positions of every body over a span of simulated time, in the style of the JPL DE files.
+ * The span is cut into windows of the same length, and in every window the x and the y of a body are each a sum of Chebyshev polynomials,
+ * x(t) = c0 * T0(tau) + c1 * T1(tau) + ... with tau going from -1 to 1 across the window. A body that moves fast (a moon) has its window
+ * cut into 2, 4 or 8 pieces with their own coefficients, so every body gets the accuracy of the table with as few numbers as possible.
+ *
+ * The table is fitted once (--build-ephemeris) from any motion model, however slow: the scripted orbits or the N-body mode.
+ * The model is only ever moved forward in time, so a model that can only be stepped (the N-body integrators) can be sampled.
+ * Reading a position back (--ephemeris) is then a lookup of the window and a few multiply-adds per coordinate (the Clenshaw recurrence),
+ * so any simulated time costs the same to render, whatever the model the table was made from.
+ *
+ * The file is little-endian and mapped into memory (see MappedFile.hpp), like the catalog snapshot:
+ *
+ *   header (64 bytes): magic "SOLAREPH", format version, coefficients per coordinate, number of bodies, number of windows,
+ *                      start time, length of a window (doubles), position of the window index, size of the string table
+ *   bodies:            8 bytes per body: name offset and length in the string table
+ *   records:           one record per window: bodies + 1 offsets (u32), then for every body and every piece the x coefficients
+ *                      and the y coefficients (doubles). The coefficients of body b are between offsets b and b + 1, counted in doubles
+ *   window index:      windows + 1 positions of the records in the file (u64), the last one is the end of the records
+ *   string table:      the names of the bodies, one after the other
+ *
+ * The pieces of a body are chosen again in every window, so an eccentric orbit only pays for its fast periapsis in the windows that have it.
+ *
+ */
+
+#ifndef EPHEMERIS_HPP
+#define EPHEMERIS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BodyStore.hpp"
+#include "GravitySimulation.hpp"
+#include "MappedFile.hpp"
+#include "Options.hpp"
+#include "ThreadPool.hpp"
+#include "UpdateScheduler.hpp"
+
+// Version of the file format, incremented when the layout changes so old tables are refused
+const std::uint32_t ephemerisVersion = 1;
+// Largest number of coefficients per coordinate and of pieces per window
+const std::size_t maxEphemerisCoefficients = 32;
+const std::size_t maxEphemerisPieces = 8;
+
+class Ephemeris {
+public:
+    // Function to map an ephemeris file and check its header and size. It returns false if the file is missing, damaged or of another version
+    bool open(const std::string& path);
+
+    bool isOpen() const { return file.data() != nullptr; }
+    std::size_t getBodyCount() const { return bodyCount; }
+    double getStartTime() const { return startTime; }
+    double getEndTime() const { return startTime + windowCount * windowSeconds; }
+
+    // Function to match the bodies of the store with the bodies of the table by name, again only when bodies were added or removed.
+    // It returns true if every body of the store is in the table
+    bool mapBodies(const BodyStore& bodies);
+    // Function to set the positions of the bodies [begin, end) that are in the table to their positions at a simulated time.
+    // A time outside the table is moved to its nearest end. mapBodies must have been called since the store last changed
+    void evaluate(BodyStore& bodies, double time, std::size_t begin, std::size_t end) const;
+    // Function to calculate the position of the body number entry of the table at a simulated time. It returns false if its record is damaged
+    bool positionOf(std::size_t entry, double time, sf::Vector2<double>& position) const;
+
+private:
+    // Function to calculate the position of a body at u (0 to 1) across a window, returns false if the record is damaged
+    bool positionInWindow(std::size_t entry, std::size_t window, double u, sf::Vector2<double>& position) const;
+
+    MappedFile file;
+    std::size_t coefficients = 0; // Per coordinate and per piece
+    std::size_t bodyCount = 0;
+    std::size_t windowCount = 0;
+    double startTime = 0.0;
+    double windowSeconds = 0.0;
+    std::size_t indexOffset = 0; // Position of the window index in the file
+    std::vector<std::string> names;
+    std::vector<int> entryOf; // Body of the table of every slot of the store, -1 if it isn't in the table
+    std::size_t mappedSize = 0; // Size and hierarchy version of the store when the bodies were matched
+    std::size_t mappedHierarchy = 0;
+    bool mapped = false;
+    bool coversAll = false;
+};
+
+// Settings of the fit of an ephemeris
+struct EphemerisFitSettings {
+    double startTime = 0.0; // Simulated time of the start of the table
+    double spanSeconds = 3600.0; // Length of the table in simulated seconds
+    double windowSeconds = 16.0; // Length of a window
+    std::size_t coefficients = 12; // Per coordinate: Chebyshev polynomials of degree 0 to 11
+    double tolerance = 1e-3; // Largest distance between the table and the model at the samples, in world units
+};
+
+// Function to fit the motion of the bodies of the store over the span of the settings and write the table to a file (--build-ephemeris).
+// The bodies are moved by the N-body simulation if there is one, by their scripted orbits otherwise. It returns the exit code of the program
+int runEphemerisBuild(const SimulationOptions& options, BodyStore& bodies, UpdateScheduler& scheduler, GravitySimulation* gravity, ThreadPool& pool);
+
+#endif
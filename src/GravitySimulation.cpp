@@ -0,0 +1,276 @@
+/**
+ * Purpose: Implement the methods of the GravitySimulation class that are declared in the GravitySimulation.hpp header file,
+ *  and the benchmark of the Barnes-Hut tree.
+ *  Only the living bodies are simulated: their state is packed into arrays without the slots of removed bodies,
+ *  and packed again when bodies are added or removed.
+ *
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include "GravitySimulation.hpp"
+#include "Log.hpp"
+
+// Smallest number of bodies given to one thread, like in UpdateScheduler
+static const std::size_t minBodiesPerChunk = 2048;
+// Time step of the central difference that turns the scripted positions into velocities, in simulated seconds
+static const double velocityStep = 1e-3;
+
+GravitySimulation::GravitySimulation(ThreadPool& pool, const SimulationOptions& options)
+    : pool(pool), gravity(options.gravity), theta(options.theta), softening(options.softening), diagnosticSteps(options.diagnosticSteps),
+      integrator(Integrator::create(options.integrator)) {
+    if (!integrator) {
+        integrator.reset(new LeapfrogIntegrator()); // The options only accept known names
+    }
+    if (diagnosticSteps > 0) {
+        monitor.reset(new EnergyMonitor(gravity, theta, softening));
+    }
+    state.gravity = gravity;
+    state.softening = softening;
+}
+
+void GravitySimulation::scriptedState(const BodyStore& bodies, std::size_t index, double& px, double& py, double& pvx, double& pvy) const {
+    sf::Vector2<double> position = bodies.positionAt(index, time);
+    sf::Vector2<double> before = bodies.positionAt(index, time - velocityStep);
+    sf::Vector2<double> after = bodies.positionAt(index, time + velocityStep);
+    px = position.x;
+    py = position.y;
+    pvx = (after.x - before.x) / (2 * velocityStep);
+    pvy = (after.y - before.y) / (2 * velocityStep);
+}
+
+void GravitySimulation::reset(BodyStore& bodies, double time) {
+    this->time = time;
+    slots.clear();
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        if (bodies.isAlive(i)) {
+            slots.push_back(i);
+        }
+    }
+    std::size_t count = slots.size();
+    x.resize(count); y.resize(count); vx.resize(count); vy.resize(count); ax.resize(count); ay.resize(count);
+    mass.resize(count);
+    generation.resize(count);
+    pool.parallelFor(count, minBodiesPerChunk / 8, [this, &bodies](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            std::size_t i = slots[k];
+            scriptedState(bodies, i, x[k], y[k], vx[k], vy[k]);
+            generation[k] = bodies.handleOf(i).generation;
+            bodies.positionX[i] = x[k];
+            bodies.positionY[i] = y[k];
+        }
+    });
+    syncedVersion = bodies.getHierarchyVersion();
+    state.accelerationsValid = false;
+    steps = 0;
+    if (monitor) {
+        monitor->restart();
+    }
+}
+
+/**
+ * This function packs the state again when bodies were added or removed since the last step. The bodies that were already simulated keep their state,
+ * a new body gets its scripted offset from its parent, added to the current state of the parent. The store is only scanned when its hierarchy version changed.
+ *
+ * */
+void GravitySimulation::sync(BodyStore& bodies) {
+    if (bodies.getHierarchyVersion() == syncedVersion) {
+        return;
+    }
+    std::size_t count = bodies.size();
+    std::vector<int> previous(count, -1); // Position of every slot in the old state, -1 if it had none
+    for (std::size_t k = 0; k < slots.size(); ++k) {
+        std::size_t i = slots[k];
+        if (i < count && bodies.isAlive(i) && generation[k] == bodies.handleOf(i).generation) {
+            previous[i] = static_cast<int>(k);
+        }
+    }
+
+    std::vector<std::size_t> newSlots;
+    std::vector<int> packed(count, -1); // Position of every slot in the new state
+    for (std::size_t i = 0; i < count; ++i) {
+        if (bodies.isAlive(i)) {
+            packed[i] = static_cast<int>(newSlots.size());
+            newSlots.push_back(i);
+        }
+    }
+    std::size_t live = newSlots.size();
+    std::vector<double> newX(live), newY(live), newVX(live), newVY(live);
+    std::vector<std::uint32_t> newGeneration(live);
+    std::vector<std::size_t> added;
+    for (std::size_t k = 0; k < live; ++k) {
+        std::size_t i = newSlots[k];
+        newGeneration[k] = bodies.handleOf(i).generation;
+        int old = previous[i];
+        if (old >= 0) {
+            newX[k] = x[old]; newY[k] = y[old]; newVX[k] = vx[old]; newVY[k] = vy[old];
+        } else {
+            added.push_back(k);
+        }
+    }
+    for (std::size_t k : added) {
+        std::size_t i = newSlots[k];
+        scriptedState(bodies, i, newX[k], newY[k], newVX[k], newVY[k]);
+        int parentIndex = bodies.parent[i];
+        if (parentIndex >= 0 && previous[parentIndex] >= 0) {
+            // Move the scripted orbit to where the parent really is
+            double px, py, pvx, pvy;
+            scriptedState(bodies, static_cast<std::size_t>(parentIndex), px, py, pvx, pvy);
+            int p = packed[parentIndex];
+            newX[k] += newX[p] - px;
+            newY[k] += newY[p] - py;
+            newVX[k] += newVX[p] - pvx;
+            newVY[k] += newVY[p] - pvy;
+        }
+    }
+    if (!added.empty()) {
+        LOG_DEBUG("N-body: %zu bodies added at t=%.3f", added.size(), time);
+    }
+    if (monitor && (!added.empty() || live != slots.size())) {
+        monitor->restart(); // The new bodies bring their own energy, the removed ones take theirs away
+    }
+    slots.swap(newSlots);
+    x.swap(newX); y.swap(newY); vx.swap(newVX); vy.swap(newVY);
+    generation.swap(newGeneration);
+    ax.resize(live); ay.resize(live);
+    mass.resize(live);
+    syncedVersion = bodies.getHierarchyVersion();
+    state.accelerationsValid = false;
+}
+
+void GravitySimulation::computeAccelerations(const float* mass) {
+    auto start = std::chrono::steady_clock::now();
+    tree.build(x.data(), y.data(), mass, x.size(), pool);
+    auto built = std::chrono::steady_clock::now();
+    tree.accelerations(ax.data(), ay.data(), theta, softening, gravity, pool);
+    stats.buildSeconds += std::chrono::duration<float>(built - start).count();
+    stats.forceSeconds += std::chrono::duration<float>(std::chrono::steady_clock::now() - built).count();
+    stats.nodes = tree.getNodeCount();
+}
+
+/**
+ * This function advances the bodies with the integrator, then copies the positions to the store for the renderer.
+ * The masses are read from the store at every step, so a mass changed in the database acts from the next step.
+ *
+ * */
+void GravitySimulation::step(BodyStore& bodies, double deltaTime) {
+    sync(bodies);
+    stats.buildSeconds = 0.0f;
+    stats.forceSeconds = 0.0f;
+    std::size_t count = slots.size();
+    for (std::size_t k = 0; k < count; ++k) {
+        mass[k] = bodies.mass[slots[k]];
+    }
+    state.x = x.data(); state.y = y.data(); state.vx = vx.data(); state.vy = vy.data(); state.ax = ax.data(); state.ay = ay.data();
+    state.mass = mass.data();
+    state.count = count;
+    integrator->step(state, deltaTime, [this](const float* mass) { computeAccelerations(mass); }, pool);
+
+    pool.parallelFor(count, minBodiesPerChunk, [this, &bodies, deltaTime](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k) {
+            std::size_t i = slots[k];
+            bodies.positionX[i] = x[k];
+            bodies.positionY[i] = y[k];
+            float rotation = bodies.rotation[i] + static_cast<float>(bodies.rotationSpeed[i] * deltaTime);
+            bodies.rotation[i] = rotation - 360.0f * std::floor(rotation / 360.0f);
+        }
+    });
+    time += deltaTime;
+    ++steps;
+    if (monitor && steps % diagnosticSteps == 0) {
+        monitor->submit(x.data(), y.data(), vx.data(), vy.data(), mass.data(), count, time); // Skipped if the last check is still running
+    }
+}
+
+EnergyReport GravitySimulation::getEnergyReport() {
+    if (!monitor) {
+        return EnergyReport();
+    }
+    monitor->wait();
+    return monitor->getReport();
+}
+
+/**
+ * This function times the tree and the direct sum on random discs of 1024 to options.benchmarkBodies bodies, four times more at every row.
+ * The direct sum is O(N^2): up to fullDirectBodies bodies it is run for every body, above that only for a sample of 1024 bodies
+ * and its time is scaled up to N bodies (marked with * in the table); the bodies it was run for give the error of the tree.
+ * The growth of the direct sum is only taken from the rows where it was run in full. If the tree is O(N log N), the last column
+ * (time per N log2 N) stays about the same.
+ *
+ * */
+int runGravityBenchmark(const SimulationOptions& options, ThreadPool& pool) {
+    const std::size_t sampleSize = 1024;
+    const std::size_t fullDirectBodies = 16384; // About a second for the direct sum on one core
+    std::mt19937 random(12345); // Always the same bodies, so two runs can be compared
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::printf("N-body benchmark on %zu threads, theta %.2f, softening %.2f\n", pool.getThreadCount(), options.theta, options.softening);
+    std::printf("%9s %9s %10s %10s %10s %13s %9s %11s %16s\n", "bodies", "cells", "build ms", "force ms", "tree ms", "direct ms", "speedup",
+                "rms error", "ns per N log2 N");
+    double firstTree = 0.0, firstDirect = 0.0, lastTree = 0.0, lastDirect = 0.0;
+    std::size_t firstCount = 0, lastCount = 0, lastFullCount = 0;
+    bool scaled = false;
+    for (std::size_t count = 1024; count <= options.benchmarkBodies; count *= 4) {
+        // Bodies spread evenly over a disc of radius 1000
+        std::vector<double> x(count), y(count), ax(count), ay(count), directX(count), directY(count);
+        std::vector<float> mass(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            double r = 1000.0 * std::sqrt(uniform(random));
+            double a = 6.283185307179586 * uniform(random);
+            x[i] = r * std::cos(a);
+            y[i] = r * std::sin(a);
+            mass[i] = static_cast<float>(0.5 + uniform(random));
+        }
+
+        BarnesHutTree tree;
+        auto start = std::chrono::steady_clock::now();
+        tree.build(x.data(), y.data(), mass.data(), count, pool);
+        auto built = std::chrono::steady_clock::now();
+        tree.accelerations(ax.data(), ay.data(), options.theta, options.softening, 1.0, pool);
+        auto forces = std::chrono::steady_clock::now();
+        std::size_t sample = count <= fullDirectBodies ? count : sampleSize;
+        BarnesHutTree::directAccelerations(x.data(), y.data(), mass.data(), count, 0, sample, directX.data(), directY.data(), options.softening, 1.0, pool);
+        auto direct = std::chrono::steady_clock::now();
+
+        double buildMs = std::chrono::duration<double, std::milli>(built - start).count();
+        double forceMs = std::chrono::duration<double, std::milli>(forces - built).count();
+        double treeMs = buildMs + forceMs;
+        double directMs = std::chrono::duration<double, std::milli>(direct - forces).count() * count / sample;
+        double error = 0.0, norm = 0.0;
+        for (std::size_t i = 0; i < sample; ++i) {
+            error += (ax[i] - directX[i]) * (ax[i] - directX[i]) + (ay[i] - directY[i]) * (ay[i] - directY[i]);
+            norm += directX[i] * directX[i] + directY[i] * directY[i];
+        }
+        double perBody = treeMs * 1e6 / (count * std::log2(static_cast<double>(count)));
+        std::printf("%9zu %9zu %10.2f %10.2f %10.2f %12.1f%c %8.1fx %11.2e %16.2f\n", count, tree.getNodeCount(), buildMs, forceMs, treeMs, directMs,
+                    sample < count ? '*' : ' ', directMs / treeMs, norm > 0.0 ? std::sqrt(error / norm) : 0.0, perBody);
+        if (firstCount == 0) {
+            firstCount = count;
+            firstTree = treeMs;
+            firstDirect = directMs;
+        }
+        lastCount = count;
+        lastTree = treeMs;
+        if (sample == count) {
+            lastFullCount = count;
+            lastDirect = directMs;
+        }
+        scaled = scaled || sample < count;
+    }
+    if (scaled) {
+        std::printf("* scaled up from the direct sum of %zu bodies\n", sampleSize);
+    }
+    if (lastCount > firstCount) {
+        // Slope of the time on a log-log scale: about 1.1 for N log N, 2 for N^2
+        std::printf("time grows like N^%.2f with the tree", std::log(lastTree / firstTree) / std::log(static_cast<double>(lastCount) / firstCount));
+        if (lastFullCount > firstCount) {
+            std::printf(" and N^%.2f with the direct sum (up to %zu bodies)", std::log(lastDirect / firstDirect) / std::log(static_cast<double>(lastFullCount) / firstCount),
+                        lastFullCount);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
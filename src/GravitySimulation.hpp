@@ -0,0 +1,76 @@
+/**
+ * This class moves the bodies with their mutual gravity instead of the scripted orbits (the N-body mode, started with --nbody).
+ * Every body attracts every other one with its mass (the mass column of the planets table); a body without mass is only attracted.
+ * The accelerations are calculated with a BarnesHutTree rebuilt at every force calculation, and the bodies are moved by an Integrator
+ * chosen with --integrator (leapfrog by default). An EnergyMonitor checks the energy and the angular momentum every few steps on its own thread.
+ *
+ * The bodies start from their scripted orbits: the position and the velocity of a body are taken from BodyStore::positionAt
+ * when the simulated time jumps. A body added later starts at the same place relative to its parent as on its scripted orbit,
+ * wherever gravity has moved the parent. Whether the orbits stay the same then depends on the masses.
+ *
+ */
+
+#ifndef GRAVITYSIMULATION_HPP
+#define GRAVITYSIMULATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include "BarnesHutTree.hpp"
+#include "BodyStore.hpp"
+#include "EnergyMonitor.hpp"
+#include "Integrator.hpp"
+#include "Options.hpp"
+#include "ThreadPool.hpp"
+
+// Timing of the last step, in seconds
+struct GravityStats {
+    float buildSeconds = 0.0f; // Time to sort the bodies and build the trees, summed over the force calculations of the step
+    float forceSeconds = 0.0f; // Time to calculate the accelerations, summed the same way
+    std::size_t nodes = 0; // Number of cells of the tree
+};
+
+class GravitySimulation {
+public:
+    // Constructor with the N-body options: the gravitational constant, the opening angle of the tree, the softening, the integrator and how often to check the energy
+    GravitySimulation(ThreadPool& pool, const SimulationOptions& options);
+
+    void reset(BodyStore& bodies, double time); // Function to set every body to its scripted position and velocity at a simulated time
+    void step(BodyStore& bodies, double deltaTime); // Function to advance all bodies by one step. Bodies added since the last step start from their scripted orbit
+    const GravityStats& getStats() const { return stats; } // Function to get the timing of the last step
+    const char* getIntegratorName() const { return integrator->getName(); }
+    EnergyReport getEnergyReport(); // Function to get the last energy check, after waiting for the check in progress. Empty when the checks are off
+
+private:
+    // Function to calculate the scripted position and velocity of a body, the velocity by a central difference of BodyStore::positionAt
+    void scriptedState(const BodyStore& bodies, std::size_t index, double& px, double& py, double& pvx, double& pvy) const;
+    void sync(BodyStore& bodies); // Function to follow the bodies added and removed since the last step
+    void computeAccelerations(const float* mass); // Function to rebuild the tree and fill ax and ay, called by the integrator
+
+    ThreadPool& pool;
+    double gravity;
+    float theta;
+    float softening;
+    std::size_t diagnosticSteps; // Number of steps between two energy checks, 0 for none
+    BarnesHutTree tree;
+    std::unique_ptr<Integrator> integrator;
+    std::unique_ptr<EnergyMonitor> monitor;
+    IntegratorState state; // Points into the vectors below, set again at every step since they can grow
+    // State of the living bodies only, in the order of their slots, so the tree and the integrator never see a removed body.
+    // In double precision: the float positions of the store would lose the small steps of slow bodies
+    std::vector<double> x, y, vx, vy, ax, ay;
+    std::vector<float> mass; // Masses of the living bodies, copied from the store at every step
+    std::vector<std::size_t> slots; // Slot of the store of every living body
+    std::vector<std::uint32_t> generation; // Generation of the slot when the state was set, to detect a body that replaced a removed one
+    std::size_t syncedVersion = 0; // Hierarchy version of the store at the last sync
+    double time = 0.0; // Simulated time of the state
+    std::size_t steps = 0; // Number of steps since the last reset
+    GravityStats stats;
+};
+
+// Function to measure the Barnes-Hut tree against the direct sum on growing random discs of bodies and print the table (--benchmark-nbody).
+// It returns the exit code of the program.
+int runGravityBenchmark(const SimulationOptions& options, ThreadPool& pool);
+
+#endif
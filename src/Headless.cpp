@@ -0,0 +1,149 @@
+/**
+ * Purpose: Implement the headless mode declared in Headless.hpp.
+ *  When the raw frames are written to stdout (to pipe them into a video encoder), the report is printed to stderr instead.
+ *
+ * */
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include "Headless.hpp"
+#include "BodyRenderer.hpp"
+#include "Camera.hpp"
+#include "OrbitTrails.hpp"
+#include "OrbitPaths.hpp"
+#include "Log.hpp"
+
+int runHeadless(const SimulationOptions& options, BodyStore& bodies, UpdateScheduler& scheduler, GravitySimulation* gravity, Ephemeris* ephemeris,
+                Replay* replay, Recorder* recorder, Profiler& profiler) {
+    bool rendering = !options.frameOutput.empty();
+    bool rawToStdout = rendering && options.frameFormat == "raw" && options.frameOutput == "-";
+    std::ostream& report = rawToStdout ? std::cerr : std::cout;
+
+    // Offscreen render target and output file, only when the frames are rendered
+    std::unique_ptr<sf::RenderTexture> target;
+    std::FILE* rawFile = nullptr;
+    BodyRenderer renderer;
+    Camera camera(sf::Vector2u(options.width, options.height), options.zoom); // Looks at the world origin, or at the body of --follow
+    OrbitTrails trails(options.trailMemory << 20);
+    trails.setShowAll(options.trails);
+    OrbitPaths orbitPaths;
+    if (rendering) {
+        target.reset(new sf::RenderTexture());
+        if (!target->create(options.width, options.height)) {
+            std::cerr << "Can't create a " << options.width << "x" << options.height << " render texture" << std::endl;
+            return 1;
+        }
+        if (options.frameFormat == "raw") {
+            rawFile = rawToStdout ? stdout : std::fopen(options.frameOutput.c_str(), "wb");
+            if (!rawFile) {
+                std::cerr << "Can't open " << options.frameOutput << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if (replay) {
+        replay->seek(bodies, options.startTime); // Fill the store with the bodies of the recording, for --follow
+    } else if (gravity) {
+        gravity->reset(bodies, options.startTime); // The N-body mode starts from the scripted orbits at the start time
+    } else if (options.steppedOrbits) {
+        scheduler.evaluateAt(bodies, options.startTime); // The stepped orbits start from the state at the start time
+    }
+
+    int followed = options.follow.empty() ? -1 : bodies.findIndex(options.follow);
+    if (!options.follow.empty() && followed < 0) {
+        std::cerr << "No body named " << options.follow << " to follow" << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < options.frames; ++frame) {
+        {
+            ScopedTimer frameTimer(profiler, ProfilePhase::Frame); // Ends before endFrame(), so the sample belongs to this frame
+            float alpha = 1.0f; // Only a replay draws between two states
+            bool scheduled = false; // Set when the scheduler ran, only then its stats are of this frame
+            {
+                ScopedTimer timer(profiler, ProfilePhase::Update);
+                if (replay) {
+                    alpha = replay->seek(bodies, options.startTime + (frame + 1.0) * options.timeStep); // A frame of the recording, or between two of them
+                } else if (ephemeris) {
+                    scheduler.evaluateEphemeris(bodies, *ephemeris, options.startTime + (frame + 1.0) * options.timeStep);
+                    scheduled = true;
+                } else if (gravity) {
+                    gravity->step(bodies, options.timeStep);
+                } else if (options.steppedOrbits) {
+                    scheduler.update(bodies, options.timeStep);
+                    scheduled = true;
+                } else {
+                    scheduler.evaluateAt(bodies, options.startTime + (frame + 1.0) * options.timeStep);
+                    scheduled = true;
+                }
+                if (recorder) {
+                    recorder->record(bodies, alpha, (frame + 1.0) * options.timeStep);
+                }
+            }
+            if (scheduled) {
+                profiler.addSample(ProfilePhase::Barrier, scheduler.getStats().barrierSeconds);
+            }
+
+            if (rendering) {
+                {
+                    ScopedTimer timer(profiler, ProfilePhase::Draw);
+                    if (followed >= 0 && bodies.isAlive(followed)) {
+                        camera.lookAt(bodies.interpolatedPosition(followed, alpha), camera.getZoom());
+                    }
+                    trails.record(bodies, camera.getZoom());
+                    target->clear();
+                    target->setView(camera.getView());
+                    if (options.orbits) {
+                        orbitPaths.render(bodies, *target, alpha, camera.getOrigin());
+                    }
+                    trails.render(bodies, *target, alpha, camera.getOrigin());
+                    renderer.render(bodies, *target, alpha, nullptr, camera.getOrigin());
+                    target->display();
+                }
+                ScopedTimer timer(profiler, ProfilePhase::Display); // Reading back and writing the frame
+                sf::Image image = target->getTexture().copyToImage(); // Copy the pixels from the graphics card
+                if (rawFile) {
+                    std::fwrite(image.getPixelsPtr(), 4, static_cast<std::size_t>(options.width) * options.height, rawFile);
+                } else {
+                    char fileName[32];
+                    std::snprintf(fileName, sizeof(fileName), "/frame_%06d.png", frame);
+                    if (!image.saveToFile(options.frameOutput + fileName)) {
+                        std::cerr << "Can't write " << options.frameOutput << fileName << std::endl;
+                        return 1;
+                    }
+                }
+                LOG_DEBUG("Headless frame %d written", frame);
+            }
+        }
+        profiler.endFrame(); // After every sample of the frame, so a row of the export only holds one frame
+    }
+    if (rawFile) {
+        std::fflush(rawFile);
+        if (!rawToStdout) {
+            std::fclose(rawFile);
+        }
+    }
+    float wallSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+    // Throughput report
+    float framesPerSecond = wallSeconds > 0.0f ? options.frames / wallSeconds : 0.0f;
+    report << "headless: " << options.frames << " frames of " << bodies.size() << " bodies in " << wallSeconds << " s: "
+           << framesPerSecond << " frames/s, " << framesPerSecond * options.timeStep << " simulated seconds per second"
+           << (rendering ? " (rendered)" : " (simulation only)") << std::endl;
+    if (gravity) {
+        // The drifts tell whether the time step can be made larger: they should stay small and not grow with the number of frames
+        EnergyReport energy = gravity->getEnergyReport();
+        report << "headless: " << gravity->getIntegratorName() << " over " << energy.time - options.startTime << " simulated seconds: largest energy drift "
+               << energy.maxEnergyDrift << ", largest angular momentum drift " << energy.maxAngularMomentumDrift << " (" << energy.samples << " checks of "
+               << energy.bodies << " bodies with a mass)" << std::endl;
+    }
+    if (options.targetFps > 0.0f && framesPerSecond < options.targetFps) {
+        report << "headless: throughput target of " << options.targetFps << " frames/s missed" << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+/**
+ * This file declares the headless mode of the simulation, used on machines without a display (for example render farm nodes).
+ * The simulation is stepped with a fixed time step, without a window. The frames are either not rendered at all,
+ * or rendered into an offscreen sf::RenderTexture and written out as a sequence of PNG images or as a stream of raw RGBA pixels.
+ * At the end, the throughput is printed in frames per second and in simulated seconds per second, and compared to the target.
+ *
+ */
+
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include "BodyStore.hpp"
+#include "Ephemeris.hpp"
+#include "GravitySimulation.hpp"
+#include "Options.hpp"
+#include "Profiler.hpp"
+#include "Recording.hpp"
+#include "UpdateScheduler.hpp"
+
+// Function to run the headless mode. It returns the exit code of the program: 0 on success, 1 on error, 2 if the throughput target was missed.
+// The update and the rendering of every frame are recorded in the profiler. With a Replay the frames of a recording are shown, with an Ephemeris
+// the positions are read from the table, otherwise with a GravitySimulation the bodies move with their gravity instead of the scheduler.
+// With a Recorder every frame is added to the recording.
+int runHeadless(const SimulationOptions& options, BodyStore& bodies, UpdateScheduler& scheduler, GravitySimulation* gravity, Ephemeris* ephemeris,
+                Replay* replay, Recorder* recorder, Profiler& profiler);
+
+#endif
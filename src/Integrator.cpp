@@ -0,0 +1,264 @@
+/**
+ * Purpose: Implement the integrators declared in the Integrator.hpp header file.
+ *  The accelerations at the end of a step are the ones at the start of the next (the last kick and the first kick use the same positions),
+ *  so they are kept in the state and only calculated again when the caller marks them invalid.
+ *  wisdom-holman works in coordinates relative to the heaviest body: every other body follows its exact Kepler orbit around it during the drift,
+ *  and the kicks only add what the Kepler orbit leaves out (the pulls of the other bodies, minus the pull they have on the central body).
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include "Integrator.hpp"
+
+// Smallest number of bodies given to one thread, like in UpdateScheduler
+static const std::size_t minBodiesPerChunk = 2048;
+
+std::unique_ptr<Integrator> Integrator::create(const std::string& name) {
+    if (name == "leapfrog") {
+        return std::unique_ptr<Integrator>(new LeapfrogIntegrator());
+    }
+    if (name == "yoshida4") {
+        return std::unique_ptr<Integrator>(new Yoshida4Integrator());
+    }
+    if (name == "wisdom-holman") {
+        return std::unique_ptr<Integrator>(new WisdomHolmanIntegrator());
+    }
+    return nullptr;
+}
+
+void Integrator::kick(IntegratorState& state, double deltaTime, ThreadPool& pool) {
+    pool.parallelFor(state.count, minBodiesPerChunk, [&state, deltaTime](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            state.vx[i] += state.ax[i] * deltaTime;
+            state.vy[i] += state.ay[i] * deltaTime;
+        }
+    });
+}
+
+void Integrator::drift(IntegratorState& state, double deltaTime, ThreadPool& pool) {
+    pool.parallelFor(state.count, minBodiesPerChunk, [&state, deltaTime](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            state.x[i] += state.vx[i] * deltaTime;
+            state.y[i] += state.vy[i] * deltaTime;
+        }
+    });
+}
+
+void LeapfrogIntegrator::step(IntegratorState& state, double deltaTime, const AccelerationFunction& accelerations, ThreadPool& pool) {
+    if (!state.accelerationsValid) {
+        accelerations(state.mass);
+    }
+    kick(state, deltaTime / 2, pool);
+    drift(state, deltaTime, pool);
+    accelerations(state.mass);
+    kick(state, deltaTime / 2, pool);
+    state.accelerationsValid = true;
+}
+
+/**
+ * This function does three leapfrog steps of w1, w0 and w1 times deltaTime. w0 is negative (the middle step goes back in time),
+ * and the weights cancel the third-order error of the leapfrog. The half kicks between two of the steps are merged.
+ *
+ * */
+void Yoshida4Integrator::step(IntegratorState& state, double deltaTime, const AccelerationFunction& accelerations, ThreadPool& pool) {
+    const double cubeRootOfTwo = std::cbrt(2.0);
+    const double w1 = 1.0 / (2.0 - cubeRootOfTwo);
+    const double w0 = -cubeRootOfTwo / (2.0 - cubeRootOfTwo);
+    if (!state.accelerationsValid) {
+        accelerations(state.mass);
+    }
+    kick(state, w1 / 2 * deltaTime, pool);
+    drift(state, w1 * deltaTime, pool);
+    accelerations(state.mass);
+    kick(state, (w1 + w0) / 2 * deltaTime, pool);
+    drift(state, w0 * deltaTime, pool);
+    accelerations(state.mass);
+    kick(state, (w0 + w1) / 2 * deltaTime, pool);
+    drift(state, w1 * deltaTime, pool);
+    accelerations(state.mass);
+    kick(state, w1 / 2 * deltaTime, pool);
+    state.accelerationsValid = true;
+}
+
+/**
+ * This function calculates the accelerations without the central body: its pull is part of the Kepler orbits.
+ * The acceleration left in the slot of the central body is the pull of all the others on it.
+ *
+ * */
+void WisdomHolmanIntegrator::interactionAccelerations(IntegratorState& state, const AccelerationFunction& accelerations) {
+    interactionMass.assign(state.mass, state.mass + state.count);
+    interactionMass[central] = 0.0f;
+    accelerations(interactionMass.data());
+}
+
+/**
+ * This function kicks every body with the pulls of the others. The central body is kicked by their pull on it,
+ * and the pull of each body on the central body is added back to that body: relative to the central body, a body feels
+ * the pulls of the others minus what they do to the central body, and its own pull on it is already part of its Kepler orbit.
+ *
+ * */
+void WisdomHolmanIntegrator::interactionKick(IntegratorState& state, double deltaTime, ThreadPool& pool) {
+    double centerX = state.x[central];
+    double centerY = state.y[central];
+    double softening2 = static_cast<double>(state.softening) * state.softening;
+    pool.parallelFor(state.count, minBodiesPerChunk, [&, centerX, centerY, softening2, deltaTime](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            double extraX = 0.0, extraY = 0.0;
+            if (i != central && state.mass[i] != 0.0f) {
+                double dx = state.x[i] - centerX;
+                double dy = state.y[i] - centerY;
+                double d2 = dx * dx + dy * dy + softening2;
+                if (d2 > 0.0) {
+                    double strength = state.gravity * state.mass[i] / (d2 * std::sqrt(d2));
+                    extraX = dx * strength;
+                    extraY = dy * strength;
+                }
+            }
+            state.vx[i] += (state.ax[i] + extraX) * deltaTime;
+            state.vy[i] += (state.ay[i] + extraY) * deltaTime;
+        }
+    });
+}
+
+// The central body moves in a straight line during the drift, the others follow their Kepler orbits around it
+void WisdomHolmanIntegrator::keplerDrift(IntegratorState& state, double deltaTime, ThreadPool& pool) {
+    double centerX = state.x[central];
+    double centerY = state.y[central];
+    double centerVX = state.vx[central];
+    double centerVY = state.vy[central];
+    double centralMu = state.gravity * state.mass[central];
+    pool.parallelFor(state.count, minBodiesPerChunk / 8, [&, centerX, centerY, centerVX, centerVY, centralMu, deltaTime](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (i == central) {
+                continue;
+            }
+            double x = state.x[i] - centerX;
+            double y = state.y[i] - centerY;
+            double vx = state.vx[i] - centerVX;
+            double vy = state.vy[i] - centerVY;
+            if (!keplerStep(x, y, vx, vy, centralMu + state.gravity * state.mass[i], deltaTime)) {
+                x += vx * deltaTime; // On the central body: no orbit to follow
+                y += vy * deltaTime;
+            }
+            state.x[i] = centerX + centerVX * deltaTime + x;
+            state.y[i] = centerY + centerVY * deltaTime + y;
+            state.vx[i] = centerVX + vx;
+            state.vy[i] = centerVY + vy;
+        }
+    });
+    state.x[central] = centerX + centerVX * deltaTime;
+    state.y[central] = centerY + centerVY * deltaTime;
+}
+
+void WisdomHolmanIntegrator::step(IntegratorState& state, double deltaTime, const AccelerationFunction& accelerations, ThreadPool& pool) {
+    if (state.count == 0) {
+        return;
+    }
+    if (!state.accelerationsValid || central >= state.count) {
+        // The bodies or the masses changed: the heaviest body may be another one
+        central = 0;
+        for (std::size_t i = 1; i < state.count; ++i) {
+            if (state.mass[i] > state.mass[central]) {
+                central = i;
+            }
+        }
+        state.accelerationsValid = false;
+    }
+    if (state.mass[central] <= 0.0f) {
+        // No body has a mass: nothing to orbit, every body moves in a straight line
+        drift(state, deltaTime, pool);
+        return;
+    }
+    if (!state.accelerationsValid) {
+        interactionAccelerations(state, accelerations);
+    }
+    interactionKick(state, deltaTime / 2, pool);
+    keplerDrift(state, deltaTime, pool);
+    interactionAccelerations(state, accelerations);
+    interactionKick(state, deltaTime / 2, pool);
+    state.accelerationsValid = true;
+}
+
+// Stumpff functions c2(z) = (1 - cos(sqrt(z))) / z and c3(z) = (sqrt(z) - sin(sqrt(z))) / sqrt(z)^3, continued for z <= 0
+static void stumpff(double z, double& c2, double& c3) {
+    if (std::abs(z) < 1e-4) {
+        // Series: the closed forms lose all their digits near 0
+        c2 = 0.5 - z / 24.0 + z * z / 720.0;
+        c3 = 1.0 / 6.0 - z / 120.0 + z * z / 5040.0;
+    } else if (z > 0.0) {
+        double s = std::sqrt(z);
+        c2 = (1.0 - std::cos(s)) / z;
+        c3 = (s - std::sin(s)) / (z * s);
+    } else {
+        double s = std::sqrt(-z);
+        c2 = (std::cosh(s) - 1.0) / -z;
+        c3 = (std::sinh(s) - s) / (-z * s);
+    }
+}
+
+/**
+ * This function solves the universal Kepler equation for chi with the Laguerre-Conway iteration, which converges from a rough guess
+ * for ellipses and hyperbolas alike, then moves the body with the Lagrange f and g coefficients:
+ *   position = f * position0 + g * velocity0,   velocity = fDot * position0 + gDot * velocity0
+ *
+ * */
+bool keplerStep(double& x, double& y, double& vx, double& vy, double mu, double deltaTime) {
+    double r0 = std::sqrt(x * x + y * y);
+    if (r0 == 0.0 || mu <= 0.0 || deltaTime == 0.0) {
+        return false;
+    }
+    double sqrtMu = std::sqrt(mu);
+    double radialVelocity = (x * vx + y * vy) / r0;
+    double alpha = 2.0 / r0 - (vx * vx + vy * vy) / mu; // 1 / semi-major axis, negative for a hyperbola
+    double a0 = r0 * radialVelocity / sqrtMu;
+    double b0 = 1.0 - alpha * r0;
+
+    if (alpha > 1e-12) {
+        // Ellipse: whole periods change nothing, and a step of many periods would start the iteration on another revolution
+        double period = 6.283185307179586 / (sqrtMu * alpha * std::sqrt(alpha));
+        deltaTime = std::fmod(deltaTime, period);
+    }
+    double chi = sqrtMu * deltaTime / r0; // Exact for a short step
+    if (alpha > 0.0 && std::abs(chi) * std::sqrt(alpha) > 1.0) {
+        chi = sqrtMu * deltaTime * alpha; // More than a radian of eccentric anomaly: the mean motion is a better guess than the speed at r0
+    }
+    double c2 = 0.5, c3 = 1.0 / 6.0;
+    bool converged = false;
+    for (int iteration = 0; iteration < 50; ++iteration) {
+        double chi2 = chi * chi;
+        double z = alpha * chi2;
+        stumpff(z, c2, c3);
+        double f = a0 * chi2 * c2 + b0 * chi2 * chi * c3 + r0 * chi - sqrtMu * deltaTime;
+        double df = a0 * chi * (1.0 - z * c3) + b0 * chi2 * c2 + r0; // The distance at chi
+        double ddf = a0 * (1.0 - z * c2) + b0 * chi * (1.0 - z * c3);
+        const double n = 5.0;
+        double root = std::sqrt(std::abs((n - 1.0) * (n - 1.0) * df * df - n * (n - 1.0) * f * ddf));
+        double step = n * f / (df + std::copysign(root, df));
+        chi -= step;
+        if (std::abs(step) <= 1e-13 * std::max(1.0, std::abs(chi))) {
+            converged = true;
+            break;
+        }
+    }
+    if (!converged || !std::isfinite(chi)) {
+        return false;
+    }
+
+    double chi2 = chi * chi;
+    stumpff(alpha * chi2, c2, c3);
+    double f = 1.0 - chi2 / r0 * c2;
+    double g = deltaTime - chi2 * chi / sqrtMu * c3;
+    double newX = f * x + g * vx;
+    double newY = f * y + g * vy;
+    double r = std::sqrt(newX * newX + newY * newY);
+    double fDot = sqrtMu / (r * r0) * chi * (alpha * chi2 * c3 - 1.0);
+    double gDot = 1.0 - chi2 / r * c2;
+    double newVX = fDot * x + gDot * vx;
+    double newVY = fDot * y + gDot * vy;
+    x = newX;
+    y = newY;
+    vx = newVX;
+    vy = newVY;
+    return true;
+}
@@ -0,0 +1,90 @@
+/**
+ * This file declares the integrators of the N-body mode: the schemes that move the bodies by one time step from their accelerations.
+ * All of them are symplectic: they don't conserve the energy exactly, but its error stays bounded instead of growing,
+ * so an orbit doesn't spiral in or out over a long run the way it does with the simple Euler step.
+ *
+ *   leapfrog       kick-drift-kick, second order, one force calculation per step
+ *   yoshida4       three leapfrog steps with Yoshida's weights, fourth order, three force calculations per step
+ *   wisdom-holman  the motion around the heaviest body is solved exactly (a Kepler orbit), only the pulls of the other bodies are stepped.
+ *                  Second order in the small pulls, so it allows much larger steps for planets around a star; moons still need small steps
+ *
+ * The steps are built from "kicks" (velocities += acceleration * dt) and "drifts" (positions += velocity * dt),
+ * each one a loop over contiguous batches of bodies on the ThreadPool.
+ *
+ */
+
+#ifndef INTEGRATOR_HPP
+#define INTEGRATOR_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ThreadPool.hpp"
+
+// State of the bodies, owned by the caller. Every array has "count" elements
+struct IntegratorState {
+    double* x = nullptr;
+    double* y = nullptr;
+    double* vx = nullptr;
+    double* vy = nullptr;
+    double* ax = nullptr; // Accelerations at the current positions
+    double* ay = nullptr;
+    const float* mass = nullptr;
+    std::size_t count = 0;
+    double gravity = 1.0; // Gravitational constant and softening of the forces, needed by wisdom-holman for the part it solves itself
+    float softening = 0.0f;
+    bool accelerationsValid = false; // Set to false by the caller when the positions or the masses changed outside of step()
+};
+
+// Function that fills state.ax and state.ay for the current positions, with the masses given (the state's own or a modified copy)
+typedef std::function<void(const float* mass)> AccelerationFunction;
+
+class Integrator {
+public:
+    virtual ~Integrator() = default;
+
+    // Function to advance the state by deltaTime. The accelerations are left valid for the positions at the end of the step
+    virtual void step(IntegratorState& state, double deltaTime, const AccelerationFunction& accelerations, ThreadPool& pool) = 0;
+    virtual const char* getName() const = 0;
+
+    // Function to create an integrator by name (leapfrog, yoshida4 or wisdom-holman), returns nullptr for an unknown name
+    static std::unique_ptr<Integrator> create(const std::string& name);
+
+protected:
+    static void kick(IntegratorState& state, double deltaTime, ThreadPool& pool); // Function to add the accelerations times deltaTime to the velocities
+    static void drift(IntegratorState& state, double deltaTime, ThreadPool& pool); // Function to add the velocities times deltaTime to the positions
+};
+
+class LeapfrogIntegrator : public Integrator {
+public:
+    void step(IntegratorState& state, double deltaTime, const AccelerationFunction& accelerations, ThreadPool& pool) override;
+    const char* getName() const override { return "leapfrog"; }
+};
+
+class Yoshida4Integrator : public Integrator {
+public:
+    void step(IntegratorState& state, double deltaTime, const AccelerationFunction& accelerations, ThreadPool& pool) override;
+    const char* getName() const override { return "yoshida4"; }
+};
+
+class WisdomHolmanIntegrator : public Integrator {
+public:
+    void step(IntegratorState& state, double deltaTime, const AccelerationFunction& accelerations, ThreadPool& pool) override;
+    const char* getName() const override { return "wisdom-holman"; }
+
+private:
+    void interactionAccelerations(IntegratorState& state, const AccelerationFunction& accelerations); // Function to calculate the pulls of all bodies but the central one
+    void interactionKick(IntegratorState& state, double deltaTime, ThreadPool& pool); // Function to kick with the pulls, relative to the central body
+    void keplerDrift(IntegratorState& state, double deltaTime, ThreadPool& pool); // Function to move every body on its Kepler orbit around the central body
+
+    std::vector<float> interactionMass; // The masses with the central body set to 0
+    std::size_t central = 0; // Index of the heaviest body, the one the others orbit
+};
+
+// Function to move a body on its Kepler orbit (ellipse, parabola or hyperbola) around a fixed mass for deltaTime, with the universal variable.
+// The position and the velocity are relative to the mass, mu is G times the mass. It returns false if the solver didn't converge
+bool keplerStep(double& x, double& y, double& vx, double& vy, double mu, double deltaTime);
+
+#endif
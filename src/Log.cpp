@@ -0,0 +1,159 @@
+/**
+ * Purpose: Implement the logging facility declared in Log.hpp.
+ *  The ring buffer is a bounded multi-producer queue (the algorithm of Dmitry Vyukov): every slot has a sequence number
+ *  that tells whether it is free for the producer with a given position or filled for the consumer.
+ *  Producers reserve a position with a compare-and-swap and never take a lock; the background thread is the only consumer.
+ *
+ * */
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include "Log.hpp"
+
+// Number of slots of the ring buffer (a power of two) and maximum length of a message
+static const std::size_t ringCapacity = 4096;
+static const std::size_t messageLength = 240;
+
+struct LogSlot {
+    std::atomic<std::size_t> sequence{0};
+    LogLevel level = LogLevel::Info;
+    std::int64_t microseconds = 0; // Time of the message since the log was started
+    char text[messageLength];
+};
+
+// The ring buffer is static, so a producer that is still writing while the log stops never writes into freed memory
+static LogSlot slots[ringCapacity];
+static std::atomic<std::size_t> enqueuePosition{0};
+static std::size_t dequeuePosition = 0; // Only used by the background thread
+static std::atomic<std::size_t> droppedMessages{0};
+
+static std::atomic<int> minimumLevel{static_cast<int>(LogLevel::Off)};
+static std::atomic<bool> running{false};
+static std::thread writerThread;
+static std::FILE* logFile = nullptr;
+static std::chrono::steady_clock::time_point startTime;
+
+static const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warning: return "WARNING";
+        case LogLevel::Error: return "ERROR";
+        default: return "OFF";
+    }
+}
+
+// Function to write all filled slots to the file, returns the number of messages written
+static std::size_t drainSlots() {
+    std::size_t written = 0;
+    while (true) {
+        LogSlot& slot = slots[dequeuePosition & (ringCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+            break; // The next slot isn't filled yet
+        }
+        std::fprintf(logFile, "%10.6f [%s] %s\n", slot.microseconds / 1e6, levelName(slot.level), slot.text);
+        slot.sequence.store(dequeuePosition + ringCapacity, std::memory_order_release); // The slot is free for the producer one lap later
+        ++dequeuePosition;
+        ++written;
+    }
+    std::size_t dropped = droppedMessages.exchange(0);
+    if (dropped > 0) {
+        std::fprintf(logFile, "[log] %zu messages dropped because the ring buffer was full\n", dropped);
+    }
+    return written;
+}
+
+// Function run by the background thread: write the messages, and sleep a little when there are none
+static void writerLoop() {
+    while (running.load()) {
+        if (drainSlots() == 0) {
+            std::fflush(logFile);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    drainSlots(); // Write the messages that arrived while stopping
+    std::fflush(logFile);
+}
+
+bool Log::start(const std::string& filePath, LogLevel level) {
+    if (running.load()) {
+        stop();
+    }
+    logFile = std::fopen(filePath.c_str(), "w");
+    if (!logFile) {
+        std::fprintf(stderr, "Can't open log file '%s'\n", filePath.c_str());
+        return false;
+    }
+    for (std::size_t i = 0; i < ringCapacity; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed); // Slot i is free for the producer at position i
+    }
+    enqueuePosition.store(0);
+    dequeuePosition = 0;
+    startTime = std::chrono::steady_clock::now();
+    running.store(true);
+    writerThread = std::thread(writerLoop);
+    setLevel(level);
+    return true;
+}
+
+void Log::stop() {
+    if (!running.load()) {
+        return;
+    }
+    setLevel(LogLevel::Off); // No new messages
+    running.store(false);
+    writerThread.join();
+    std::fclose(logFile);
+    logFile = nullptr;
+}
+
+void Log::setLevel(LogLevel level) {
+    // Messages can only be written when the background thread is running
+    minimumLevel.store(running.load() ? static_cast<int>(level) : static_cast<int>(LogLevel::Off), std::memory_order_relaxed);
+}
+
+bool Log::isEnabled(LogLevel level) {
+    return static_cast<int>(level) >= minimumLevel.load(std::memory_order_relaxed);
+}
+
+LogLevel Log::parseLevel(const std::string& name) {
+    if (name == "debug") return LogLevel::Debug;
+    if (name == "info") return LogLevel::Info;
+    if (name == "warning") return LogLevel::Warning;
+    if (name == "error") return LogLevel::Error;
+    return LogLevel::Off;
+}
+
+void Log::write(LogLevel level, const char* format, ...) {
+    // Reserve a position in the ring buffer
+    std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    while (true) {
+        slot = &slots[position & (ringCapacity - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0) {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break; // The slot is ours
+            }
+        } else if (difference < 0) {
+            droppedMessages.fetch_add(1, std::memory_order_relaxed); // The ring buffer is full: drop the message instead of waiting
+            return;
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed); // Another producer took this position
+        }
+    }
+
+    // Fill the slot and publish it to the background thread
+    slot->level = level;
+    slot->microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    va_list arguments;
+    va_start(arguments, format);
+    std::vsnprintf(slot->text, messageLength, format, arguments);
+    va_end(arguments);
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
@@ -0,0 +1,50 @@
+/**
+ * This file declares the logging facility used for the diagnostics of the hot path (update and draw of every planet, every frame).
+ * A message is formatted into a slot of a fixed-size lock-free ring buffer, and a background thread writes the slots to a file,
+ * so logging never waits for the terminal or the disk. When the ring buffer is full, the message is dropped and counted instead of waiting.
+ *
+ * The LOG_* macros can be removed from the program at compile time: configure with -DSOLAR_ENABLE_LOGGING=OFF,
+ * then the macros expand to nothing and their arguments are not even evaluated.
+ * When logging is compiled in, the level is chosen at runtime and a disabled message only costs one atomic load and a branch.
+ *
+ */
+
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <string>
+
+// Levels of the messages, from the most verbose to the most important. Off disables all messages.
+enum class LogLevel { Debug = 0, Info = 1, Warning = 2, Error = 3, Off = 4 };
+
+class Log {
+public:
+    // Function to start the background thread that writes the messages to the specified file, with the specified minimum level
+    static bool start(const std::string& filePath, LogLevel level);
+    // Function to write the remaining messages and stop the background thread
+    static void stop();
+
+    static void setLevel(LogLevel level); // Function to change the minimum level of the messages that are written
+    static bool isEnabled(LogLevel level); // Function to check if a message of the specified level would be written
+    static LogLevel parseLevel(const std::string& name); // Function to convert "debug", "info", "warning", "error" or "off" to a level
+
+    // Function to format a message like printf and put it into the ring buffer. It never blocks.
+    static void write(LogLevel level, const char* format, ...)
+#ifdef __GNUC__
+        __attribute__((format(printf, 2, 3))) // Let the compiler check the format string like for printf
+#endif
+        ;
+};
+
+#if SOLAR_LOGGING
+#define SOLAR_LOG(level, ...) do { if (Log::isEnabled(level)) { Log::write(level, __VA_ARGS__); } } while (0)
+#else
+#define SOLAR_LOG(level, ...) do { } while (0)
+#endif
+
+#define LOG_DEBUG(...) SOLAR_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) SOLAR_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) SOLAR_LOG(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) SOLAR_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * Purpose: Implement the methods of the MappedFile class that are declared in the MappedFile.hpp header file.
+ *  On POSIX systems the file is mapped with mmap and the descriptor is closed right away: the mapping stays valid without it.
+ *
+ * */
+
+#include <fstream>
+#include <iterator>
+#include "MappedFile.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+#ifndef _WIN32
+    if (start && buffer.empty()) {
+        munmap(const_cast<unsigned char*>(start), length);
+    }
+#endif
+    buffer.clear();
+    start = nullptr;
+    length = 0;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#ifndef _WIN32
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size <= 0) {
+        ::close(file);
+        return false;
+    }
+    length = static_cast<std::size_t>(status.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file); // The mapping stays valid after the file is closed
+    if (mapping == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    start = static_cast<const unsigned char*>(mapping);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (buffer.empty()) {
+        return false;
+    }
+    start = buffer.data();
+    length = buffer.size();
+#endif
+    return true;
+}
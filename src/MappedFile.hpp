@@ -0,0 +1,35 @@
+/**
+ * This class maps a whole file into memory for reading, so a large binary file (the catalog snapshot, the ephemeris) is read in place:
+ * opening it costs nothing, and only the pages that are actually read are loaded from the disk.
+ * On systems without mmap the file is read into a buffer instead.
+ *
+ */
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile(); // Destructor to unmap the file
+
+    MappedFile(const MappedFile&) = delete; // The mapping belongs to one object
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path); // Function to map a file, returns false if it can't be opened or is empty
+    void close(); // Function to unmap the file
+
+    const unsigned char* data() const { return start; } // Start of the file in memory, nullptr when no file is open
+    std::size_t size() const { return length; } // Size of the file in bytes
+
+private:
+    const unsigned char* start = nullptr;
+    std::size_t length = 0;
+    std::vector<unsigned char> buffer; // Copy of the file on systems without mmap
+};
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ * Purpose: Implement the command line parsing declared in Options.hpp.
+ *
+ * */
+
+#include <cstdlib>
+#include <iostream>
+#include "Options.hpp"
+
+// Function to convert the value of an option to a number, returns false if the value isn't a number
+static bool toNumber(const std::string& value, double& number) {
+    char* end = nullptr;
+    number = std::strtod(value.c_str(), &end);
+    return !value.empty() && *end == '\0';
+}
+
+bool parseOptions(int argc, char* argv[], SimulationOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        std::string name = argument;
+        std::string value;
+        std::size_t equals = argument.find('=');
+        if (equals != std::string::npos) {
+            name = argument.substr(0, equals);
+            value = argument.substr(equals + 1);
+        }
+
+        double number = 0.0;
+        if (name == "--headless" && value.empty()) {
+            options.headless = true;
+        } else if (name == "--width" && toNumber(value, number) && number >= 1) {
+            options.width = static_cast<unsigned>(number);
+        } else if (name == "--height" && toNumber(value, number) && number >= 1) {
+            options.height = static_cast<unsigned>(number);
+        } else if (name == "--zoom" && toNumber(value, number) && number > 0) {
+            options.zoom = number;
+        } else if (name == "--follow" && !value.empty()) {
+            options.follow = value;
+        } else if (name == "--orbits" && value.empty()) {
+            options.orbits = true;
+        } else if (name == "--trails" && value.empty()) {
+            options.trails = true;
+        } else if (name == "--trail-memory" && toNumber(value, number) && number >= 1) {
+            options.trailMemory = static_cast<std::size_t>(number);
+        } else if (name == "--tick" && toNumber(value, number) && number > 0) {
+            options.tickSeconds = number;
+        } else if (name == "--time-warp" && toNumber(value, number) && number >= 0) {
+            options.timeWarp = number;
+        } else if (name == "--max-ticks" && toNumber(value, number) && number >= 1) {
+            options.maxTicksPerFrame = static_cast<int>(number);
+        } else if (name == "--start-time" && toNumber(value, number)) {
+            options.startTime = number;
+        } else if (name == "--stepped" && value.empty()) {
+            options.steppedOrbits = true;
+        } else if (name == "--frames" && toNumber(value, number) && number >= 1) {
+            options.frames = static_cast<int>(number);
+        } else if (name == "--time-step" && toNumber(value, number) && number > 0) {
+            options.timeStep = static_cast<float>(number);
+        } else if (name == "--output" && !value.empty()) {
+            options.frameOutput = value;
+        } else if (name == "--format" && (value == "png" || value == "raw")) {
+            options.frameFormat = value;
+        } else if (name == "--target-fps" && toNumber(value, number) && number >= 0) {
+            options.targetFps = static_cast<float>(number);
+        } else if (name == "--hud" && value.empty()) {
+            options.showOverlay = true;
+        } else if (name == "--hud-font" && !value.empty()) {
+            options.overlayFont = value;
+        } else if (name == "--profile-out" && !value.empty()) {
+            options.profileOutput = value;
+        } else if (name == "--no-live-updates" && value.empty()) {
+            options.liveUpdates = false;
+        } else if (name == "--snapshot" && !value.empty()) {
+            options.snapshotPath = value;
+        } else if (name == "--ephemeris" && !value.empty()) {
+            options.ephemerisPath = value;
+        } else if (name == "--build-ephemeris" && !value.empty()) {
+            options.ephemerisOutput = value;
+        } else if (name == "--ephemeris-span" && toNumber(value, number) && number > 0) {
+            options.ephemerisSpan = number;
+        } else if (name == "--ephemeris-window" && toNumber(value, number) && number > 0) {
+            options.ephemerisWindow = number;
+        } else if (name == "--ephemeris-coefficients" && toNumber(value, number) && number >= 2 && number <= 32) {
+            options.ephemerisCoefficients = static_cast<std::size_t>(number);
+        } else if (name == "--ephemeris-tolerance" && toNumber(value, number) && number > 0) {
+            options.ephemerisTolerance = number;
+        } else if (name == "--record" && !value.empty()) {
+            options.recordPath = value;
+        } else if (name == "--record-precision" && toNumber(value, number) && number > 0) {
+            options.recordPrecision = number;
+        } else if (name == "--record-keyframe" && toNumber(value, number) && number >= 1) {
+            options.recordKeyframe = static_cast<std::size_t>(number);
+        } else if (name == "--replay" && !value.empty()) {
+            options.replayPath = value;
+        } else if (name == "--nbody" && value.empty()) {
+            options.nbody = true;
+        } else if (name == "--gravity" && toNumber(value, number) && number >= 0) {
+            options.gravity = number;
+        } else if (name == "--theta" && toNumber(value, number) && number >= 0 && number <= 1) {
+            // Above about 1.4 the bmax rule lets a body take the cell it is in as one mass and pull on itself, so 1 is the limit
+            options.theta = static_cast<float>(number);
+        } else if (name == "--softening" && toNumber(value, number) && number >= 0) {
+            options.softening = static_cast<float>(number);
+        } else if (name == "--integrator" && (value == "leapfrog" || value == "yoshida4" || value == "wisdom-holman")) {
+            options.integrator = value;
+        } else if (name == "--energy-check" && toNumber(value, number) && number >= 0) {
+            options.diagnosticSteps = static_cast<std::size_t>(number);
+        } else if (name == "--benchmark-nbody" && value.empty()) {
+            options.benchmarkNBody = true;
+        } else if (name == "--benchmark-bodies" && toNumber(value, number) && number >= 1024) {
+            options.benchmarkBodies = static_cast<std::size_t>(number);
+        } else {
+            std::cerr << "Unknown or invalid option: " << argument << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void printUsage(const char* programName) {
+    std::cerr << "Usage: " << programName << " [options]\n"
+              << "  --width=N, --height=N  size of the window or of the rendered frames (default 1600x1200)\n"
+              << "  --zoom=X               pixels per world unit at startup (default 1, mouse wheel and + - keys to zoom)\n"
+              << "  --follow=NAME          keep the camera on a body (click a body to follow it, Escape to stop)\n"
+              << "  --orbits               draw the orbits of the bodies (key O toggles them)\n"
+              << "  --trails               draw the recent path of every body (key T toggles them, or the trail of the followed body)\n"
+              << "  --trail-memory=MB      memory for the points of all trails (default 16)\n"
+              << "  --tick=S               simulated seconds per fixed tick (default 1/120)\n"
+              << "  --time-warp=X          simulated seconds per wall-clock second (default 1, keys , and . halve and double it)\n"
+              << "  --max-ticks=N          maximum number of ticks per frame (default 2048)\n"
+              << "  --start-time=S         simulated time of the first frame, in seconds (key Home jumps back to 0)\n"
+              << "  --stepped              advance the orbits tick by tick instead of evaluating them in closed form\n"
+              << "  --ephemeris=FILE       read the positions of the bodies from an ephemeris table instead of running their model\n"
+              << "  --build-ephemeris=FILE fit an ephemeris table from the model of the bodies (with --nbody, the N-body mode), write it and stop\n"
+              << "  --ephemeris-span=S     simulated seconds covered by the table, from --start-time (default 3600)\n"
+              << "  --ephemeris-window=S   simulated seconds of one window of the table (default 16)\n"
+              << "  --ephemeris-coefficients=N  Chebyshev coefficients per coordinate, 2 to 32 (default 12)\n"
+              << "  --ephemeris-tolerance=X     largest error of the table, in world units (default 0.001)\n"
+              << "  --record=FILE          record the positions of the bodies at every frame to FILE, for --replay\n"
+              << "  --record-precision=X   step of the recorded positions, in world units (default 0.001)\n"
+              << "  --record-keyframe=N    frames between two keyframes of the recording, a seek decodes at most N frames (default 120)\n"
+              << "  --replay=FILE          play a recording back, without the database and without running any model\n"
+              << "  --nbody                move the bodies with their mutual gravity (mass column) instead of their scripted orbits\n"
+              << "  --gravity=G            gravitational constant of the N-body mode (default 1)\n"
+              << "  --theta=X              opening angle of the Barnes-Hut tree from 0 (the exact sum) to 1 (default 0.5)\n"
+              << "  --softening=S          softening length of the N-body mode, in world units (default 1)\n"
+              << "  --integrator=NAME      integrator of the N-body mode: leapfrog (default), yoshida4 or wisdom-holman\n"
+              << "  --energy-check=N       check the energy and angular momentum of the N-body mode every N steps (default 60, 0 for never)\n"
+              << "  --benchmark-nbody      compare the Barnes-Hut tree with the direct sum on random bodies and stop\n"
+              << "  --benchmark-bodies=N   largest number of bodies of the benchmark (default 262144)\n"
+              << "  --headless             run without a window\n"
+              << "  --frames=N             number of frames to simulate in headless mode (default 600)\n"
+              << "  --time-step=S          simulated seconds per frame in headless mode (default 1/60)\n"
+              << "  --output=PATH          render the frames: a directory for png, a file or - (stdout) for raw\n"
+              << "  --format=png|raw       format of the rendered frames (default png)\n"
+              << "  --target-fps=N         throughput target of the headless mode, checked at the end of the run\n"
+              << "  --hud                  show the frame-time overlay (toggle with F3)\n"
+              << "  --hud-font=FILE        .ttf font for the text of the overlay\n"
+              << "  --profile-out=FILE     write the frame-time statistics to FILE (.json or .csv) at exit\n"
+              << "  --no-live-updates      don't listen for changes of the planets table while running\n"
+              << "  --snapshot=FILE        load the planets from a binary snapshot when it matches the table, and rewrite it when it doesn't\n";
+}
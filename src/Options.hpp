@@ -0,0 +1,80 @@
+/**
+ * This file declares the options of the program and the function that reads them from the command line.
+ * Every option has the form --name or --name=value, for example: ./SolarSystemSimulation --headless --frames=600
+ *
+ */
+
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <cstddef>
+#include <string>
+
+struct SimulationOptions {
+    unsigned width = 1600; // Size of the window or of the rendered frames, in pixels
+    unsigned height = 1200;
+
+    // Camera, see Camera.hpp
+    double zoom = 1.0; // Pixels per world unit at startup, changed with the mouse wheel
+    std::string follow; // Name of the body the camera follows from the start, empty to look at the world origin
+
+    bool orbits = false; // Draw the orbit of every body around its parent, toggled with the O key, see OrbitPaths.hpp
+
+    // Orbit trails, see OrbitTrails.hpp
+    bool trails = false; // Draw the recent path of every body, toggled with the T key
+    std::size_t trailMemory = 16; // Memory for the points of all trails, in megabytes
+
+    // Fixed time step of the interactive mode
+    double tickSeconds = 1.0 / 120.0; // Simulated seconds per tick
+    double timeWarp = 1.0; // Simulated seconds per wall-clock second, changed with the , and . keys
+    int maxTicksPerFrame = 2048; // More ticks per frame are dropped, so a high time warp can't freeze the program
+    double startTime = 0.0; // Simulated time of the first frame, in seconds
+    bool steppedOrbits = false; // Advance the orbits tick by tick instead of evaluating them in closed form at the rendered time
+
+    bool liveUpdates = true; // Apply the changes of the planets table while running, see CatalogListener
+    std::string snapshotPath; // Binary snapshot of the planets table, read at startup when it is up to date. Empty for no snapshot
+
+    // Ephemeris, see Ephemeris.hpp
+    std::string ephemerisPath; // Table of positions to read the motion of the bodies from, instead of running their model. Empty for none
+    std::string ephemerisOutput; // Where to write the table fitted from the model (scripted orbits, or the N-body mode with --nbody), then stop
+    double ephemerisSpan = 3600.0; // Simulated seconds covered by the table, from the start time
+    double ephemerisWindow = 16.0; // Simulated seconds of one window of the table
+    std::size_t ephemerisCoefficients = 12; // Chebyshev coefficients per coordinate and piece
+    double ephemerisTolerance = 1e-3; // Largest distance between the table and the model, in world units
+
+    // Recording of the session, see Recording.hpp
+    std::string recordPath; // Where to record the state of the bodies at every frame. Empty for no recording
+    double recordPrecision = 1e-3; // Step of the recorded positions, in world units
+    std::size_t recordKeyframe = 120; // Frames between two keyframes of the recording
+    std::string replayPath; // Recording to play back instead of loading the planets and running their model. Empty for none
+
+    // N-body mode: the bodies move with their mutual gravity instead of their scripted orbits, see GravitySimulation
+    bool nbody = false;
+    double gravity = 1.0; // Gravitational constant, in units^3 / (mass * second^2)
+    float theta = 0.5f; // Opening angle of the Barnes-Hut tree, from 0 for the exact sum to 1
+    float softening = 1.0f; // Softening length in world units, keeps the force finite when two bodies meet
+    std::string integrator = "leapfrog"; // Scheme that moves the bodies: leapfrog, yoshida4 or wisdom-holman, see Integrator.hpp
+    std::size_t diagnosticSteps = 60; // Number of steps between two checks of the energy and the angular momentum, 0 for none
+    bool benchmarkNBody = false; // Print the benchmark of the tree against the direct sum and stop
+    std::size_t benchmarkBodies = 262144; // Largest number of bodies of the benchmark
+
+    // Headless mode: no window, for machines without a display
+    bool headless = false;
+    int frames = 600; // Number of frames to simulate in headless mode
+    float timeStep = 1.0f / 60.0f; // Simulated seconds per frame in headless mode
+    std::string frameOutput; // Where to write the rendered frames: a directory for png, a file (or "-" for stdout) for raw. Empty to only simulate
+    std::string frameFormat = "png"; // "png" for one image per frame, "raw" for a stream of RGBA pixels
+    float targetFps = 0.0f; // Throughput target of the headless mode in frames per second, 0 for no target
+
+    // Profiler
+    bool showOverlay = false; // Show the frame-time overlay at startup, it can be toggled with F3
+    std::string overlayFont; // Path of a .ttf font for the text of the overlay, without font only the bars are drawn
+    std::string profileOutput; // File where the frame-time statistics are written at exit (.json or .csv)
+};
+
+// Function to read the options from the command line, returns false if an option is unknown or has an invalid value
+bool parseOptions(int argc, char* argv[], SimulationOptions& options);
+// Function to print the list of options
+void printUsage(const char* programName);
+
+#endif
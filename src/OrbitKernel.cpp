@@ -0,0 +1,362 @@
+/**
+ * Purpose: Implement the batch orbit kernel and the Kepler solver declared in OrbitKernel.hpp.
+ *  The same algorithm is written three times: with AVX2 intrinsics, with SSE2 intrinsics and as plain scalar code.
+ *  The AVX2 functions are compiled with the target attribute, so the program still runs on processors without AVX2,
+ *  and the function pointer to use is selected once when the program starts.
+ *
+ * Sine and cosine: the angle x is reduced to r = x - j * pi/4 with |r| <= pi/4 (j even),
+ * then sin(r) and cos(r) are evaluated with polynomials, and the quadrant (j/2 mod 4) selects and negates the results:
+ *   quadrant 0: sin = sin(r),  cos = cos(r)
+ *   quadrant 1: sin = cos(r),  cos = -sin(r)
+ *   quadrant 2: sin = -sin(r), cos = -cos(r)
+ *   quadrant 3: sin = -cos(r), cos = sin(r)
+ *
+ * */
+
+#include <cmath>
+#include <string>
+#include "OrbitKernel.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ORBIT_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// Constants of the range reduction: pi/4 is split into three parts so that j * pi/4 is subtracted without rounding error
+static const float fourOverPi = 1.27323954473516f;
+static const float piOver4Part1 = 0.78515625f;
+static const float piOver4Part2 = 2.4187564849853515625e-4f;
+static const float piOver4Part3 = 3.77489497744594108e-8f;
+
+// Coefficients of the polynomials for sin(r) and cos(r) on [-pi/4, pi/4]
+static const float sinCoefficient1 = -1.6666654611e-1f;
+static const float sinCoefficient2 = 8.3321608736e-3f;
+static const float sinCoefficient3 = -1.9515295891e-4f;
+static const float cosCoefficient1 = 4.166664568298827e-2f;
+static const float cosCoefficient2 = -1.388731625493765e-3f;
+static const float cosCoefficient3 = 2.443315711809948e-5f;
+
+// Constants to wrap an angle to [-pi, pi]: 2*pi is split into the nearest float and the rest
+static const float oneOverTwoPi = 0.159154943091895f;
+static const float twoPiPart1 = 6.28318548202514648f;
+static const float twoPiPart2 = -1.7484555314695172e-7f;
+
+void fastSinCos(float angle, float& sine, float& cosine) {
+    float absolute = std::fabs(angle);
+    int j = static_cast<int>(absolute * fourOverPi);
+    j = (j + 1) & ~1; // Round up to an even number so that the reduced angle is in [-pi/4, pi/4]
+    float y = static_cast<float>(j);
+    float r = ((absolute - y * piOver4Part1) - y * piOver4Part2) - y * piOver4Part3;
+    float z = r * r;
+
+    float polySin = r + r * z * (sinCoefficient1 + z * (sinCoefficient2 + z * sinCoefficient3));
+    float polyCos = 1.0f - 0.5f * z + z * z * (cosCoefficient1 + z * (cosCoefficient2 + z * cosCoefficient3));
+
+    int quadrant = (j >> 1) & 3;
+    float s = (quadrant & 1) ? polyCos : polySin;
+    float c = (quadrant & 1) ? polySin : polyCos;
+    if (quadrant & 2) {
+        s = -s;
+    }
+    if ((quadrant + 1) & 2) {
+        c = -c;
+    }
+    sine = (angle < 0.0f) ? -s : s; // sin(-x) = -sin(x), cos(-x) = cos(x)
+    cosine = c;
+}
+
+// Function to wrap an angle to [-pi, pi], rounding to nearest like the SIMD versions
+static inline float wrapAngle(float angle) {
+    float turns = std::nearbyint(angle * oneOverTwoPi);
+    return (angle - turns * twoPiPart1) - turns * twoPiPart2;
+}
+
+// Scalar version of the kernel, used on processors without SSE2 and for the last bodies that don't fill a whole SIMD register
+static void propagateScalar(float* angle, const float* orbitSpeed, const float* distance, float* offsetX, float* offsetY,
+                            std::size_t count, float deltaTime) {
+    for (std::size_t i = 0; i < count; ++i) {
+        float a = wrapAngle(angle[i] + orbitSpeed[i] * deltaTime);
+        angle[i] = a;
+        float s, c;
+        fastSinCos(a, s, c);
+        offsetX[i] = distance[i] * c;
+        offsetY[i] = distance[i] * s;
+    }
+}
+
+/**
+ * Kepler's equation M = E - e * sin(E) is solved with a fixed number of Newton-Raphson steps, E -= (E - e*sin(E) - M) / (1 - e*cos(E)),
+ * starting from the guess of Danby, E = M + 0.85 * e * sign(sin(M)). With M in [-pi, pi], sign(sin(M)) is the sign of M.
+ * There is no test for convergence: every body takes the same steps, so the SIMD lanes never wait for each other and the time per body is constant.
+ * The sine and cosine of the final E are not computed again: they are derived from those of the previous E with a second order Taylor step,
+ * which is exact to float precision because the last step is tiny.
+ * The position in the plane of the orbit is (a * (cos(E) - e), a * sqrt(1 - e^2) * sin(E)), and the axes P and Q project it to the screen.
+ *
+ * */
+static void solveKeplerScalar(const float* meanAnomaly, const float* eccentricity, const float* distance,
+                              const float* axisPX, const float* axisPY, const float* axisQX, const float* axisQY,
+                              float* offsetX, float* offsetY, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        float m = meanAnomaly[i];
+        float e = eccentricity[i];
+        float anomaly = m + std::copysign(0.85f * e, m); // Eccentric anomaly E
+        float s = 0.0f, c = 1.0f, step = 0.0f;
+        for (int k = 0; k < keplerIterations; ++k) {
+            fastSinCos(anomaly, s, c);
+            step = (anomaly - e * s - m) / (1.0f - e * c);
+            anomaly -= step;
+        }
+        float halfStepSquared = 0.5f * step * step;
+        float sinE = s - step * c - halfStepSquared * s;
+        float cosE = c + step * s - halfStepSquared * c;
+
+        float x = distance[i] * (cosE - e);
+        float y = distance[i] * sinE;
+        offsetX[i] = x * axisPX[i] + y * axisQX[i];
+        offsetY[i] = x * axisPY[i] + y * axisQY[i];
+    }
+}
+
+#ifdef ORBIT_KERNEL_X86
+
+// Function to calculate the sine and cosine of 4 angles with SSE2 instructions, see the comment at the top of the file
+__attribute__((target("sse2")))
+static inline void sinCosSse2(__m128 a, __m128& s, __m128& c) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    // Range reduction
+    __m128 sign = _mm_and_ps(a, signMask);
+    __m128 absolute = _mm_andnot_ps(signMask, a);
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(absolute, _mm_set1_ps(fourOverPi)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(j);
+    __m128 r = _mm_sub_ps(absolute, _mm_mul_ps(y, _mm_set1_ps(piOver4Part1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(piOver4Part2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(piOver4Part3)));
+    __m128 z = _mm_mul_ps(r, r);
+
+    // Polynomials
+    __m128 polySin = _mm_add_ps(_mm_set1_ps(sinCoefficient2), _mm_mul_ps(z, _mm_set1_ps(sinCoefficient3)));
+    polySin = _mm_add_ps(_mm_set1_ps(sinCoefficient1), _mm_mul_ps(z, polySin));
+    polySin = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), polySin));
+    __m128 polyCos = _mm_add_ps(_mm_set1_ps(cosCoefficient2), _mm_mul_ps(z, _mm_set1_ps(cosCoefficient3)));
+    polyCos = _mm_add_ps(_mm_set1_ps(cosCoefficient1), _mm_mul_ps(z, polyCos));
+    polyCos = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_mul_ps(_mm_mul_ps(z, z), polyCos));
+
+    // Quadrant selection and signs
+    __m128i quadrant = _mm_srli_epi32(j, 1);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 flipSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+    __m128 flipCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    s = _mm_or_ps(_mm_and_ps(swap, polyCos), _mm_andnot_ps(swap, polySin));
+    c = _mm_or_ps(_mm_and_ps(swap, polySin), _mm_andnot_ps(swap, polyCos));
+    s = _mm_xor_ps(s, _mm_xor_ps(flipSin, sign));
+    c = _mm_xor_ps(c, flipCos);
+}
+
+// Function to calculate the sine and cosine of 8 angles with AVX2 instructions, with fused multiply-add for the polynomials
+__attribute__((target("avx2,fma")))
+static inline void sinCosAvx2(__m256 a, __m256& s, __m256& c) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    // Range reduction
+    __m256 sign = _mm256_and_ps(a, signMask);
+    __m256 absolute = _mm256_andnot_ps(signMask, a);
+    __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(absolute, _mm256_set1_ps(fourOverPi)));
+    j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+    __m256 y = _mm256_cvtepi32_ps(j);
+    __m256 r = _mm256_fnmadd_ps(y, _mm256_set1_ps(piOver4Part1), absolute);
+    r = _mm256_fnmadd_ps(y, _mm256_set1_ps(piOver4Part2), r);
+    r = _mm256_fnmadd_ps(y, _mm256_set1_ps(piOver4Part3), r);
+    __m256 z = _mm256_mul_ps(r, r);
+
+    // Polynomials
+    __m256 polySin = _mm256_fmadd_ps(z, _mm256_set1_ps(sinCoefficient3), _mm256_set1_ps(sinCoefficient2));
+    polySin = _mm256_fmadd_ps(z, polySin, _mm256_set1_ps(sinCoefficient1));
+    polySin = _mm256_fmadd_ps(_mm256_mul_ps(r, z), polySin, r);
+    __m256 polyCos = _mm256_fmadd_ps(z, _mm256_set1_ps(cosCoefficient3), _mm256_set1_ps(cosCoefficient2));
+    polyCos = _mm256_fmadd_ps(z, polyCos, _mm256_set1_ps(cosCoefficient1));
+    polyCos = _mm256_fmadd_ps(_mm256_mul_ps(z, z), polyCos, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, _mm256_set1_ps(1.0f)));
+
+    // Quadrant selection and signs
+    __m256i quadrant = _mm256_srli_epi32(j, 1);
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+    __m256 flipSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+    __m256 flipCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+    s = _mm256_blendv_ps(polySin, polyCos, swap);
+    c = _mm256_blendv_ps(polyCos, polySin, swap);
+    s = _mm256_xor_ps(s, _mm256_xor_ps(flipSin, sign));
+    c = _mm256_xor_ps(c, flipCos);
+}
+
+// SSE2 version of the kernel: 4 bodies per iteration
+__attribute__((target("sse2")))
+static void propagateSse2(float* angle, const float* orbitSpeed, const float* distance, float* offsetX, float* offsetY,
+                          std::size_t count, float deltaTime) {
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Advance and wrap the angle
+        __m128 a = _mm_add_ps(_mm_loadu_ps(angle + i), _mm_mul_ps(_mm_loadu_ps(orbitSpeed + i), dt));
+        __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(a, _mm_set1_ps(oneOverTwoPi))));
+        a = _mm_sub_ps(_mm_sub_ps(a, _mm_mul_ps(turns, _mm_set1_ps(twoPiPart1))), _mm_mul_ps(turns, _mm_set1_ps(twoPiPart2)));
+        _mm_storeu_ps(angle + i, a);
+
+        __m128 s, c;
+        sinCosSse2(a, s, c);
+        __m128 d = _mm_loadu_ps(distance + i);
+        _mm_storeu_ps(offsetX + i, _mm_mul_ps(d, c));
+        _mm_storeu_ps(offsetY + i, _mm_mul_ps(d, s));
+    }
+    propagateScalar(angle + i, orbitSpeed + i, distance + i, offsetX + i, offsetY + i, count - i, deltaTime);
+}
+
+// AVX2 version of the kernel: 8 bodies per iteration
+__attribute__((target("avx2,fma")))
+static void propagateAvx2(float* angle, const float* orbitSpeed, const float* distance, float* offsetX, float* offsetY,
+                          std::size_t count, float deltaTime) {
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Advance and wrap the angle
+        __m256 a = _mm256_fmadd_ps(_mm256_loadu_ps(orbitSpeed + i), dt, _mm256_loadu_ps(angle + i));
+        __m256 turns = _mm256_round_ps(_mm256_mul_ps(a, _mm256_set1_ps(oneOverTwoPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        a = _mm256_fnmadd_ps(turns, _mm256_set1_ps(twoPiPart1), a);
+        a = _mm256_fnmadd_ps(turns, _mm256_set1_ps(twoPiPart2), a);
+        _mm256_storeu_ps(angle + i, a);
+
+        __m256 s, c;
+        sinCosAvx2(a, s, c);
+        __m256 d = _mm256_loadu_ps(distance + i);
+        _mm256_storeu_ps(offsetX + i, _mm256_mul_ps(d, c));
+        _mm256_storeu_ps(offsetY + i, _mm256_mul_ps(d, s));
+    }
+    propagateSse2(angle + i, orbitSpeed + i, distance + i, offsetX + i, offsetY + i, count - i, deltaTime);
+}
+
+// SSE2 version of the Kepler solver: 4 bodies per iteration
+__attribute__((target("sse2")))
+static void solveKeplerSse2(const float* meanAnomaly, const float* eccentricity, const float* distance,
+                            const float* axisPX, const float* axisPY, const float* axisQX, const float* axisQY,
+                            float* offsetX, float* offsetY, std::size_t count) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 m = _mm_loadu_ps(meanAnomaly + i);
+        __m128 e = _mm_loadu_ps(eccentricity + i);
+        __m128 anomaly = _mm_add_ps(m, _mm_or_ps(_mm_mul_ps(_mm_set1_ps(0.85f), e), _mm_and_ps(m, signMask)));
+        __m128 s = _mm_setzero_ps(), c = one, step = _mm_setzero_ps();
+        for (int k = 0; k < keplerIterations; ++k) {
+            sinCosSse2(anomaly, s, c);
+            step = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(anomaly, _mm_mul_ps(e, s)), m), _mm_sub_ps(one, _mm_mul_ps(e, c)));
+            anomaly = _mm_sub_ps(anomaly, step);
+        }
+        __m128 halfStepSquared = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_mul_ps(step, step));
+        __m128 sinE = _mm_sub_ps(_mm_sub_ps(s, _mm_mul_ps(step, c)), _mm_mul_ps(halfStepSquared, s));
+        __m128 cosE = _mm_sub_ps(_mm_add_ps(c, _mm_mul_ps(step, s)), _mm_mul_ps(halfStepSquared, c));
+
+        __m128 d = _mm_loadu_ps(distance + i);
+        __m128 x = _mm_mul_ps(d, _mm_sub_ps(cosE, e));
+        __m128 y = _mm_mul_ps(d, sinE);
+        _mm_storeu_ps(offsetX + i, _mm_add_ps(_mm_mul_ps(x, _mm_loadu_ps(axisPX + i)), _mm_mul_ps(y, _mm_loadu_ps(axisQX + i))));
+        _mm_storeu_ps(offsetY + i, _mm_add_ps(_mm_mul_ps(x, _mm_loadu_ps(axisPY + i)), _mm_mul_ps(y, _mm_loadu_ps(axisQY + i))));
+    }
+    solveKeplerScalar(meanAnomaly + i, eccentricity + i, distance + i, axisPX + i, axisPY + i, axisQX + i, axisQY + i,
+                      offsetX + i, offsetY + i, count - i);
+}
+
+// AVX2 version of the Kepler solver: 8 bodies per iteration
+__attribute__((target("avx2,fma")))
+static void solveKeplerAvx2(const float* meanAnomaly, const float* eccentricity, const float* distance,
+                            const float* axisPX, const float* axisPY, const float* axisQX, const float* axisQY,
+                            float* offsetX, float* offsetY, std::size_t count) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 m = _mm256_loadu_ps(meanAnomaly + i);
+        __m256 e = _mm256_loadu_ps(eccentricity + i);
+        __m256 anomaly = _mm256_add_ps(m, _mm256_or_ps(_mm256_mul_ps(_mm256_set1_ps(0.85f), e), _mm256_and_ps(m, signMask)));
+        __m256 s = _mm256_setzero_ps(), c = one, step = _mm256_setzero_ps();
+        for (int k = 0; k < keplerIterations; ++k) {
+            sinCosAvx2(anomaly, s, c);
+            step = _mm256_div_ps(_mm256_sub_ps(_mm256_fnmadd_ps(e, s, anomaly), m), _mm256_fnmadd_ps(e, c, one));
+            anomaly = _mm256_sub_ps(anomaly, step);
+        }
+        __m256 halfStepSquared = _mm256_mul_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(step, step));
+        __m256 sinE = _mm256_fnmadd_ps(halfStepSquared, s, _mm256_fnmadd_ps(step, c, s));
+        __m256 cosE = _mm256_fnmadd_ps(halfStepSquared, c, _mm256_fmadd_ps(step, s, c));
+
+        __m256 d = _mm256_loadu_ps(distance + i);
+        __m256 x = _mm256_mul_ps(d, _mm256_sub_ps(cosE, e));
+        __m256 y = _mm256_mul_ps(d, sinE);
+        _mm256_storeu_ps(offsetX + i, _mm256_fmadd_ps(y, _mm256_loadu_ps(axisQX + i), _mm256_mul_ps(x, _mm256_loadu_ps(axisPX + i))));
+        _mm256_storeu_ps(offsetY + i, _mm256_fmadd_ps(y, _mm256_loadu_ps(axisQY + i), _mm256_mul_ps(x, _mm256_loadu_ps(axisPY + i))));
+    }
+    solveKeplerSse2(meanAnomaly + i, eccentricity + i, distance + i, axisPX + i, axisPY + i, axisQX + i, axisQY + i,
+                    offsetX + i, offsetY + i, count - i);
+}
+
+#endif
+
+// Types of the kernel functions, used for the runtime dispatch
+typedef void (*PropagateFunction)(float*, const float*, const float*, float*, float*, std::size_t, float);
+typedef void (*KeplerFunction)(const float*, const float*, const float*, const float*, const float*, const float*, const float*,
+                               float*, float*, std::size_t);
+
+// Functions of one instruction set
+struct OrbitKernels {
+    PropagateFunction propagate;
+    KeplerFunction kepler;
+    const char* name;
+};
+
+// Function to choose the fastest kernels supported by the processor
+static OrbitKernels selectKernels() {
+#ifdef ORBIT_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return OrbitKernels{propagateAvx2, solveKeplerAvx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return OrbitKernels{propagateSse2, solveKeplerSse2, "sse2"};
+    }
+#endif
+    return OrbitKernels{propagateScalar, solveKeplerScalar, "scalar"};
+}
+
+static OrbitKernels kernels = selectKernels(); // Selected once, when the program starts
+
+bool selectOrbitKernel(const std::string& name) {
+    if (name == "scalar") {
+        kernels = OrbitKernels{propagateScalar, solveKeplerScalar, "scalar"};
+        return true;
+    }
+#ifdef ORBIT_KERNEL_X86
+    if (name == "sse2" && __builtin_cpu_supports("sse2")) {
+        kernels = OrbitKernels{propagateSse2, solveKeplerSse2, "sse2"};
+        return true;
+    }
+    if (name == "avx2" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        kernels = OrbitKernels{propagateAvx2, solveKeplerAvx2, "avx2"};
+        return true;
+    }
+#endif
+    return false;
+}
+
+void propagateOrbits(float* angle, const float* orbitSpeed, const float* distance, float* offsetX, float* offsetY,
+                     std::size_t count, float deltaTime) {
+    kernels.propagate(angle, orbitSpeed, distance, offsetX, offsetY, count, deltaTime);
+}
+
+void solveKeplerOrbits(const float* meanAnomaly, const float* eccentricity, const float* distance,
+                       const float* axisPX, const float* axisPY, const float* axisQX, const float* axisQY,
+                       float* offsetX, float* offsetY, std::size_t count) {
+    kernels.kepler(meanAnomaly, eccentricity, distance, axisPX, axisPY, axisQX, axisQY, offsetX, offsetY, count);
+}
+
+const char* orbitKernelName() {
+    return kernels.name;
+}
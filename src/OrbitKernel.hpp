@@ -0,0 +1,63 @@
+/**
+ * This file declares the batch kernel that advances the orbit angles of many bodies at once and calculates their positions
+ * relative to the body they're orbiting around.
+ * The kernel works on the contiguous arrays of the BodyStore and uses AVX2 (8 bodies per instruction) or SSE2 (4 bodies per instruction)
+ * when the processor supports it. The instruction set is chosen once at runtime, and a scalar loop is used on other processors.
+ *
+ * Precision: the angles are kept wrapped to [-pi, pi] and sine and cosine are approximated with minimax polynomials (the ones of the Cephes library).
+ * For angles in [-pi, pi] the absolute error of the approximated sine and cosine is at most 2.5e-7 (about 2 ulp of 1.0f).
+ * Starting from the same angle, a position differs from the previous per-planet path (std::cos/std::sin) by at most
+ * orbitKernelTolerance * distance, which is less than 0.001 pixel for Neptune.
+ * Over long runs the kernel is more accurate than the previous path, because a wrapped angle keeps its precision
+ * while an accumulated float angle loses one bit every time it doubles.
+ *
+ * Elliptical orbits: the angle of a body is its mean anomaly, and solveKeplerOrbits turns it into a position on an ellipse.
+ * The solver takes keplerIterations Newton-Raphson steps for every body, with the same SIMD instruction sets as the orbit kernel.
+ * For eccentricities up to maxEccentricity the position differs from the exact solution by at most orbitKernelTolerance * distance;
+ * above it, float precision isn't enough near the periapsis, so BodyStore clamps the eccentricity.
+ *
+ */
+
+#ifndef ORBITKERNEL_HPP
+#define ORBITKERNEL_HPP
+
+#include <cstddef>
+#include <string>
+
+// Maximum difference between the sine (or cosine) calculated by the kernel and std::sin (or std::cos), for the same angle in [-pi, pi]
+const float sinCosMaxError = 2.5e-7f;
+// Maximum difference between a position calculated by the kernel and by std::cos/std::sin, relative to the distance of the orbit.
+// It includes the error of wrapping the angle, which is at most half an ulp of 2*pi.
+const float orbitKernelTolerance = 1e-6f;
+
+// Number of Newton-Raphson steps of the Kepler solver, the same for every body so the time per body is constant
+const int keplerIterations = 5;
+// Largest eccentricity the Kepler solver is accurate for
+const float maxEccentricity = 0.95f;
+
+// Function to calculate the sine and cosine of an angle with the same polynomials as the SIMD kernel
+void fastSinCos(float angle, float& sine, float& cosine);
+
+/**
+ * Advances the angle of count bodies by orbitSpeed * deltaTime, wraps it to [-pi, pi],
+ * and writes the position relative to the parent (distance * cos(angle), distance * sin(angle)) to offsetX and offsetY.
+ */
+void propagateOrbits(float* angle, const float* orbitSpeed, const float* distance, float* offsetX, float* offsetY,
+                     std::size_t count, float deltaTime);
+
+/**
+ * Solves Kepler's equation for count bodies and writes their positions relative to the parent to offsetX and offsetY.
+ * meanAnomaly is the angle advanced by propagateOrbits and distance is the semi-major axis.
+ * The axes P (towards the periapsis) and Q (90 degrees ahead, scaled by sqrt(1 - e^2)) project the orbit plane to the screen,
+ * see BodyStore::setOrbitElements. With e = 0, P = (1, 0) and Q = (0, 1) the result is the circle of propagateOrbits.
+ */
+void solveKeplerOrbits(const float* meanAnomaly, const float* eccentricity, const float* distance,
+                       const float* axisPX, const float* axisPY, const float* axisQX, const float* axisQY,
+                       float* offsetX, float* offsetY, std::size_t count);
+
+// Function to get the name of the instruction set used by propagateOrbits and solveKeplerOrbits: "avx2", "sse2" or "scalar"
+const char* orbitKernelName();
+// Function to use the kernels of another instruction set, so the tests can compare all of them. It returns false if the processor doesn't support it
+bool selectOrbitKernel(const std::string& name);
+
+#endif
@@ -0,0 +1,267 @@
+/**
+ * Purpose: Implement the methods of the OrbitPaths class that are declared in the OrbitPaths.hpp header file.
+ *  An orbit is the ellipse offset(E) = a * (cos(E) - e) * P + a * sin(E) * Q, with the axes P and Q of the BodyStore (already tilted by the inclination).
+ *  Along it, the direction of the line turns by |r' x r''| / |r'|^2 per unit of E, and |r' x r''| = a^2 * |P x Q| is the same everywhere.
+ *  A segment that turns the line by phi stays within rho * (1 - cos(phi / 2)) of a curve of radius of curvature rho, which sets the step of E.
+ *  The orbits of a group are joined in one line strip; the segment from one orbit to the next is transparent.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include "OrbitPaths.hpp"
+#include "Log.hpp"
+
+// Largest distance in pixels between the drawn line and the true ellipse, like the outline of the bodies in BodyRenderer
+static const double outlineTolerance = 0.25;
+// Orbits with a semi-major axis smaller than this on the screen, in pixels, are left out
+static const double minScreenRadius = 1.0;
+// Semi-major axis on the screen, in pixels, above which an orbit is drawn as an arc every frame. A larger orbit is mostly outside the view,
+// so keeping all its points (hundreds per orbit) would only fill the memory and the draw calls
+static const double maxCachedRadius = 4096.0;
+// Smallest and largest steps of E: at most 4096 segments per orbit, at least 6
+static const double minStep = 6.283185307179586 / 4096;
+static const double maxStep = 6.283185307179586 / 6;
+// Number of segments of the arc of a large orbit
+static const std::size_t arcSegments = 128;
+// Opacity of the orbit lines
+static const sf::Uint8 orbitOpacity = 70;
+
+// Function to get the largest distance of the orbits of some bodies from their parent (the apoapsis)
+static double reachOf(const BodyStore& bodies, const std::vector<std::uint32_t>& members) {
+    double reach = 0.0;
+    for (std::uint32_t i : members) {
+        reach = std::max(reach, static_cast<double>(bodies.distance[i]) * (1.0 + bodies.eccentricity[i]));
+    }
+    return reach;
+}
+
+/**
+ * This function sorts the bodies into groups by parent. A group whose members are the same as before keeps its vertex array,
+ * so a body added to one system doesn't make the orbits of the others be calculated again.
+ *
+ * */
+void OrbitPaths::regroup(const BodyStore& bodies) {
+    grouped = true;
+    groupedSize = bodies.size();
+    groupedHierarchy = bodies.getHierarchyVersion();
+    checkedOrbits = bodies.getOrbitVersion();
+
+    std::vector<Group> old;
+    old.swap(groups);
+    std::vector<int> oldGroupOf;
+    oldGroupOf.swap(groupOf);
+    groupOf.assign(bodies.size() + 1, -1);
+    std::vector<std::vector<std::uint32_t>> members;
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        if (!bodies.isAlive(i) || !(bodies.distance[i] > 0.0f)) {
+            continue; // No orbit to draw
+        }
+        std::size_t key = static_cast<std::size_t>(bodies.parent[i] + 1);
+        if (groupOf[key] < 0) {
+            groupOf[key] = static_cast<int>(members.size());
+            members.emplace_back();
+        }
+        members[groupOf[key]].push_back(static_cast<std::uint32_t>(i));
+    }
+
+    groups.resize(members.size());
+    for (std::size_t key = 0; key < groupOf.size(); ++key) {
+        if (groupOf[key] < 0) {
+            continue;
+        }
+        Group& group = groups[groupOf[key]];
+        int previous = key < oldGroupOf.size() ? oldGroupOf[key] : -1;
+        if (previous >= 0 && old[previous].members == members[groupOf[key]]) {
+            group = std::move(old[previous]); // Same bodies around the same parent: the array is still right if their orbits didn't change
+        } else {
+            group.members.swap(members[groupOf[key]]);
+            group.built = false;
+        }
+        group.parent = static_cast<int>(key) - 1;
+        group.reach = reachOf(bodies, group.members);
+    }
+    LOG_DEBUG("Orbit paths: %zu bodies in %zu groups", bodies.size(), groups.size());
+}
+
+/**
+ * This function calculates the orbits of a group relative to the parent, for the largest zoom of a level of detail.
+ * The step of E is chosen at every point from the curvature of the ellipse there, so the segments are short where the ellipse bends.
+ *
+ * */
+void OrbitPaths::build(const BodyStore& bodies, Group& group, int level) {
+    double zoom = std::ldexp(1.0, level + 1);
+    group.vertices.clear(); // Keeps its memory: a group of the same size is built again without allocating
+    group.versions.clear();
+    group.large.clear();
+    for (std::uint32_t i : group.members) {
+        group.versions.push_back(bodies.orbitVersion[i]);
+        double a = bodies.distance[i];
+        double e = bodies.eccentricity[i];
+        if (a * zoom < minScreenRadius) {
+            continue; // Smaller than a pixel
+        }
+        if (a * zoom > maxCachedRadius) {
+            group.large.push_back(i); // Drawn as an arc around the view
+            continue;
+        }
+        double px = bodies.axisPX[i], py = bodies.axisPY[i], qx = bodies.axisQX[i], qy = bodies.axisQY[i];
+        double cross = std::abs(px * qy - py * qx) * a * a; // |r' x r''|, 0 for an orbit seen edge-on (a straight line)
+        sf::Color color = bodies.color[i];
+        color.a = orbitOpacity;
+        sf::Color transparent = color;
+        transparent.a = 0;
+
+        sf::Vector2f first(static_cast<float>(a * (1.0 - e) * px), static_cast<float>(a * (1.0 - e) * py)); // Periapsis, at E = 0
+        group.vertices.append(sf::Vertex(first, transparent)); // End of the transparent segment from the previous orbit
+        for (double E = 0.0; E < 6.283185307179586;) {
+            double cosE = std::cos(E), sinE = std::sin(E);
+            double x = a * (cosE - e);
+            double y = a * sinE;
+            group.vertices.append(sf::Vertex(sf::Vector2f(static_cast<float>(x * px + y * qx), static_cast<float>(x * py + y * qy)), color));
+            // Derivative r' and the turn of the line per unit of E
+            double dx = a * (-sinE * px + cosE * qx);
+            double dy = a * (-sinE * py + cosE * qy);
+            double speed2 = dx * dx + dy * dy;
+            double step = maxStep;
+            if (cross > 0.0 && speed2 > 0.0) {
+                double turnRate = cross / speed2;
+                double screenRadius = speed2 * std::sqrt(speed2) / cross * zoom; // Radius of curvature on the screen
+                double turn = screenRadius > outlineTolerance ? 2.0 * std::acos(1.0 - outlineTolerance / screenRadius) : maxStep;
+                step = std::min(std::max(turn / turnRate, minStep), maxStep);
+            }
+            E += step;
+        }
+        group.vertices.append(sf::Vertex(first, color)); // Close the ellipse
+        group.vertices.append(sf::Vertex(first, transparent));
+    }
+    group.level = level;
+    group.built = true;
+    ++builds;
+}
+
+/**
+ * This function adds the part of a large orbit that crosses the view, if it does. The point of the orbit facing the center of the view is found
+ * by writing the center in the frame of the orbit (its coordinates along P and Q), then enough of the orbit on both sides to cross the view.
+ * The points are calculated in double and moved to the origin before they are rounded to float.
+ *
+ * */
+void OrbitPaths::appendArc(const BodyStore& bodies, std::size_t index, float alpha, sf::Vector2<double> parentPosition, sf::Vector2<double> origin,
+                           const sf::Rect<double>& area, double zoom) {
+    double a = bodies.distance[index];
+    double e = bodies.eccentricity[index];
+    double px = bodies.axisPX[index], py = bodies.axisPY[index], qx = bodies.axisQX[index], qy = bodies.axisQY[index];
+    double determinant = px * qy - py * qx;
+    if (std::abs(determinant) < 1e-9) {
+        return; // Seen edge-on
+    }
+    // The orbit kernel places the body in float, a little off the ellipse calculated here: at this size that is visible, so the ellipse is moved
+    // by the difference at the body (found like the center below) to go through it
+    sf::Vector2<double> body = bodies.interpolatedPosition(index, alpha) - parentPosition;
+    double bodyX = (body.x * qy - body.y * qx) / (determinant * a);
+    double bodyY = (px * body.y - py * body.x) / (determinant * a);
+    double bodyE = std::atan2(bodyY, bodyX + e);
+    double ex = a * (std::cos(bodyE) - e), ey = a * std::sin(bodyE);
+    sf::Vector2<double> focus = parentPosition + body - sf::Vector2<double>(ex * px + ey * qx, ex * py + ey * qy);
+
+    double centerX = (area.left + area.width / 2 - focus.x) / a;
+    double centerY = (area.top + area.height / 2 - focus.y) / a;
+    double x = (centerX * qy - centerY * qx) / determinant; // (cos(E) - e, sin(E)) of the center
+    double y = (px * centerY - py * centerX) / determinant;
+    // In that frame the orbit is the unit circle. A distance d from it is at least d * a * |det| / sqrt(|P|^2 + |Q|^2) in the world,
+    // so the orbit can't cross the view if that is more than half the diagonal of the view
+    double fromCircle = std::abs(std::hypot(x + e, y) - 1.0);
+    double diagonal = std::hypot(area.width, area.height);
+    if (fromCircle * a * std::abs(determinant) / std::sqrt(px * px + py * py + qx * qx + qy * qy) > diagonal / 2) {
+        return;
+    }
+    double middle = std::atan2(y, x + e);
+    double speed = a * std::hypot(-std::sin(middle) * px + std::cos(middle) * qx, -std::sin(middle) * py + std::cos(middle) * qy);
+    double halfRange = std::min(3.141592653589793, diagonal / std::max(speed, 1.0 / zoom));
+
+    sf::Color color = bodies.color[index];
+    color.a = orbitOpacity;
+    sf::Color transparent = color;
+    transparent.a = 0;
+    for (std::size_t k = 0; k <= arcSegments; ++k) {
+        double E = middle - halfRange + 2.0 * halfRange * k / arcSegments;
+        double ox = a * (std::cos(E) - e);
+        double oy = a * std::sin(E);
+        sf::Vector2f point(static_cast<float>(focus.x - origin.x + ox * px + oy * qx),
+                           static_cast<float>(focus.y - origin.y + ox * py + oy * qy));
+        if (k == 0) {
+            arcs.append(sf::Vertex(point, transparent));
+        }
+        arcs.append(sf::Vertex(point, color));
+        if (k == arcSegments) {
+            arcs.append(sf::Vertex(point, transparent));
+        }
+    }
+}
+
+/**
+ * This function draws the groups that can be seen. A group is skipped when the square around its parent that holds all its orbits
+ * is outside the view, or smaller than a pixel. Its array is built again only if it is out of date.
+ *
+ * */
+void OrbitPaths::render(const BodyStore& bodies, sf::RenderTarget& target, float alpha, sf::Vector2<double> origin) {
+    drawCalls = 0;
+    vertexCount = 0;
+    if (!grouped || bodies.size() != groupedSize || bodies.getHierarchyVersion() != groupedHierarchy) {
+        regroup(bodies);
+    } else if (bodies.getOrbitVersion() != checkedOrbits) {
+        // Some orbits changed: find their groups
+        checkedOrbits = bodies.getOrbitVersion();
+        for (auto& group : groups) {
+            if (!group.built) {
+                // Never drawn (culled so far): nothing to build again, but its reach decides if it is culled, so it must follow its orbits
+                group.reach = reachOf(bodies, group.members);
+                continue;
+            }
+            for (std::size_t k = 0; k < group.members.size(); ++k) {
+                if (group.versions[k] != bodies.orbitVersion[group.members[k]]) {
+                    group.built = false;
+                    group.reach = reachOf(bodies, group.members);
+                    break;
+                }
+            }
+        }
+    }
+
+    const sf::View& view = target.getView();
+    sf::IntRect viewport = target.getViewport(view);
+    double zoom = std::max(viewport.width / view.getSize().x, viewport.height / view.getSize().y);
+    int level = static_cast<int>(std::floor(std::log2(zoom)));
+    sf::Rect<double> area(origin.x + view.getCenter().x - view.getSize().x / 2.0, origin.y + view.getCenter().y - view.getSize().y / 2.0,
+                          view.getSize().x, view.getSize().y);
+    arcs.clear();
+
+    for (auto& group : groups) {
+        sf::Vector2<double> parentPosition(0.0, 0.0);
+        if (group.parent >= 0) {
+            parentPosition = bodies.interpolatedPosition(group.parent, alpha);
+        }
+        if (group.reach * zoom < minScreenRadius || parentPosition.x + group.reach < area.left || parentPosition.x - group.reach > area.left + area.width ||
+            parentPosition.y + group.reach < area.top || parentPosition.y - group.reach > area.top + area.height) {
+            continue;
+        }
+        if (!group.built || group.level != level) {
+            build(bodies, group, level);
+        }
+        if (group.vertices.getVertexCount() > 0) {
+            sf::RenderStates states;
+            states.transform.translate(static_cast<float>(parentPosition.x - origin.x), static_cast<float>(parentPosition.y - origin.y));
+            target.draw(group.vertices, states);
+            ++drawCalls;
+            vertexCount += group.vertices.getVertexCount();
+        }
+        for (std::uint32_t i : group.large) {
+            appendArc(bodies, i, alpha, parentPosition, origin, area, zoom);
+        }
+    }
+    if (arcs.getVertexCount() > 0) {
+        target.draw(arcs);
+        ++drawCalls;
+        vertexCount += arcs.getVertexCount();
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * This class draws the orbit of every body as a closed line around its parent, without calculating the lines again every frame.
+ *
+ * The bodies are grouped by parent: the orbits of a group don't move relative to each other, only with the parent.
+ * Each group keeps a vertex array of all its orbits relative to the parent, and it is drawn with one draw call translated to where the parent is,
+ * so a frame costs one test and at most one draw call per group, whatever the number of orbits (all the asteroids of the Sun are one group).
+ *
+ * The array of a group is only built again, when it is drawn, if one of its orbits changed (BodyStore::getOrbitVersion), a body joined or left it,
+ * or the zoom moved to another level of detail. The levels are powers of 2 of the zoom; an ellipse is cut into segments by its curvature on the screen
+ * at the largest zoom of its level, so the line never leaves the true ellipse by more than a quarter of a pixel: more points at the ends of a long ellipse,
+ * few along its flat sides. Orbits smaller than a pixel are left out.
+ *
+ * An orbit much bigger than the screen would need too many points; only the arc that crosses the view is drawn for it, calculated every frame in double
+ * around the origin of the camera, so the line stays on the body at any zoom.
+ *
+ */
+
+#ifndef ORBITPATHS_HPP
+#define ORBITPATHS_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BodyStore.hpp"
+
+class OrbitPaths {
+public:
+    // Function to draw the orbits on the target with the origin of the camera, the parents at alpha between their previous and current positions (see BodyRenderer)
+    void render(const BodyStore& bodies, sf::RenderTarget& target, float alpha, sf::Vector2<double> origin);
+
+    std::size_t getBuildCount() const { return builds; } // Number of times a group was built
+    std::size_t getDrawCallCount() const { return drawCalls; } // Number of draw calls of the last render
+    std::size_t getVertexCount() const { return vertexCount; } // Number of vertices of the last render
+
+private:
+    // Bodies with the same parent
+    struct Group {
+        int parent = -1; // -1 for the bodies orbiting the world origin
+        std::vector<std::uint32_t> members; // Bodies of the group, in the order of the store
+        std::vector<std::uint32_t> versions; // Orbit version of every member when the array was built
+        std::vector<std::uint32_t> large; // Members drawn as an arc every frame
+        sf::VertexArray vertices{sf::LineStrip}; // Orbits relative to the parent, joined by transparent segments
+        double reach = 0.0; // Largest distance of an orbit from the parent, to skip the groups outside the view
+        int level = 0; // Level of detail of the array
+        bool built = false;
+    };
+
+    void regroup(const BodyStore& bodies); // Function to sort the bodies into groups again after bodies were added or removed, or parents changed
+    void build(const BodyStore& bodies, Group& group, int level); // Function to calculate the orbits of a group at a level of detail
+    void appendArc(const BodyStore& bodies, std::size_t index, float alpha, sf::Vector2<double> parentPosition, sf::Vector2<double> origin,
+                   const sf::Rect<double>& area, double zoom); // Function to add the visible part of a large orbit to the arcs of this frame
+
+    std::vector<Group> groups;
+    std::vector<int> groupOf; // Group of the children of every body, groupOf[parent + 1], -1 if it has none
+    std::size_t groupedSize = 0; // Size and versions of the store when the groups were made
+    std::size_t groupedHierarchy = 0;
+    std::size_t checkedOrbits = 0; // Orbit version of the store when the groups were last compared with it
+    bool grouped = false;
+    sf::VertexArray arcs{sf::LineStrip}; // Arcs of the large orbits in this frame, in coordinates relative to the origin
+    std::size_t builds = 0;
+    std::size_t drawCalls = 0;
+    std::size_t vertexCount = 0;
+};
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * Purpose: Implement the methods of the OrbitTrails class that are declared in the OrbitTrails.hpp header file.
+ *  A ring is read from its newest point to its oldest one, so when a trail is cut to its share of the vertices, the old end is dropped.
+ *  The newest point is joined to the drawn position of the body, so the line doesn't stop short of the body between two recorded points.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "OrbitTrails.hpp"
+#include "Log.hpp"
+
+// Size of a point in memory: x and y in double
+static const std::size_t bytesPerPoint = 2 * sizeof(double);
+// Limits of the capacity of a ring, whatever the budget: a trail of less than 16 points isn't a path, one of more than 4096 is longer than the screen
+static const std::size_t minCapacity = 16;
+static const std::size_t maxCapacity = 4096;
+// Distance on the screen a body moves before the next point is recorded, in pixels
+static const double pixelsPerPoint = 3.0;
+// Opacity of the newest end of a trail, the oldest end fades out to 0
+static const float trailOpacity = 160.0f;
+
+OrbitTrails::OrbitTrails(std::size_t memoryBudget, std::size_t vertexBudget) : memoryBudget(memoryBudget), vertexBudget(vertexBudget) {
+}
+
+/**
+ * This function builds new rings when bodies were added, removed or had their trail shown or hidden.
+ * A body that already had a ring keeps its newest points, as many as the new capacity allows, so changing the set doesn't erase the paths on the screen.
+ *
+ * */
+void OrbitTrails::layout(const BodyStore& bodies) {
+    laidOut = true;
+    laidOutSize = bodies.size();
+    laidOutHierarchy = bodies.getHierarchyVersion();
+    laidOutTrails = bodies.getTrailVersion();
+    laidOutAll = showAll;
+
+    // The budget holds at most this many rings of the smallest capacity. The bodies given a trail with setTrail come first,
+    // then the others when all trails are shown, in the order of their slots
+    std::size_t maxTrails = memoryBudget / (bytesPerPoint * minCapacity);
+    std::vector<std::uint32_t> newBodyOf;
+    std::size_t wanted = 0;
+    for (int pass = 0; pass < (showAll ? 2 : 1); ++pass) {
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            if (!hasTrail(bodies, i) || (bodies.trail[i] != 0) != (pass == 0)) {
+                continue;
+            }
+            ++wanted;
+            if (newBodyOf.size() < maxTrails) {
+                newBodyOf.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+    }
+    std::sort(newBodyOf.begin(), newBodyOf.end());
+    if (wanted - newBodyOf.size() != dropped) {
+        dropped = wanted - newBodyOf.size();
+        if (dropped > 0) {
+            std::cerr << "Orbit trails: the memory budget of " << (memoryBudget >> 10) << " KB holds " << maxTrails << " trails, "
+                      << dropped << " bodies are drawn without one (see --trail-memory)" << std::endl;
+        }
+    }
+    std::size_t newCapacity = memoryBudget / (bytesPerPoint * std::max<std::size_t>(newBodyOf.size(), 1));
+    newCapacity = std::min(newCapacity, maxCapacity); // At least minCapacity, since there are at most maxTrails rings
+    if (newBodyOf == bodyOf && newCapacity == capacity) {
+        bool same = true; // Same bodies in the same slots: check that none of them was replaced
+        for (std::size_t r = 0; r < bodyOf.size() && same; ++r) {
+            same = generationOf[r] == bodies.handleOf(bodyOf[r]).generation;
+        }
+        if (same) {
+            return;
+        }
+    }
+
+    std::size_t rings = newBodyOf.size();
+    std::vector<double> newX(rings * newCapacity), newY(rings * newCapacity);
+    std::vector<std::uint32_t> newStart(rings, 0), newLength(rings, 0), newGeneration(rings);
+    for (std::size_t r = 0; r < rings; ++r) {
+        std::uint32_t body = newBodyOf[r];
+        newGeneration[r] = bodies.handleOf(body).generation;
+        int old = body < ringOf.size() ? ringOf[body] : -1;
+        if (old < 0 || generationOf[old] != newGeneration[r]) {
+            continue; // A new trail starts empty
+        }
+        // Copy the newest points, oldest first, to the start of the new ring
+        std::size_t keep = std::min<std::size_t>(length[old], newCapacity);
+        std::size_t skip = length[old] - keep;
+        for (std::size_t k = 0; k < keep; ++k) {
+            std::size_t from = static_cast<std::size_t>(old) * capacity + (start[old] + skip + k) % capacity;
+            newX[r * newCapacity + k] = pointX[from];
+            newY[r * newCapacity + k] = pointY[from];
+        }
+        newLength[r] = static_cast<std::uint32_t>(keep);
+    }
+
+    pointX.swap(newX);
+    pointY.swap(newY);
+    start.swap(newStart);
+    length.swap(newLength);
+    bodyOf.swap(newBodyOf);
+    generationOf.swap(newGeneration);
+    capacity = newCapacity;
+    ringOf.assign(bodies.size(), -1);
+    for (std::size_t r = 0; r < rings; ++r) {
+        ringOf[bodyOf[r]] = static_cast<int>(r);
+    }
+    LOG_DEBUG("Orbit trails: %zu rings of %zu points, %zu bytes", rings, capacity, rings * capacity * bytesPerPoint);
+}
+
+/**
+ * This function appends the position of every body with a trail to its ring, if it is far enough from the last point.
+ * When the ring is full, the oldest point is overwritten. Nothing is allocated unless the set of trails changed.
+ *
+ * */
+void OrbitTrails::record(const BodyStore& bodies, double zoom) {
+    if (!laidOut || bodies.size() != laidOutSize || bodies.getHierarchyVersion() != laidOutHierarchy ||
+        bodies.getTrailVersion() != laidOutTrails || showAll != laidOutAll) {
+        layout(bodies);
+    }
+    double spacing = pixelsPerPoint / zoom;
+    double spacing2 = spacing * spacing;
+    for (std::size_t r = 0; r < bodyOf.size(); ++r) {
+        std::size_t body = bodyOf[r];
+        double x = bodies.positionX[body];
+        double y = bodies.positionY[body];
+        double* ringX = &pointX[r * capacity];
+        double* ringY = &pointY[r * capacity];
+        if (length[r] > 0) {
+            std::size_t newest = (start[r] + length[r] - 1) % capacity;
+            double dx = x - ringX[newest];
+            double dy = y - ringY[newest];
+            if (dx * dx + dy * dy < spacing2) {
+                continue; // Not moved enough to show on the screen
+            }
+        }
+        if (length[r] < capacity) {
+            std::size_t slot = (start[r] + length[r]) % capacity;
+            ringX[slot] = x;
+            ringY[slot] = y;
+            ++length[r];
+        } else {
+            ringX[start[r]] = x; // Full: the newest point replaces the oldest one
+            ringY[start[r]] = y;
+            start[r] = static_cast<std::uint32_t>((start[r] + 1) % capacity);
+        }
+    }
+}
+
+void OrbitTrails::clear() {
+    std::fill(length.begin(), length.end(), 0);
+}
+
+/**
+ * This function turns the rings into line segments, newest point first. A point less than a pixel from the last point kept is skipped,
+ * a segment that is completely on one side outside the view is skipped, and a trail stops at its share of the vertex budget.
+ *
+ * */
+void OrbitTrails::render(const BodyStore& bodies, sf::RenderTarget& target, float alpha, sf::Vector2<double> origin) {
+    used = 0;
+    if (bodyOf.empty() || bodies.size() != laidOutSize) {
+        return; // Nothing recorded yet for the bodies of the store
+    }
+    const sf::View& view = target.getView();
+    sf::IntRect viewport = target.getViewport(view);
+    double pixelsPerUnit = std::max(viewport.width / view.getSize().x, viewport.height / view.getSize().y);
+    double minDistance2 = 1.0 / (pixelsPerUnit * pixelsPerUnit);
+    // Edges of the view relative to the origin, like the vertices
+    double left = view.getCenter().x - view.getSize().x / 2.0, right = view.getCenter().x + view.getSize().x / 2.0;
+    double top = view.getCenter().y - view.getSize().y / 2.0, bottom = view.getCenter().y + view.getSize().y / 2.0;
+    std::size_t maxSegments = std::max<std::size_t>(vertexBudget / 2 / bodyOf.size(), 1);
+
+    for (std::size_t r = 0; r < bodyOf.size(); ++r) {
+        std::size_t body = bodyOf[r];
+        if (length[r] == 0 || !bodies.isAlive(body)) {
+            continue;
+        }
+        std::size_t needed = used + 2 * std::min<std::size_t>(length[r], maxSegments);
+        if (vertices.getVertexCount() < needed) {
+            vertices.resize(needed * 2); // Grow with room to spare, so the array is rarely resized
+        }
+        sf::Color color = bodies.color[body];
+        sf::Vector2<double> drawn = bodies.interpolatedPosition(body, alpha);
+        double lastX = drawn.x - origin.x;
+        double lastY = drawn.y - origin.y;
+        float lastOpacity = trailOpacity;
+        std::size_t segments = 0;
+        const double* ringX = &pointX[r * capacity];
+        const double* ringY = &pointY[r * capacity];
+        for (std::size_t k = length[r]; k-- > 0 && segments < maxSegments;) {
+            std::size_t slot = (start[r] + k) % capacity;
+            double x = ringX[slot] - origin.x;
+            double y = ringY[slot] - origin.y;
+            double dx = x - lastX;
+            double dy = y - lastY;
+            if (k > 0 && dx * dx + dy * dy < minDistance2) {
+                continue; // Less than a pixel: the next point is drawn instead
+            }
+            float opacity = trailOpacity * k / length[r]; // Fades out towards the oldest point
+            bool outside = (x < left && lastX < left) || (x > right && lastX > right) || (y < top && lastY < top) || (y > bottom && lastY > bottom);
+            if (!outside) {
+                color.a = static_cast<sf::Uint8>(lastOpacity);
+                vertices[used++] = sf::Vertex(sf::Vector2f(static_cast<float>(lastX), static_cast<float>(lastY)), color);
+                color.a = static_cast<sf::Uint8>(opacity);
+                vertices[used++] = sf::Vertex(sf::Vector2f(static_cast<float>(x), static_cast<float>(y)), color);
+                ++segments;
+            }
+            lastX = x;
+            lastY = y;
+            lastOpacity = opacity;
+        }
+    }
+    if (used > 0) {
+        target.draw(&vertices[0], used, sf::Lines);
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * This class records the recent path of some bodies and draws it behind them as a fading line.
+ *
+ * The points are kept in ring buffers of a fixed capacity, one part of a single pair of arrays per body (structure of arrays: all x, then all y),
+ * allocated when the set of bodies with a trail changes and never during a normal frame. The capacity of a ring is the memory budget
+ * divided by the number of trails, so 10000 trails take the same memory as 10 (with shorter rings). The budget is never exceeded:
+ * when it can't give every trail a ring of the smallest capacity, only that many bodies get a trail and a warning tells how many were left out.
+ *
+ * A point is only recorded when the body has moved a few pixels on the screen since the last one, so the spacing of the points follows the zoom:
+ * zoomed out, the same ring covers a longer path. When the trails are drawn, points closer than a pixel to the previous one are skipped,
+ * and every trail is cut to its share of a vertex budget; all trails go into one sf::VertexArray of lines and one draw call.
+ *
+ */
+
+#ifndef ORBITTRAILS_HPP
+#define ORBITTRAILS_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BodyStore.hpp"
+
+class OrbitTrails {
+public:
+    // Constructor with the memory of the points in bytes and the largest number of vertices drawn per frame
+    explicit OrbitTrails(std::size_t memoryBudget = 16 << 20, std::size_t vertexBudget = 1 << 20);
+
+    void setShowAll(bool all) { showAll = all; } // Function to draw the trails of every body, not only the ones set with BodyStore::setTrail
+    bool isShowingAll() const { return showAll; }
+    void record(const BodyStore& bodies, double zoom); // Function to add the current positions to the trails, called once per frame after the update. zoom is in pixels per world unit
+    void clear(); // Function to forget every path, after a jump in time
+    // Function to draw the trails on the target, up to the position of each body at alpha (see BodyRenderer::render), with the same origin as the bodies
+    void render(const BodyStore& bodies, sf::RenderTarget& target, float alpha, sf::Vector2<double> origin);
+
+    std::size_t getTrailCount() const { return bodyOf.size(); } // Number of bodies with a trail
+    std::size_t getDroppedCount() const { return dropped; } // Number of bodies that should have a trail but don't fit in the memory budget
+    std::size_t getCapacity() const { return capacity; } // Number of points of every ring
+    std::size_t getVertexCount() const { return used; } // Number of vertices of the last render
+
+private:
+    void layout(const BodyStore& bodies); // Function to give a ring to every body with a trail, keeping the newest points of the rings that already exist
+    bool hasTrail(const BodyStore& bodies, std::size_t index) const { return bodies.isAlive(index) && (showAll || bodies.trail[index]); }
+
+    std::size_t memoryBudget;
+    std::size_t vertexBudget;
+    bool showAll = false;
+    std::size_t laidOutSize = 0; // Size, hierarchy version and trail version of the store at the last layout
+    std::size_t laidOutHierarchy = 0;
+    std::size_t laidOutTrails = 0;
+    bool laidOutAll = false;
+    bool laidOut = false;
+    std::size_t dropped = 0; // Bodies left without a trail by the last layout
+
+    std::size_t capacity = 0;
+    std::vector<double> pointX; // Ring r holds the points pointX[r * capacity] to pointX[r * capacity + capacity - 1]
+    std::vector<double> pointY;
+    std::vector<std::uint32_t> start; // Oldest point of every ring
+    std::vector<std::uint32_t> length; // Number of points of every ring, up to capacity
+    std::vector<std::uint32_t> bodyOf; // Body of every ring
+    std::vector<std::uint32_t> generationOf; // Generation of that body, a new body in the same slot starts an empty ring
+    std::vector<int> ringOf; // Ring of every body, -1 for a body without a trail
+    sf::VertexArray vertices{sf::Lines}; // Kept between frames, only grows
+    std::size_t used = 0;
+};
+
+#endif
@@ -11,6 +11,8 @@
 
 #include <SFML/Graphics.hpp> // Include the SFML graphics library(Simple and Fast Multimedia Library) for graphics rendering
 #include <string>
+#include <vector>
+#include "BodyStore.hpp" // The state of the planet is stored in a BodyStore, the Planet class is only a handle into it
 
 /**
  * In SFML library, a sf::Vector2f object represents a 2D vector,
@@ -18,52 +20,53 @@
  * a size, or a velocity, depending on the context.
  * It contains two floating-point numbers, representing
  * the x and y coordinates (or components) of the vector.
+ *
+ * A Planet object is a lightweight handle: it only holds a pointer to the BodyStore, the index of the body in it and the generation of that slot.
+ * Copying a Planet copies the handle, not the state of the planet. If the body is removed from the store, isValid() returns false.
  */
 
 class Planet {
 public:
-    // Constructor to initialize the planet's properties
-    Planet(std::string, float radius, float distance, float orbitSpeed, float rotationSpeed, sf::Color color, sf::Vector2f position); // sf:: is a namespace that contains all the classes and functions provided by SFML library
+    // Constructor to create a handle to the body at the specified index of the store
+    Planet(BodyStore& store, std::size_t index);
 
     // deltaTime represents the time elapsed between two frames. In other words, it's the time it took to complete the last frame. This is used to make movement and other time-based actions smooth and consistent, regardless of the frame rate.
     void update(float deltaTime); // Function to update the planet's position based on time
-    void draw(sf::RenderWindow& window); // Function to draw the planet on the window(sf::RenderWindow is a class that represents the window where graphics are rendered by SFML)
+    void draw(sf::RenderWindow& window); // Function to draw the planet on the window(sf::RenderWindow is a class that represents the window where graphics are rendered by SFML). BodyRenderer draws all planets at once
 
-    // Getters
-    float getDistance() const { return distance; } // Function to get the distance of the planet from the center of the orbit
-    std::string getName() const { return name; } // Function to get the name of the planet
+    // Getters. A removed planet has no distance, name or position: they return 0, an empty name and the world origin
+    float getDistance() const { return isValid() ? store->distance[index] : 0.0f; } // Function to get the distance of the planet from the center of the orbit
+    std::string getName() const { return isValid() ? store->name[index] : std::string(); } // Function to get the name of the planet
+    sf::Vector2<double> getPosition() const { // Function to get the position of the planet in world coordinates
+        return isValid() ? sf::Vector2<double>(store->positionX[index], store->positionY[index]) : sf::Vector2<double>();
+    }
+    std::size_t getIndex() const { return index; } // Function to get the index of the planet in the store
+    BodyHandle getHandle() const { return BodyHandle{static_cast<std::uint32_t>(index), generation}; } // Function to get a stable handle to the planet
+    bool isValid() const { return store->resolve(getHandle()) >= 0; } // False once the planet was removed from the store
 
-    //Setters
-    void setRotationSpeed(float speed); // Renamed setRotation to setRotationSpeed to avoid confusion with the setRotation function that sets the rotation angle
-    void setOrbitSpeed(float speed);
+    //Setters. They do nothing once the planet was removed, so an old handle can't change the body that took its slot
+    void setRotationSpeed(float speed, double time); // Renamed setRotation to setRotationSpeed to avoid confusion with the setRotation function that sets the rotation angle. The planet doesn't turn at once, see BodyStore::setRotationSpeed
+    void setOrbitSpeed(float speed, double time); // Function to change the orbit speed at the simulated time now, without moving the planet, see BodyStore::setOrbitSpeed
     void setDistance(float distance);
+    void setOrbitElements(float eccentricity, float inclination, float periapsisArgument, double meanAnomaly); // Function to set the shape of the orbit, see BodyStore::setOrbitElements
     void setRadius(float radius);
+    void setMass(float mass); // Function to set the mass that attracts the other bodies in the N-body mode
+    void setTrail(bool shown); // Function to draw the recent path of the planet behind it, see OrbitTrails
     void setColor(sf::Color color);
-    void setPosition(sf::Vector2f position);
+    void setPosition(sf::Vector2<double> position);
     /*
      * The const keyword in const std::string& texturePath is used to indicate that the function setTexture will not modify the texturePath argument.
      * This is a promise to the compiler that the function will not change the value of texturePath
      * */
     void setTexture(const std::string& texturePath);  // Use const std::string& texturePath to pass the texture path as a constant reference to avoid copying the string
-    void setOrigin(sf::Vector2f origin);
     void setRotation(float angle);
 
-    void setOrbitingPlanet(const std::string& orbitingPlanetName, std::vector<Planet>& planets); // Function to set the name of the planet that this planet is orbiting around
+    void setOrbitingPlanet(const std::string& orbitingPlanetName); // Function to set the name of the planet that this planet is orbiting around
 
     private:
-        std::string name;
-        float radius;
-        float distance;
-        float orbitSpeed; // Speed of orbiting around another planet or point
-        float rotationSpeed; // Speed of rotation around its own axis
-        sf::Color color;
-        sf::Vector2f position;
-        sf::CircleShape shape; // Circle shape to represent the planet visually
-        float currentAngle; // Current angle for the orbit
-        float currentRotation; // Current rotation angle for the orbit
-        Planet* orbitingPlanet; // Pointer to another planet that this planet is orbiting around
-        sf::Texture texture; // Texture for the planet's appearance
-
+        BodyStore* store; // Pointer to the store that holds the state of the planet
+        std::size_t index; // Index of the planet in the store
+        std::uint32_t generation; // Generation of the slot when the handle was made, see BodyHandle
 
 };
 #endif // End a conditional directive block started by #if, #ifdef, or #ifndef. It tells the preprocessor that the conditional code block has ended.
\ No newline at end of file
@@ -0,0 +1,173 @@
+/**
+ * Purpose: Implement the methods of the Profiler class that are declared in the Profiler.hpp header file.
+ *  The bins are logarithmic: bin b (b >= 1) holds the durations between 2^((b-1)/8) and 2^(b/8) microseconds.
+ *
+ * */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "Profiler.hpp"
+
+Profiler::Profiler(std::size_t windowFrames) : windowFrames(windowFrames == 0 ? 1 : windowFrames) {
+}
+
+const char* Profiler::phaseName(ProfilePhase phase) {
+    switch (phase) {
+        case ProfilePhase::DbLoad: return "db_load";
+        case ProfilePhase::Events: return "events";
+        case ProfilePhase::Update: return "update";
+        case ProfilePhase::Barrier: return "barrier";
+        case ProfilePhase::Draw: return "draw";
+        case ProfilePhase::Display: return "display";
+        case ProfilePhase::Frame: return "frame";
+        default: return "unknown";
+    }
+}
+
+std::size_t Profiler::binOf(float seconds) {
+    float microseconds = seconds * 1e6f;
+    if (!(microseconds >= 1.0f)) {
+        return 0; // Below 1 microsecond (or not a number)
+    }
+    std::size_t bin = 1 + static_cast<std::size_t>(std::log2(microseconds) * binsPerOctave);
+    return bin < binCount ? bin : binCount - 1;
+}
+
+float Profiler::binMilliseconds(std::size_t bin) {
+    if (bin == 0) {
+        return 0.0005f;
+    }
+    return std::exp2((bin - 1 + 0.5f) / binsPerOctave) / 1000.0f; // Geometric middle of the bin
+}
+
+void Profiler::addSample(ProfilePhase phase, float seconds) {
+    std::size_t p = static_cast<std::size_t>(phase);
+    ++current[p][binOf(seconds)];
+    currentSum[p] += seconds;
+    last[p] = seconds;
+}
+
+void Profiler::endFrame() {
+    if (++framesInWindow < windowFrames) {
+        return;
+    }
+    // The DB load is measured once at startup, so its samples are kept instead of rolled out
+    const std::size_t once = static_cast<std::size_t>(ProfilePhase::DbLoad);
+    for (std::size_t b = 0; b < binCount; ++b) {
+        current[once][b] += previous[once][b];
+    }
+    currentSum[once] += previousSum[once];
+
+    // The current window becomes the previous one, and a new window starts
+    std::memcpy(previous, current, sizeof(current));
+    std::memcpy(previousSum, currentSum, sizeof(currentSum));
+    std::memset(current, 0, sizeof(current));
+    std::memset(currentSum, 0, sizeof(currentSum));
+    framesInWindow = 0;
+}
+
+PhaseStats Profiler::getStats(ProfilePhase phase) const {
+    std::size_t p = static_cast<std::size_t>(phase);
+    PhaseStats stats;
+    stats.last = last[p] * 1000.0f;
+    for (std::size_t b = 0; b < binCount; ++b) {
+        stats.samples += current[p][b] + previous[p][b];
+    }
+    if (stats.samples == 0) {
+        return stats;
+    }
+    stats.mean = static_cast<float>((currentSum[p] + previousSum[p]) * 1000.0 / stats.samples);
+
+    // Walk the bins until the number of samples reaches the rank of each percentile
+    const double ranks[3] = {0.50 * stats.samples, 0.95 * stats.samples, 0.99 * stats.samples};
+    float* results[3] = {&stats.p50, &stats.p95, &stats.p99};
+    std::size_t next = 0;
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < binCount && next < 3; ++b) {
+        seen += current[p][b] + previous[p][b];
+        while (next < 3 && seen >= ranks[next]) {
+            *results[next++] = binMilliseconds(b);
+        }
+    }
+    return stats;
+}
+
+/**
+ * This function draws a panel with one line per phase. The bar shows p50 and the thin mark shows p99,
+ * on a scale where the full width is one frame at 60 frames per second (16.7 ms).
+ * The text is only drawn when a font was loaded, because SFML has no built-in font.
+ *
+ * */
+void Profiler::drawOverlay(sf::RenderTarget& target, const sf::Font* font) const {
+    const float lineHeight = 18.0f;
+    const float barWidth = 200.0f;
+    const float textWidth = font ? 330.0f : 0.0f;
+    const float budget = 1000.0f / 60.0f;
+
+    sf::View previousView = target.getView();
+    target.setView(target.getDefaultView()); // The overlay is drawn in screen pixels, whatever the camera
+
+    sf::RectangleShape background(sf::Vector2f(textWidth + barWidth + 20.0f, lineHeight * (phaseCount - 1) + 10.0f));
+    background.setPosition(5.0f, 5.0f);
+    background.setFillColor(sf::Color(0, 0, 0, 170));
+    target.draw(background);
+
+    float y = 10.0f;
+    for (std::size_t p = 0; p < phaseCount; ++p) {
+        ProfilePhase phase = static_cast<ProfilePhase>(p);
+        if (phase == ProfilePhase::DbLoad) {
+            continue; // Measured once at startup, not per frame
+        }
+        PhaseStats stats = getStats(phase);
+        if (font) {
+            char line[128];
+            std::snprintf(line, sizeof(line), "%-8s p50 %6.2f  p95 %6.2f  p99 %6.2f ms", phaseName(phase), stats.p50, stats.p95, stats.p99);
+            sf::Text text(line, *font, 13);
+            text.setPosition(10.0f, y);
+            text.setFillColor(sf::Color::White);
+            target.draw(text);
+        }
+        sf::RectangleShape bar(sf::Vector2f(std::fmin(stats.p50 / budget, 1.0f) * barWidth, lineHeight - 6.0f));
+        bar.setPosition(15.0f + textWidth, y + 3.0f);
+        bar.setFillColor(stats.p99 > budget ? sf::Color(220, 60, 60) : sf::Color(80, 200, 120));
+        target.draw(bar);
+        sf::RectangleShape mark(sf::Vector2f(2.0f, lineHeight - 4.0f));
+        mark.setPosition(15.0f + textWidth + std::fmin(stats.p99 / budget, 1.0f) * barWidth, y + 2.0f);
+        mark.setFillColor(sf::Color::White);
+        target.draw(mark);
+        y += lineHeight;
+    }
+
+    target.setView(previousView);
+}
+
+bool Profiler::exportStats(const std::string& filePath) const {
+    std::ofstream file(filePath);
+    if (!file) {
+        return false;
+    }
+    bool json = filePath.size() >= 5 && filePath.compare(filePath.size() - 5, 5, ".json") == 0;
+
+    if (json) {
+        file << "{\n";
+    } else {
+        file << "phase,samples,mean_ms,p50_ms,p95_ms,p99_ms\n";
+    }
+    for (std::size_t p = 0; p < phaseCount; ++p) {
+        ProfilePhase phase = static_cast<ProfilePhase>(p);
+        PhaseStats stats = getStats(phase);
+        if (json) {
+            file << "  \"" << phaseName(phase) << "\": {\"samples\": " << stats.samples << ", \"mean_ms\": " << stats.mean
+                 << ", \"p50_ms\": " << stats.p50 << ", \"p95_ms\": " << stats.p95 << ", \"p99_ms\": " << stats.p99 << "}"
+                 << (p + 1 < phaseCount ? ",\n" : "\n");
+        } else {
+            file << phaseName(phase) << "," << stats.samples << "," << stats.mean << "," << stats.p50 << "," << stats.p95 << "," << stats.p99 << "\n";
+        }
+    }
+    if (json) {
+        file << "}\n";
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,76 @@
+/**
+ * This file declares the frame-time profiler. The main loop measures every phase of a frame (event polling, update, draw, display)
+ * with a ScopedTimer, and the profiler keeps the durations in a fixed-size histogram per phase, so recording a sample never allocates memory.
+ * The percentiles (p50, p95, p99) are calculated over a rolling window: the histogram of the current window plus the one of the previous window.
+ * The statistics can be shown on the screen (overlay) and exported to a CSV or JSON file.
+ *
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Phases of a frame that are measured. DbLoad is measured once, when the catalog is loaded at startup.
+enum class ProfilePhase { DbLoad, Events, Update, Barrier, Draw, Display, Frame, Count };
+
+// Statistics of one phase, in milliseconds
+struct PhaseStats {
+    float p50 = 0.0f;
+    float p95 = 0.0f;
+    float p99 = 0.0f;
+    float mean = 0.0f;
+    float last = 0.0f; // Duration of the last sample
+    std::uint64_t samples = 0; // Number of samples in the rolling window
+};
+
+class Profiler {
+public:
+    explicit Profiler(std::size_t windowFrames = 600); // Constructor with the number of frames of a window (10 seconds at 60 frames per second)
+
+    void addSample(ProfilePhase phase, float seconds); // Function to record the duration of a phase
+    void endFrame(); // Function to call once per frame, it starts a new window when the current one is full
+    PhaseStats getStats(ProfilePhase phase) const; // Function to calculate the statistics of a phase over the rolling window
+
+    void drawOverlay(sf::RenderTarget& target, const sf::Font* font) const; // Function to draw the statistics in the top left corner, with bars only if there is no font
+    bool exportStats(const std::string& filePath) const; // Function to write the statistics to a .json file, or to a CSV file for any other extension
+
+    static const char* phaseName(ProfilePhase phase);
+
+private:
+    static const std::size_t binsPerOctave = 8; // Every doubling of the duration is split into 8 bins, so a percentile is accurate to about 4%
+    static const std::size_t binCount = 1 + binsPerOctave * 24; // Bin 0 is below 1 microsecond, the last bin is above 16 seconds
+    static const std::size_t phaseCount = static_cast<std::size_t>(ProfilePhase::Count);
+
+    static std::size_t binOf(float seconds); // Function to find the bin of a duration
+    static float binMilliseconds(std::size_t bin); // Function to get the duration in the middle of a bin
+
+    std::uint32_t current[phaseCount][binCount] = {}; // Histograms of the current window
+    std::uint32_t previous[phaseCount][binCount] = {}; // Histograms of the previous window
+    double currentSum[phaseCount] = {}; // Sum of the durations of the current window, for the mean
+    double previousSum[phaseCount] = {};
+    float last[phaseCount] = {};
+    std::size_t windowFrames;
+    std::size_t framesInWindow = 0;
+};
+
+// Measures the time between its creation and its destruction and records it in the profiler
+class ScopedTimer {
+public:
+    ScopedTimer(Profiler& profiler, ProfilePhase phase) : profiler(profiler), phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { profiler.addSample(phase, std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count()); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Profiler& profiler;
+    ProfilePhase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
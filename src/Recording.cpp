@@ -0,0 +1,576 @@
+/**
+ * Purpose: Implement the recording and the replay declared in Recording.hpp.
+ *  The integers are written as variable-length integers (7 bits per byte, the high bit set on every byte but the last), after a zigzag
+ *  that puts the small negative numbers next to the small positive ones (0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...).
+ *  The predictions are calculated on unsigned integers, which wrap around the same way in the recorder and in the replay,
+ *  so a frame is decoded to exactly the quantized state that was recorded, whatever the size of the differences.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "Recording.hpp"
+#include "ByteOrder.hpp"
+#include "Log.hpp"
+
+static const char recordingMagic[8] = {'S', 'O', 'L', 'A', 'R', 'R', 'E', 'C'};
+// Size of the header, of the tag and size of a block, of one body of a catalog and of one entry of the keyframe index, in bytes
+static const std::size_t recordingHeaderSize = 64;
+static const std::size_t blockHeaderSize = 5;
+static const std::size_t catalogBodySize = 48;
+static const std::size_t indexEntrySize = 32;
+// Size of the time and the number of bodies at the start of a frame
+static const std::size_t frameHeaderSize = 12;
+// Largest quantized coordinate. Larger positions (and NaN) are clamped, so the predictions can't overflow
+static const double maxQuantized = 1e18;
+// Steps of the rotation per turn
+static const double rotationSteps = 65536.0;
+
+// Functions to write a variable-length integer, and to read one without going past the end. The reading returns false on a truncated number
+static void putVarint(std::vector<unsigned char>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+static bool getVarint(const unsigned char*& in, const unsigned char* end, std::uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (in == end) {
+            return false;
+        }
+        unsigned char byte = *in++;
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Functions to map a signed difference (as the bits of a two's complement number) to an unsigned number and back
+static std::uint64_t zigzag(std::uint64_t value) {
+    return (value << 1) ^ (0 - (value >> 63));
+}
+
+static std::uint64_t unzigzag(std::uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+// Functions to append numbers to a block
+static void appendU32(std::vector<unsigned char>& out, std::uint32_t value) {
+    out.resize(out.size() + 4);
+    putU32(out.data() + out.size() - 4, value);
+}
+
+static void appendDouble(std::vector<unsigned char>& out, double value) {
+    out.resize(out.size() + 8);
+    putDouble(out.data() + out.size() - 8, value);
+}
+
+// Function to quantize a coordinate to a whole number of steps
+static std::uint64_t quantize(double value, double step) {
+    double steps = std::round(value / step);
+    if (!(steps > -maxQuantized)) {
+        steps = std::isnan(steps) ? 0.0 : -maxQuantized;
+    } else if (steps > maxQuantized) {
+        steps = maxQuantized;
+    }
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(steps));
+}
+
+// Function to quantize a rotation in degrees to 1/65536 of a turn
+static std::uint16_t quantizeRotation(float degrees) {
+    double turns = degrees / 360.0;
+    turns -= std::floor(turns);
+    if (!std::isfinite(turns)) {
+        return 0;
+    }
+    return static_cast<std::uint16_t>(static_cast<std::uint32_t>(std::lround(turns * rotationSteps)));
+}
+
+// Function to calculate the prediction of a coordinate from the two frames before it, or from the last one right after a keyframe
+static std::uint64_t predict(const std::vector<std::uint64_t>& last, const std::vector<std::uint64_t>& older, std::size_t i, bool linear) {
+    return linear ? 2 * last[i] - older[i] : last[i];
+}
+
+static std::uint16_t predictRotation(const std::vector<std::uint16_t>& last, const std::vector<std::uint16_t>& older, std::size_t i, bool linear) {
+    return static_cast<std::uint16_t>(linear ? 2 * last[i] - older[i] : last[i]);
+}
+
+// Function to fill the header of a recording
+static void putHeader(unsigned char* out, std::size_t keyframeInterval, double step, std::uint64_t frames, std::uint64_t keyframes,
+                      std::uint64_t indexOffset, double firstTime, double lastTime) {
+    std::memset(out, 0, recordingHeaderSize);
+    std::memcpy(out, recordingMagic, sizeof(recordingMagic));
+    putU32(out + 8, recordingVersion);
+    putU32(out + 12, static_cast<std::uint32_t>(keyframeInterval));
+    putDouble(out + 16, step);
+    putU64(out + 24, frames);
+    putU64(out + 32, keyframes);
+    putU64(out + 40, indexOffset);
+    putDouble(out + 48, firstTime);
+    putDouble(out + 56, lastTime);
+}
+
+Recorder::~Recorder() {
+    if (out.is_open()) {
+        out.close();
+        std::remove(temporaryPath.c_str()); // finish() wasn't called
+    }
+}
+
+bool Recorder::open(const std::string& path, double step, std::size_t keyframeInterval) {
+    this->path = path;
+    temporaryPath = path + ".tmp";
+    this->step = step;
+    this->keyframeInterval = keyframeInterval == 0 ? 1 : keyframeInterval;
+    out.open(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Can't write " << temporaryPath << std::endl;
+        return false;
+    }
+    unsigned char header[recordingHeaderSize] = {};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header)); // Placeholder, written again by finish()
+    position = recordingHeaderSize;
+    return true;
+}
+
+// Function to write the block in the buffer, after its tag and its size
+void Recorder::writeBlock(unsigned char tag) {
+    unsigned char head[blockHeaderSize];
+    head[0] = tag;
+    putU32(head + 1, static_cast<std::uint32_t>(buffer.size()));
+    out.write(reinterpret_cast<const char*>(head), sizeof(head));
+    out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    position += blockHeaderSize + buffer.size();
+}
+
+/**
+ * Layout of a body of a catalog block, after the number of bodies (u32):
+ *   0 name length (u32)   4 texture path length (u32)   8 parent, as the number of a body of the block (u32), 0xffffffff for no parent
+ *  12 radius (float)   16 color as 0xRRGGBBAA (u32)
+ *  20 distance as in the store (float)   24 eccentricity   28 inclination   32 argument of periapsis (floats)   36 mean anomaly (double)
+ *  44 trail shown (u8)   45 reserved, 0
+ * The names and the texture paths of all bodies follow the bodies, one after the other.
+ *
+ * */
+void Recorder::writeCatalog(const BodyStore& bodies) {
+    slots.clear();
+    std::vector<std::uint32_t> entryOf(bodies.size(), 0xffffffffu);
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        if (bodies.isAlive(i)) {
+            entryOf[i] = static_cast<std::uint32_t>(slots.size());
+            slots.push_back(i);
+        }
+    }
+
+    buffer.assign(4 + slots.size() * catalogBodySize, 0);
+    putU32(buffer.data(), static_cast<std::uint32_t>(slots.size()));
+    for (std::size_t entry = 0; entry < slots.size(); ++entry) {
+        std::size_t i = slots[entry];
+        const std::string& texturePath = bodies.textures.getPath(bodies.texture[i]);
+        unsigned char* body = buffer.data() + 4 + entry * catalogBodySize;
+        putU32(body + 0, static_cast<std::uint32_t>(bodies.name[i].size()));
+        putU32(body + 4, static_cast<std::uint32_t>(texturePath.size()));
+        putU32(body + 8, bodies.parent[i] < 0 ? 0xffffffffu : entryOf[bodies.parent[i]]);
+        putFloat(body + 12, bodies.radius[i]);
+        putU32(body + 16, bodies.color[i].toInteger());
+        putFloat(body + 20, bodies.distance[i]);
+        putFloat(body + 24, bodies.eccentricity[i]);
+        putFloat(body + 28, bodies.inclination[i]);
+        putFloat(body + 32, bodies.periapsisArgument[i]);
+        putDouble(body + 36, bodies.meanAnomaly[i]);
+        body[44] = bodies.trail[i];
+    }
+    for (std::size_t i : slots) {
+        const std::string& texturePath = bodies.textures.getPath(bodies.texture[i]);
+        buffer.insert(buffer.end(), bodies.name[i].begin(), bodies.name[i].end());
+        buffer.insert(buffer.end(), texturePath.begin(), texturePath.end());
+    }
+    catalogPosition = position;
+    writeBlock('C');
+
+    catalogValid = true;
+    catalogSize = bodies.size();
+    catalogHierarchy = bodies.getHierarchyVersion();
+    catalogOrbits = bodies.getOrbitVersion();
+    catalogTrails = bodies.getTrailVersion();
+    LOG_DEBUG("Recorded a catalog of %zu bodies", slots.size());
+}
+
+/**
+ * This function writes one frame. A keyframe holds the quantized coordinates themselves, a delta frame the differences from their predictions.
+ * Both are written to the same variables, so the recorder always knows the state the replay will decode.
+ *
+ * */
+void Recorder::record(const BodyStore& bodies, float alpha, double time) {
+    if (!out.is_open()) {
+        return;
+    }
+    if (frameCount == 0) {
+        firstTime = time;
+        lastTime = time;
+    }
+    time = std::max(time, lastTime); // The index is searched by time, so the times can't go back
+
+    // The bodies are written again when they were added, removed, reparented, or had their orbit or trail changed
+    bool changed = !catalogValid || bodies.size() != catalogSize || bodies.getHierarchyVersion() != catalogHierarchy
+                   || bodies.getOrbitVersion() != catalogOrbits || bodies.getTrailVersion() != catalogTrails;
+    if (changed) {
+        writeCatalog(bodies);
+    }
+    bool keyframe = changed || sinceKeyframe >= keyframeInterval;
+    bool linear = sinceKeyframe >= 2; // A delta frame right after a keyframe only has one frame to predict from
+    std::size_t count = slots.size();
+    if (keyframe) {
+        lastX.assign(count, 0); lastY.assign(count, 0); olderX.assign(count, 0); olderY.assign(count, 0);
+        lastRotation.assign(count, 0); olderRotation.assign(count, 0);
+        std::size_t entry = index.size();
+        index.resize(entry + indexEntrySize);
+        putDouble(index.data() + entry, time);
+        putU64(index.data() + entry + 8, frameCount);
+        putU64(index.data() + entry + 16, position);
+        putU64(index.data() + entry + 24, catalogPosition);
+        sinceKeyframe = 0;
+    }
+
+    buffer.clear();
+    appendDouble(buffer, time);
+    appendU32(buffer, static_cast<std::uint32_t>(count));
+    for (std::size_t entry = 0; entry < count; ++entry) {
+        std::size_t i = slots[entry];
+        sf::Vector2<double> at = bodies.interpolatedPosition(i, alpha);
+        std::uint64_t x = quantize(at.x, step);
+        std::uint64_t y = quantize(at.y, step);
+        std::uint16_t rotation = quantizeRotation(bodies.rotation[i]);
+        if (keyframe) {
+            putVarint(buffer, zigzag(x));
+            putVarint(buffer, zigzag(y));
+            putVarint(buffer, rotation);
+        } else {
+            putVarint(buffer, zigzag(x - predict(lastX, olderX, entry, linear)));
+            putVarint(buffer, zigzag(y - predict(lastY, olderY, entry, linear)));
+            std::int16_t turn = static_cast<std::int16_t>(static_cast<std::uint16_t>(rotation - predictRotation(lastRotation, olderRotation, entry, linear)));
+            putVarint(buffer, zigzag(static_cast<std::uint64_t>(static_cast<std::int64_t>(turn))));
+        }
+        olderX[entry] = lastX[entry]; lastX[entry] = x;
+        olderY[entry] = lastY[entry]; lastY[entry] = y;
+        olderRotation[entry] = lastRotation[entry]; lastRotation[entry] = rotation;
+    }
+    writeBlock(keyframe ? 'K' : 'D');
+    ++sinceKeyframe;
+    ++frameCount;
+    bodyFrames += count;
+    lastTime = time;
+}
+
+bool Recorder::finish() {
+    if (!out.is_open()) {
+        return false;
+    }
+    // Append the keyframe index and fill in the header now that the sizes are known
+    std::uint64_t indexOffset = position;
+    out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+    unsigned char header[recordingHeaderSize];
+    putHeader(header, keyframeInterval, step, frameCount, index.size() / indexEntrySize, indexOffset, firstTime, lastTime);
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::cerr << "Can't write the recording " << temporaryPath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Can't replace the recording " << path << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    std::uint64_t fileSize = indexOffset + index.size();
+    std::cout << "Recording " << path << ": " << frameCount << " frames, " << index.size() / indexEntrySize << " keyframes, "
+              << lastTime - firstTime << " s, " << fileSize / 1024 << " KiB";
+    if (bodyFrames > 0) {
+        std::cout << " (" << static_cast<double>(indexOffset - recordingHeaderSize) / bodyFrames << " bytes per body and frame)";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+bool Replay::open(const std::string& path) {
+    file.close();
+    hasCurrent = false;
+    hasNext = false;
+    loadedCatalog = 0;
+    reported = false;
+    if (!file.open(path)) {
+        std::cerr << "Can't open the recording " << path << std::endl;
+        return false;
+    }
+
+    // Check the header and the index: a recording of another version or a truncated file is refused
+    const unsigned char* data = file.data();
+    std::size_t length = file.size();
+    bool valid = length >= recordingHeaderSize && std::memcmp(data, recordingMagic, sizeof(recordingMagic)) == 0
+                 && getU32(data + 8) == recordingVersion;
+    if (valid) {
+        step = getDouble(data + 16);
+        std::uint64_t frames = getU64(data + 24);
+        std::uint64_t keyframes = getU64(data + 32);
+        std::uint64_t offset = getU64(data + 40);
+        valid = step > 0.0 && std::isfinite(step) && keyframes >= 1 && keyframes <= frames && offset >= recordingHeaderSize
+                && offset <= length && keyframes <= (length - offset) / indexEntrySize && offset + keyframes * indexEntrySize == length;
+        if (valid) {
+            frameCount = static_cast<std::size_t>(frames);
+            keyframeCount = static_cast<std::size_t>(keyframes);
+            indexOffset = static_cast<std::size_t>(offset);
+            startTime = getDouble(data + 48);
+            endTime = getDouble(data + 56);
+        }
+    }
+    // Every keyframe must be after the one before it, in time and in the file, with its catalog before it
+    for (std::size_t k = 0; valid && k < keyframeCount; ++k) {
+        const unsigned char* entry = data + indexOffset + k * indexEntrySize;
+        std::uint64_t at = getU64(entry + 16);
+        std::uint64_t catalog = getU64(entry + 24);
+        const unsigned char* before = entry - indexEntrySize;
+        valid = at >= recordingHeaderSize && at + blockHeaderSize <= indexOffset && catalog >= recordingHeaderSize && catalog < at
+                && data[at] == 'K' && data[catalog] == 'C'
+                && (k == 0 || (getDouble(entry) >= getDouble(before) && at > getU64(before + 16) && catalog >= getU64(before + 24)));
+    }
+    if (!valid || !(keyframeTime(0) == startTime) || !(endTime >= startTime)) {
+        std::cerr << "Ignoring the recording " << path << ": it is damaged or of another version" << std::endl;
+        file.close();
+        return false;
+    }
+    LOG_INFO("Replaying %zu frames (%zu keyframes) from %s", frameCount, keyframeCount, path.c_str());
+    return true;
+}
+
+// Function to read the time of a keyframe from the index
+double Replay::keyframeTime(std::size_t keyframe) const {
+    return getDouble(file.data() + indexOffset + keyframe * indexEntrySize);
+}
+
+// Function to report a damaged frame. It is only printed once, the replay then stays on the last good frame
+void Replay::damaged() {
+    if (!reported) {
+        std::cerr << "The recording is damaged, the replay stops at " << current.time << " s" << std::endl;
+        reported = true;
+    }
+}
+
+/**
+ * This function decodes the frame block at a position into a frame. A delta frame is decoded from the frames before it (last and older),
+ * which must have the same bodies. Every number is checked against the end of the block, so a damaged file can't be read outside its mapping.
+ *
+ * */
+bool Replay::decodeFrame(std::size_t position, std::size_t catalog, const Frame* last, const Frame* older, Frame& frame) {
+    const unsigned char* data = file.data();
+    if (position + blockHeaderSize > indexOffset) {
+        return false;
+    }
+    unsigned char tag = data[position];
+    std::size_t size = getU32(data + position + 1);
+    if ((tag != 'K' && tag != 'D') || size < frameHeaderSize || size > indexOffset - position - blockHeaderSize) {
+        return false;
+    }
+    const unsigned char* in = data + position + blockHeaderSize;
+    const unsigned char* end = in + size;
+    std::size_t count = getU32(in + 8);
+    if (catalog + blockHeaderSize + 4 > indexOffset || count != getU32(data + catalog + blockHeaderSize)) {
+        return false; // Not the bodies of its catalog
+    }
+    bool keyframe = tag == 'K';
+    if (!keyframe && (!last || last->catalog != catalog || last->x.size() != count)) {
+        return false; // A delta frame needs the frame before it
+    }
+    frame.time = getDouble(in);
+    frame.end = position + blockHeaderSize + size;
+    frame.catalog = catalog;
+    frame.sinceKeyframe = keyframe ? 0 : last->sinceKeyframe + 1;
+    bool linear = frame.sinceKeyframe >= 2 && older && older->x.size() == count;
+    frame.x.resize(count);
+    frame.y.resize(count);
+    frame.rotation.resize(count);
+    in += frameHeaderSize;
+
+    std::uint64_t x, y, rotation;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!getVarint(in, end, x) || !getVarint(in, end, y) || !getVarint(in, end, rotation)) {
+            return false;
+        }
+        if (keyframe) {
+            frame.x[i] = unzigzag(x);
+            frame.y[i] = unzigzag(y);
+            frame.rotation[i] = static_cast<std::uint16_t>(rotation);
+        } else {
+            frame.x[i] = predict(last->x, older ? older->x : last->x, i, linear) + unzigzag(x);
+            frame.y[i] = predict(last->y, older ? older->y : last->y, i, linear) + unzigzag(y);
+            frame.rotation[i] = static_cast<std::uint16_t>(predictRotation(last->rotation, older ? older->rotation : last->rotation, i, linear)
+                                                           + unzigzag(rotation));
+        }
+    }
+    return true;
+}
+
+// Function to start decoding at a keyframe: the keyframe becomes the current frame, and the frame after it the next frame
+bool Replay::startAt(std::size_t keyframe) {
+    const unsigned char* entry = file.data() + indexOffset + keyframe * indexEntrySize;
+    hasCurrent = decodeFrame(static_cast<std::size_t>(getU64(entry + 16)), static_cast<std::size_t>(getU64(entry + 24)), nullptr, nullptr, current);
+    hasNext = false;
+    currentKeyframe = keyframe;
+    if (!hasCurrent) {
+        return false;
+    }
+    hasNext = decodeNext();
+    return true;
+}
+
+/**
+ * This function decodes the frame after the current frame into the next frame. It skips a catalog block first:
+ * the frame after it is then a keyframe with other bodies. It returns false at the end of the recording.
+ *
+ * */
+bool Replay::decodeNext() {
+    const unsigned char* data = file.data();
+    std::size_t position = current.end;
+    std::size_t catalog = current.catalog;
+    if (position < indexOffset && data[position] == 'C') {
+        if (position + blockHeaderSize > indexOffset) {
+            damaged();
+            return false;
+        }
+        catalog = position;
+        position += blockHeaderSize + getU32(data + position + 1);
+    }
+    if (position >= indexOffset) {
+        return false;
+    }
+    if (!decodeFrame(position, catalog, &current, current.sinceKeyframe > 0 ? &older : nullptr, next)) {
+        damaged();
+        return false;
+    }
+    return true;
+}
+
+// Function to fill the store with the bodies of a catalog block, in the slots 0, 1, 2...
+bool Replay::loadCatalog(BodyStore& bodies, std::size_t position) {
+    const unsigned char* data = file.data();
+    std::size_t size = getU32(data + position + 1);
+    if (size < 4 || size > indexOffset - position - blockHeaderSize) {
+        return false;
+    }
+    const unsigned char* in = data + position + blockHeaderSize;
+    std::size_t count = getU32(in);
+    if (count > (size - 4) / catalogBodySize) {
+        return false;
+    }
+    const char* strings = reinterpret_cast<const char*>(in + 4 + count * catalogBodySize);
+    std::size_t stringsLeft = size - 4 - count * catalogBodySize;
+
+    bodies.clear();
+    slotOf.resize(count);
+    std::vector<std::uint32_t> parents(count);
+    for (std::size_t entry = 0; entry < count; ++entry) {
+        const unsigned char* body = in + 4 + entry * catalogBodySize;
+        std::size_t nameLength = getU32(body + 0);
+        std::size_t textureLength = getU32(body + 4);
+        if (nameLength > stringsLeft || textureLength > stringsLeft - nameLength) {
+            return false;
+        }
+        std::string name(strings, nameLength);
+        std::string texturePath(strings + nameLength, textureLength);
+        strings += nameLength + textureLength;
+        stringsLeft -= nameLength + textureLength;
+
+        // The bodies don't move by themselves: no speeds, the positions come from the frames
+        std::size_t index = bodies.addBody(name, getFloat(body + 12), 0.0f, 0.0f, 0.0f, sf::Color(getU32(body + 16)), sf::Vector2f(0.0f, 0.0f));
+        bodies.setDistance(index, getFloat(body + 20)); // Already scaled like in the store
+        bodies.setOrbitElements(index, getFloat(body + 24), getFloat(body + 28), getFloat(body + 32), getDouble(body + 36));
+        if (!texturePath.empty() && !bodies.setTexture(index, texturePath)) {
+            LOG_WARNING("Can't load the texture %s of %s, it is drawn in its color", texturePath.c_str(), name.c_str());
+        }
+        bodies.setTrail(index, body[44] != 0);
+        slotOf[entry] = index;
+        parents[entry] = getU32(body + 8);
+    }
+    for (std::size_t entry = 0; entry < count; ++entry) {
+        if (parents[entry] < count) {
+            bodies.setParent(slotOf[entry], static_cast<int>(slotOf[parents[entry]]));
+        }
+    }
+    loadedCatalog = position;
+    loadedSize = bodies.size();
+    loadedHierarchy = bodies.getHierarchyVersion();
+    LOG_INFO("Replay: loaded %zu bodies", count);
+    return true;
+}
+
+/**
+ * This function finds the keyframe before the time with a binary search of the index. If the frames already decoded are in the same stretch
+ * between two keyframes and before the time, it goes on from them, so playing forward decodes every frame once.
+ * It then decodes forward until the next frame is after the time, and writes the two frames around the time into the store.
+ *
+ * */
+float Replay::seek(BodyStore& bodies, double time) {
+    if (!isOpen()) {
+        return 1.0f;
+    }
+    time = std::min(std::max(time, startTime), endTime);
+
+    std::size_t low = 0, high = keyframeCount; // The last keyframe at or before the time is in [low, high)
+    while (high - low > 1) {
+        std::size_t middle = low + (high - low) / 2;
+        if (keyframeTime(middle) <= time) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    if (!hasCurrent || low != currentKeyframe || time < current.time) {
+        if (!startAt(low)) {
+            damaged();
+            return 1.0f;
+        }
+    }
+    while (hasNext && next.time <= time) {
+        std::swap(older, current);
+        std::swap(current, next);
+        if (current.sinceKeyframe == 0) {
+            ++currentKeyframe; // Passed into the stretch of the next keyframe
+        }
+        hasNext = decodeNext();
+    }
+
+    // Fill the store again when the frame has other bodies, or when something else changed the store
+    if (current.catalog != loadedCatalog || bodies.size() != loadedSize || bodies.getHierarchyVersion() != loadedHierarchy) {
+        if (!loadCatalog(bodies, current.catalog)) {
+            damaged();
+            hasCurrent = false;
+            loadedCatalog = 0;
+            return 1.0f;
+        }
+    }
+
+    // Between two frames with the same bodies the rendering is interpolated, otherwise the current frame is shown as it is
+    bool between = hasNext && next.catalog == current.catalog && next.time > current.time;
+    double alpha = between ? (time - current.time) / (next.time - current.time) : 1.0;
+    const Frame& to = between ? next : current;
+    for (std::size_t entry = 0; entry < slotOf.size(); ++entry) {
+        std::size_t i = slotOf[entry];
+        bodies.previousX[i] = static_cast<double>(static_cast<std::int64_t>(current.x[entry])) * step;
+        bodies.previousY[i] = static_cast<double>(static_cast<std::int64_t>(current.y[entry])) * step;
+        bodies.positionX[i] = static_cast<double>(static_cast<std::int64_t>(to.x[entry])) * step;
+        bodies.positionY[i] = static_cast<double>(static_cast<std::int64_t>(to.y[entry])) * step;
+        std::int16_t turn = static_cast<std::int16_t>(static_cast<std::uint16_t>(to.rotation[entry] - current.rotation[entry]));
+        bodies.rotation[i] = static_cast<float>((current.rotation[entry] + alpha * turn) * (360.0 / rotationSteps));
+    }
+    return static_cast<float>(alpha);
+}
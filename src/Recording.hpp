@@ -0,0 +1,154 @@
+/**
+ * This file declares the recording of a session: the state of every body at every frame, written to a compact log (--record)
+ * that can be played back later without the database and without running any motion model (--replay), for example to review a run
+ * offline or to attach a reproducible bug report to a large catalog.
+ *
+ * The positions are quantized to a fixed step (--record-precision, in world units) and stored as integers, so they never drift.
+ * Most frames are delta frames: every coordinate is predicted from the two frames before it (x1 + (x1 - x0), a body moving in a straight line
+ * at constant speed costs nothing) and only the difference from the prediction is written, as a variable-length integer of 7 bits per byte
+ * (up to 10 bytes, but 1 or 2 for the small differences of a smooth motion).
+ * Every --record-keyframe frames, and whenever the bodies change, a keyframe with the whole quantized state is written instead.
+ * The file ends with the index of the keyframes, so a replay maps the file and finds the keyframe before any time with a binary search,
+ * then decodes at most the frames up to the next keyframe.
+ *
+ * The file is little-endian and mapped into memory (see MappedFile.hpp), like the catalog snapshot and the ephemeris:
+ *
+ *   header (64 bytes): magic "SOLARREC", format version, frames between keyframes, position step (double), number of frames,
+ *                      number of keyframes, position of the keyframe index, time of the first frame, time of the last frame
+ *   blocks:            one after the other, each a tag (u8) and the size of what follows (u32):
+ *                      'C' catalog: the bodies (name, parent, radius, color, orbit, texture, trail) that the next frames contain
+ *                      'K' keyframe and 'D' delta frame: time (double), number of bodies (u32), then x, y and rotation of every body
+ *   keyframe index:    per keyframe its time (double), frame number, position in the file and position of its catalog (u64)
+ *
+ * The times are seconds since the start of the recording, so a replay shows the session as it was seen, jumps of the simulated time included.
+ *
+ */
+
+#ifndef RECORDING_HPP
+#define RECORDING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "BodyStore.hpp"
+#include "MappedFile.hpp"
+
+// Version of the file format, incremented when the layout changes so old recordings are refused
+const std::uint32_t recordingVersion = 1;
+
+/**
+ * This class writes the frames of a session to a recording. The frames go to a temporary file; finish() appends the keyframe index,
+ * fills in the header and renames the file, so an interrupted session leaves no half-written recording behind.
+ */
+class Recorder {
+public:
+    Recorder() = default;
+    ~Recorder(); // Destructor to delete the temporary file if finish() wasn't called
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Function to start a recording. step is the quantization step of the positions in world units. It returns false if the file can't be created
+    bool open(const std::string& path, double step, std::size_t keyframeInterval);
+    bool isOpen() const { return out.is_open(); }
+
+    // Function to add a frame: the positions drawn at alpha between the previous and the current positions (see BodyStore::interpolatedPosition)
+    // at a time in seconds since the start of the recording. The times must not go back
+    void record(const BodyStore& bodies, float alpha, double time);
+    // Function to write the bodies again before the next frame, for the changes that don't show in the versions of the store (radius, color, texture)
+    void invalidateCatalog() { catalogValid = false; }
+    // Function to complete the file and print its size. It returns false on error
+    bool finish();
+
+private:
+    void writeCatalog(const BodyStore& bodies); // Function to write a catalog block with the living bodies of the store
+    void writeBlock(unsigned char tag); // Function to write the block in the buffer with its tag and size
+
+    std::string path;
+    std::string temporaryPath;
+    std::ofstream out;
+    double step = 1e-3;
+    std::size_t keyframeInterval = 120;
+    std::vector<unsigned char> buffer; // Contents of the block being written, reused for every frame
+    std::uint64_t position = 0; // Size of the file written so far
+
+    // Bodies of the last catalog block: the slots of the store, and the versions of the store when it was written
+    bool catalogValid = false;
+    std::vector<std::size_t> slots;
+    std::size_t catalogSize = 0;
+    std::size_t catalogHierarchy = 0;
+    std::size_t catalogOrbits = 0;
+    std::size_t catalogTrails = 0;
+    std::uint64_t catalogPosition = 0; // Position of the last catalog block in the file
+
+    // Quantized state of the last two frames, the prediction of the next one
+    std::vector<std::uint64_t> lastX, lastY, olderX, olderY;
+    std::vector<std::uint16_t> lastRotation, olderRotation;
+    std::size_t sinceKeyframe = 0; // Frames written since the last keyframe, the keyframe included
+    std::uint64_t frameCount = 0;
+    std::uint64_t bodyFrames = 0; // Sum of the number of bodies of every frame, for the size per body in the report
+    double firstTime = 0.0;
+    double lastTime = 0.0;
+    std::vector<unsigned char> index; // Entries of the keyframe index, written at the end
+};
+
+/**
+ * This class plays a recording back: it maps the file and sets the bodies of a store to their state at any time of the recording.
+ * The store is filled with the bodies of the recording, and filled again when the recording reaches frames with other bodies.
+ */
+class Replay {
+public:
+    // Function to map a recording and check its header and index. It returns false if the file is missing, damaged or of another version
+    bool open(const std::string& path);
+
+    bool isOpen() const { return file.data() != nullptr; }
+    double getStartTime() const { return startTime; }
+    double getEndTime() const { return endTime; }
+    std::size_t getFrameCount() const { return frameCount; }
+
+    // Function to set the bodies of the store to their state at a time of the recording. A time outside the recording is moved to its nearest end.
+    // The previous and current positions are the frames before and after the time, and the returned alpha interpolates between them
+    float seek(BodyStore& bodies, double time);
+
+private:
+    // One decoded frame: the quantized state of its bodies, and where it is in the file
+    struct Frame {
+        double time = 0.0;
+        std::size_t end = 0; // Position of the block after the frame
+        std::size_t catalog = 0; // Position of the catalog of the bodies of the frame
+        std::size_t sinceKeyframe = 0; // 0 for a keyframe
+        std::vector<std::uint64_t> x, y;
+        std::vector<std::uint16_t> rotation;
+    };
+
+    bool startAt(std::size_t keyframe); // Function to decode a keyframe into the current frame. It returns false if the file is damaged
+    bool decodeNext(); // Function to decode the frame after the current frame into the next frame. It returns false at the end or if the file is damaged
+    bool decodeFrame(std::size_t position, std::size_t catalog, const Frame* last, const Frame* older, Frame& frame); // Function to decode the frame block at a position
+    bool loadCatalog(BodyStore& bodies, std::size_t position); // Function to fill the store with the bodies of a catalog block
+    double keyframeTime(std::size_t keyframe) const; // Function to read the time of a keyframe from the index
+    void damaged(); // Function to report a damaged frame, once
+
+    MappedFile file;
+    double step = 0.0;
+    std::size_t frameCount = 0;
+    std::size_t keyframeCount = 0;
+    std::size_t indexOffset = 0;
+    double startTime = 0.0;
+    double endTime = 0.0;
+
+    Frame older; // Frame before the current frame, needed to decode the next one
+    Frame current; // Frame at or before the time of the last seek
+    Frame next; // Frame after it, valid if hasNext
+    bool hasCurrent = false;
+    bool hasNext = false;
+    std::size_t currentKeyframe = 0; // Keyframe that current was decoded from
+    std::size_t loadedCatalog = 0; // Position of the catalog the store was filled with, 0 for none
+    std::size_t loadedSize = 0; // Size and hierarchy version of the store after it was filled, to notice when someone else changed it
+    std::size_t loadedHierarchy = 0;
+    std::vector<std::size_t> slotOf; // Slot of the store of every body of the loaded catalog
+    bool reported = false;
+};
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * Purpose: Implement the methods of the SimulationClock class that are declared in the SimulationClock.hpp header file.
+ *
+ * */
+
+#include "SimulationClock.hpp"
+
+// Longest frame that is caught up, in wall-clock seconds: after a longer pause (dragging the window, a breakpoint) the simulation just continues
+static const float maxFrameSeconds = 0.25f;
+
+SimulationClock::SimulationClock(double tickSeconds, int maxTicksPerFrame)
+    : tickSeconds(tickSeconds > 0.0 ? tickSeconds : 1.0 / 120.0), maxTicksPerFrame(maxTicksPerFrame > 0 ? maxTicksPerFrame : 1) {
+}
+
+void SimulationClock::setTimeWarp(double warp) {
+    timeWarp = warp > 0.0 ? warp : 0.0;
+}
+
+void SimulationClock::seek(double time) {
+    simulationTime = time;
+    accumulator = 0.0;
+}
+
+/**
+ * If a frame needs more ticks than maxTicksPerFrame (a very high time warp on a large catalog),
+ * the extra simulated time is dropped instead of carried over. Otherwise the accumulator would grow every frame
+ * and the simulation would never catch up (the "spiral of death").
+ *
+ * */
+int SimulationClock::advance(float frameSeconds) {
+    if (frameSeconds > maxFrameSeconds) {
+        frameSeconds = maxFrameSeconds;
+    }
+    accumulator += frameSeconds * timeWarp;
+    double ticks = accumulator / tickSeconds;
+    if (ticks > maxTicksPerFrame) {
+        droppedTicks += static_cast<long long>(ticks) - maxTicksPerFrame;
+        accumulator = maxTicksPerFrame * tickSeconds + (accumulator - static_cast<long long>(ticks) * tickSeconds);
+    }
+    int count = static_cast<int>(accumulator / tickSeconds);
+    accumulator -= count * tickSeconds;
+    simulationTime += count * tickSeconds;
+    return count;
+}
+
+float SimulationClock::getAlpha() const {
+    return static_cast<float>(accumulator / tickSeconds);
+}
@@ -0,0 +1,37 @@
+/**
+ * This class decouples the simulation from the render rate with a fixed time step.
+ * Every frame, the elapsed wall-clock time (multiplied by the time warp) is added to an accumulator,
+ * and the simulation is advanced by as many fixed ticks as fit in it. The rest of the accumulator gives the interpolation factor
+ * between the last two simulated states, so the rendering stays smooth even when the render rate and the tick rate differ.
+ * A frame hitch is therefore caught up with several normal ticks instead of one large angular jump.
+ *
+ */
+
+#ifndef SIMULATIONCLOCK_HPP
+#define SIMULATIONCLOCK_HPP
+
+class SimulationClock {
+public:
+    // Constructor with the length of a tick in simulated seconds and the maximum number of ticks per frame
+    explicit SimulationClock(double tickSeconds = 1.0 / 120.0, int maxTicksPerFrame = 2048);
+
+    int advance(float frameSeconds); // Function to add the wall-clock time of a frame, it returns the number of ticks to run in this frame
+    float getAlpha() const; // Interpolation factor between the previous (0) and the current (1) simulated state
+
+    void seek(double time); // Function to jump to a simulated time
+    void setTimeWarp(double warp); // Function to set how many simulated seconds pass per wall-clock second (1 = real time, 1000 = fast-forward)
+    double getTimeWarp() const { return timeWarp; }
+    double getTickSeconds() const { return tickSeconds; }
+    double getSimulationTime() const { return simulationTime; } // Simulated time of the current state, in seconds
+    long long getDroppedTicks() const { return droppedTicks; } // Number of ticks skipped because a frame needed more than maxTicksPerFrame
+
+private:
+    double tickSeconds;
+    int maxTicksPerFrame;
+    double timeWarp = 1.0;
+    double accumulator = 0.0; // Simulated time that hasn't been simulated yet
+    double simulationTime = 0.0;
+    long long droppedTicks = 0;
+};
+
+#endif
@@ -0,0 +1,236 @@
+/**
+ * Purpose: Implement the methods of the SpatialGrid class that are declared in the SpatialGrid.hpp header file.
+ *  The grid covers the bounding box of the bodies, with about four bodies per cell on average.
+ *  A body is stored in the cell of its center only; a query is widened by "reach" so the bodies whose disc crosses into the area are found too,
+ *  and by "drift" for the bodies that have left their cell since the build.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include "SpatialGrid.hpp"
+#include "Log.hpp"
+
+// Marker for a slot without a cell (a removed body)
+static const std::uint32_t noCell = std::numeric_limits<std::uint32_t>::max();
+// Largest number of columns or rows, bounds the memory of the grid when a few bodies are very far from the others
+static const std::size_t maxCellsPerSide = 2048;
+// Smallest number of bodies given to one thread, like in UpdateScheduler
+static const std::size_t minBodiesPerChunk = 2048;
+
+/**
+ * This function measures how far the bodies have moved since the build, and the reach of the bodies of this frame.
+ * The grid is rebuilt when the store changed, or when a body has moved more than half a cell: beyond that the widened queries
+ * would visit too many cells. Slowly moving bodies therefore cost one sequential pass per frame instead of a sort.
+ *
+ * */
+void SpatialGrid::update(const BodyStore& bodies, ThreadPool& pool) {
+    if (!built || bodies.size() != builtSize || bodies.getHierarchyVersion() != builtVersion) {
+        build(bodies, pool);
+        return;
+    }
+    double maxDrift = 0.0, maxReach = 0.0;
+    std::mutex merge;
+    pool.parallelFor(bodies.size(), minBodiesPerChunk, [&](std::size_t begin, std::size_t end) {
+        double chunkDrift = 0.0, chunkReach = 0.0;
+        for (std::size_t i = begin; i < end; ++i) {
+            double x = bodies.positionX[i];
+            double y = bodies.positionY[i];
+            chunkDrift = std::max(chunkDrift, std::abs(x - builtX[i]) + std::abs(y - builtY[i]));
+            chunkReach = std::max(chunkReach, bodies.radius[i] + std::abs(x - bodies.previousX[i]) + std::abs(y - bodies.previousY[i]));
+        }
+        std::lock_guard<std::mutex> lock(merge);
+        maxDrift = std::max(maxDrift, chunkDrift);
+        maxReach = std::max(maxReach, chunkReach);
+    });
+    if (!(maxDrift <= cellSize / 2)) {
+        build(bodies, pool); // Also when a position isn't a number anymore
+        return;
+    }
+    drift = maxDrift;
+    reach = maxReach;
+}
+
+void SpatialGrid::build(const BodyStore& bodies, ThreadPool& pool) {
+    std::size_t count = bodies.size();
+
+    // Bounding box of the bodies and reach, per chunk, merged under a lock (there are only a few chunks)
+    const double infinity = std::numeric_limits<double>::infinity();
+    double minX = infinity, minY = infinity, maxX = -infinity, maxY = -infinity, maxReach = 0.0;
+    std::mutex merge;
+    pool.parallelFor(count, minBodiesPerChunk, [&](std::size_t begin, std::size_t end) {
+        double chunkMinX = infinity, chunkMinY = infinity, chunkMaxX = -infinity, chunkMaxY = -infinity, chunkReach = 0.0;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!bodies.isAlive(i)) {
+                continue;
+            }
+            double x = bodies.positionX[i];
+            double y = bodies.positionY[i];
+            chunkMinX = std::min(chunkMinX, x);
+            chunkMinY = std::min(chunkMinY, y);
+            chunkMaxX = std::max(chunkMaxX, x);
+            chunkMaxY = std::max(chunkMaxY, y);
+            // A body is drawn between its previous and its current position, so the movement counts like a bigger radius
+            double moved = std::abs(x - bodies.previousX[i]) + std::abs(y - bodies.previousY[i]);
+            chunkReach = std::max(chunkReach, bodies.radius[i] + moved);
+        }
+        std::lock_guard<std::mutex> lock(merge);
+        minX = std::min(minX, chunkMinX);
+        minY = std::min(minY, chunkMinY);
+        maxX = std::max(maxX, chunkMaxX);
+        maxY = std::max(maxY, chunkMaxY);
+        maxReach = std::max(maxReach, chunkReach);
+    });
+
+    items.clear();
+    itemX.clear();
+    itemY.clear();
+    built = true;
+    builtSize = count;
+    builtVersion = bodies.getHierarchyVersion();
+    drift = 0.0;
+    ++builds;
+    builtX.assign(bodies.positionX.begin(), bodies.positionX.end());
+    builtY.assign(bodies.positionY.begin(), bodies.positionY.end());
+    if (!(minX <= maxX)) {
+        columns = rows = 0; // No living body
+        cellStart.assign(1, 0);
+        return;
+    }
+
+    // Square cells, about four bodies per cell if they were spread evenly over the box
+    double width = maxX - minX;
+    double height = maxY - minY;
+    double targetCells = std::max(1.0, count / 4.0);
+    cellSize = std::sqrt(std::max(width * height, 1.0) / targetCells);
+    cellSize = std::max({cellSize, width / maxCellsPerSide, height / maxCellsPerSide, 1.0});
+    columns = static_cast<std::size_t>(width / cellSize) + 1;
+    rows = static_cast<std::size_t>(height / cellSize) + 1;
+    originX = minX;
+    originY = minY;
+    reach = maxReach;
+
+    // Cell of every body, in parallel
+    cellOf.resize(count);
+    pool.parallelFor(count, minBodiesPerChunk, [this, &bodies](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!bodies.isAlive(i)) {
+                cellOf[i] = noCell;
+                continue;
+            }
+            std::size_t column = std::min(static_cast<std::size_t>((bodies.positionX[i] - originX) / cellSize), columns - 1);
+            std::size_t row = std::min(static_cast<std::size_t>((bodies.positionY[i] - originY) / cellSize), rows - 1);
+            cellOf[i] = static_cast<std::uint32_t>(row * columns + column);
+        }
+    });
+
+    // Counting sort by cell. The bodies are visited in the order of the store, so each cell keeps that order
+    cellStart.assign(columns * rows + 1, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (cellOf[i] != noCell) {
+            ++cellStart[cellOf[i] + 1];
+        }
+    }
+    for (std::size_t c = 1; c < cellStart.size(); ++c) {
+        cellStart[c] += cellStart[c - 1];
+    }
+    items.resize(cellStart.back());
+    itemX.resize(items.size());
+    itemY.resize(items.size());
+    std::vector<std::uint32_t> next(cellStart.begin(), cellStart.end() - 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (cellOf[i] != noCell) {
+            std::uint32_t slot = next[cellOf[i]]++;
+            items[slot] = static_cast<std::uint32_t>(i);
+            itemX[slot] = bodies.positionX[i];
+            itemY[slot] = bodies.positionY[i];
+        }
+    }
+    LOG_DEBUG("Spatial grid: %zu bodies in %zux%zu cells of %.1f", items.size(), columns, rows, cellSize);
+}
+
+void SpatialGrid::cellRange(double left, double top, double right, double bottom, std::size_t& firstColumn, std::size_t& firstRow,
+                            std::size_t& lastColumn, std::size_t& lastRow) const {
+    // Clamp in double first: a far away rectangle must not overflow the conversion to an index
+    double maxColumn = static_cast<double>(columns - 1);
+    double maxRow = static_cast<double>(rows - 1);
+    firstColumn = static_cast<std::size_t>(std::min(std::max((left - originX) / cellSize, 0.0), maxColumn));
+    lastColumn = static_cast<std::size_t>(std::min(std::max((right - originX) / cellSize, 0.0), maxColumn));
+    firstRow = static_cast<std::size_t>(std::min(std::max((top - originY) / cellSize, 0.0), maxRow));
+    lastRow = static_cast<std::size_t>(std::min(std::max((bottom - originY) / cellSize, 0.0), maxRow));
+}
+
+/**
+ * This function visits the cells that cover the area widened by the reach and the drift of the bodies.
+ * The bodies of a cell that lies completely inside the widened area are taken without testing them,
+ * the bodies of the cells on the border are tested one by one. The result is sorted, so its cost grows with the number of visible bodies only.
+ *
+ * */
+void SpatialGrid::query(const sf::Rect<double>& area, std::vector<std::uint32_t>& found) const {
+    if (items.empty()) {
+        return;
+    }
+    double margin = reach + drift;
+    double left = area.left - margin;
+    double top = area.top - margin;
+    double right = area.left + area.width + margin;
+    double bottom = area.top + area.height + margin;
+    if (right < originX || bottom < originY || left > originX + columns * cellSize || top > originY + rows * cellSize) {
+        return; // The area doesn't touch the grid
+    }
+    std::size_t firstColumn, firstRow, lastColumn, lastRow;
+    cellRange(left, top, right, bottom, firstColumn, firstRow, lastColumn, lastRow);
+
+    std::size_t before = found.size();
+    for (std::size_t row = firstRow; row <= lastRow; ++row) {
+        double cellTop = originY + row * cellSize;
+        bool rowInside = cellTop >= top && cellTop + cellSize <= bottom;
+        for (std::size_t column = firstColumn; column <= lastColumn; ++column) {
+            std::size_t cell = row * columns + column;
+            std::uint32_t begin = cellStart[cell];
+            std::uint32_t end = cellStart[cell + 1];
+            double cellLeft = originX + column * cellSize;
+            if (rowInside && cellLeft >= left && cellLeft + cellSize <= right) {
+                found.insert(found.end(), items.begin() + begin, items.begin() + end);
+                continue;
+            }
+            for (std::uint32_t k = begin; k < end; ++k) {
+                if (itemX[k] >= left && itemX[k] <= right && itemY[k] >= top && itemY[k] <= bottom) {
+                    found.push_back(items[k]);
+                }
+            }
+        }
+    }
+    std::sort(found.begin() + before, found.end());
+}
+
+// Function to find the body under a point. Bodies drawn later are on top, so the highest index wins
+int SpatialGrid::pick(const BodyStore& bodies, sf::Vector2<double> point) const {
+    if (items.empty()) {
+        return -1;
+    }
+    double margin = reach + drift;
+    std::size_t firstColumn, firstRow, lastColumn, lastRow;
+    cellRange(point.x - margin, point.y - margin, point.x + margin, point.y + margin, firstColumn, firstRow, lastColumn, lastRow);
+    int picked = -1;
+    for (std::size_t row = firstRow; row <= lastRow; ++row) {
+        for (std::size_t column = firstColumn; column <= lastColumn; ++column) {
+            std::size_t cell = row * columns + column;
+            for (std::uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; ++k) {
+                std::uint32_t index = items[k];
+                if (static_cast<int>(index) <= picked || index >= bodies.size() || !bodies.isAlive(index)) {
+                    continue; // Below the body found so far, or removed since the build
+                }
+                double dx = point.x - bodies.positionX[index]; // The current position, the grid may be a few frames old
+                double dy = point.y - bodies.positionY[index];
+                double radius = bodies.radius[index];
+                if (dx * dx + dy * dy <= radius * radius) {
+                    picked = static_cast<int>(index);
+                }
+            }
+        }
+    }
+    return picked;
+}
@@ -0,0 +1,64 @@
+/**
+ * This class sorts the bodies of a BodyStore into a uniform grid of square cells over their positions,
+ * so the bodies in a region of the world can be found without looking at all of them.
+ * BodyRenderer uses it to draw only the bodies inside the view (with a large catalog most of them are off-screen),
+ * and the main loop uses it to find the body under the mouse: both cost in proportion to the bodies near the region, not to the catalog.
+ *
+ * The grid is kept up to date incrementally. After every update, one sequential pass measures how far the bodies have moved since the grid was built;
+ * as long as it is less than half a cell, the queries are simply widened by that distance and the grid is kept as it is.
+ * Only when a body has moved further, or bodies were added or removed, the grid is rebuilt with a counting sort of the bodies by cell,
+ * like the depth levels of UpdateScheduler. The cells are stored one after the other in a single array.
+ *
+ * The grid works in world coordinates in double precision, like the positions of the BodyStore: a query for a small area far from the origin
+ * (the view of a camera zoomed on a moon of Neptune) must not be rounded to the cells next to it.
+ *
+ */
+
+#ifndef SPATIALGRID_HPP
+#define SPATIALGRID_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BodyStore.hpp"
+#include "ThreadPool.hpp"
+
+class SpatialGrid {
+public:
+    void update(const BodyStore& bodies, ThreadPool& pool); // Function to follow the new positions of the bodies, called once per frame after the update
+
+    // Function to find the bodies that may overlap an area. The indices are appended to "found" in the order of the store, so they are drawn in the same order as without the grid.
+    // The test is conservative: a body can be a little outside the area, but a body that overlaps it is never missed.
+    void query(const sf::Rect<double>& area, std::vector<std::uint32_t>& found) const;
+    int pick(const BodyStore& bodies, sf::Vector2<double> point) const; // Function to find the body under a point (the one drawn on top), returns -1 if there is none
+
+    std::size_t getCellCount() const { return columns * rows; } // Number of cells of the last build
+    std::size_t getBuildCount() const { return builds; } // Number of times the grid was rebuilt
+
+private:
+    void build(const BodyStore& bodies, ThreadPool& pool); // Function to sort all living bodies into the grid
+    void cellRange(double left, double top, double right, double bottom, std::size_t& firstColumn, std::size_t& firstRow,
+                   std::size_t& lastColumn, std::size_t& lastRow) const; // Function to get the cells that cover a rectangle, clamped to the grid
+
+    double originX = 0.0; // World coordinates of the top left corner of the grid
+    double originY = 0.0;
+    double cellSize = 1.0;
+    std::size_t columns = 0;
+    std::size_t rows = 0;
+    double reach = 0.0; // Largest radius plus the largest movement of the last tick: how far a body can be drawn from its position
+    double drift = 0.0; // Largest distance (along x plus along y) a body has moved since the build
+    bool built = false;
+    std::size_t builtSize = 0; // Size and hierarchy version of the store at the build, a change means bodies were added or removed
+    std::size_t builtVersion = 0;
+    std::size_t builds = 0;
+    std::vector<std::uint32_t> cellStart; // The bodies of cell c are items[cellStart[c]] to items[cellStart[c + 1] - 1]
+    std::vector<std::uint32_t> items; // Indices of the bodies, sorted by cell, in the order of the store inside a cell
+    std::vector<std::uint32_t> cellOf; // Cell of every body during the build, noCell for the slot of a removed body
+    std::vector<double> itemX; // Positions of the bodies in the order of items, so a query reads them sequentially
+    std::vector<double> itemY;
+    std::vector<double> builtX; // Positions of the bodies at the build, in the order of the store, to measure the drift
+    std::vector<double> builtY;
+};
+
+#endif
@@ -0,0 +1,265 @@
+/**
+ * Purpose: Implement the methods of the TextureCache class that are declared in the TextureCache.hpp header file.
+ *  An atlas page is filled with shelves: an image goes on the first row that is high enough and has room left,
+ *  otherwise a new row is started below the last one. preload() packs the tallest images first, so the rows are filled evenly.
+ *  The space of a released image is only reused once its page is empty; the textures of a catalog rarely change while it runs.
+ *
+ * */
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <unordered_set>
+#include "TextureCache.hpp"
+#include "Log.hpp"
+
+// Empty pixels between two images of an atlas, so a smoothed texture doesn't bleed into its neighbour
+static const unsigned int atlasPadding = 1;
+
+TextureCache::TextureCache(unsigned int atlasSize, unsigned int maxPackedSize)
+    : atlasSize(atlasSize), maxPackedSize(std::min(maxPackedSize, atlasSize)) {
+}
+
+/**
+ * This function decodes the images on all threads of the pool, then puts them on the pages one after the other.
+ * A file that appears several times in the list, or that is already in the cache, is decoded only once.
+ *
+ * */
+std::size_t TextureCache::preload(const std::vector<std::string>& paths, ThreadPool& pool) {
+    std::vector<std::string> missing;
+    std::unordered_set<std::string> seen;
+    for (const auto& path : paths) {
+        if (!path.empty() && byPath.find(path) == byPath.end() && seen.insert(path).second) {
+            missing.push_back(path);
+        }
+    }
+    if (missing.empty()) {
+        return 0;
+    }
+
+    // Decode in parallel: every image is written by one thread only
+    std::vector<sf::Image> images(missing.size());
+    std::vector<std::uint8_t> decoded(missing.size(), 0);
+    pool.parallelFor(missing.size(), 1, [&missing, &images, &decoded](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            decoded[i] = images[i].loadFromFile(missing[i]) ? 1 : 0;
+        }
+    });
+
+    // Pack the tallest images first
+    std::vector<std::size_t> order(missing.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&images](std::size_t a, std::size_t b) {
+        return images[a].getSize().y > images[b].getSize().y;
+    });
+    std::size_t added = 0;
+    for (std::size_t i : order) {
+        if (decoded[i] && insert(missing[i], images[i]) != noTexture) {
+            ++added;
+        } else {
+            std::cerr << "Can't load the texture " << missing[i] << std::endl;
+            byPath.emplace(missing[i], noTexture); // Don't try this file again
+            ++failedPaths;
+        }
+    }
+    LOG_INFO("Preloaded %zu textures on %zu pages", added, getPageCount());
+    return added;
+}
+
+// Function to get a texture, the file is loaded on the calling thread the first time it is asked for
+TextureHandle TextureCache::acquire(const std::string& path) {
+    if (path.empty()) {
+        return noTexture;
+    }
+    TextureHandle handle;
+    auto found = byPath.find(path);
+    if (found != byPath.end()) {
+        handle = found->second;
+    } else {
+        sf::Image image;
+        handle = image.loadFromFile(path) ? insert(path, image) : noTexture;
+        if (handle == noTexture) {
+            std::cerr << "Can't load the texture " << path << std::endl;
+            byPath.emplace(path, noTexture);
+            ++failedPaths;
+        }
+    }
+    if (handle != noTexture) {
+        ++entries[handle - 1].references;
+    }
+    return handle;
+}
+
+void TextureCache::release(TextureHandle handle) {
+    if (handle == noTexture || handle > entries.size()) {
+        return;
+    }
+    Entry& entry = entries[handle - 1];
+    if (entry.references == 0 || --entry.references > 0) {
+        return; // Still used by another body
+    }
+    Page& page = pages[entry.page];
+    if (--page.images == 0) {
+        page.shelves.clear(); // The whole atlas is free again
+        if (!page.atlas) {
+            page.texture.reset(); // A big image had the page to itself, give its memory back
+        }
+    }
+    byPath.erase(entry.path);
+    entry = Entry();
+    freeEntries.push_back(handle);
+}
+
+const sf::Texture* TextureCache::getTexture(TextureHandle handle) const {
+    if (handle == noTexture) {
+        return nullptr;
+    }
+    return pages[entries[handle - 1].page].texture.get();
+}
+
+sf::FloatRect TextureCache::getRect(TextureHandle handle) const {
+    if (handle == noTexture) {
+        return sf::FloatRect();
+    }
+    return entries[handle - 1].rect;
+}
+
+const std::string& TextureCache::getPath(TextureHandle handle) const {
+    static const std::string none;
+    if (handle == noTexture) {
+        return none;
+    }
+    return entries[handle - 1].path;
+}
+
+sf::Color TextureCache::getAverageColor(TextureHandle handle) const {
+    if (handle == noTexture) {
+        return sf::Color::White;
+    }
+    return entries[handle - 1].average;
+}
+
+// Function to calculate the mean color of an image, on at most about 4096 of its pixels
+static sf::Color averageColor(const sf::Image& image) {
+    sf::Vector2u size = image.getSize();
+    const sf::Uint8* pixels = image.getPixelsPtr();
+    std::size_t count = static_cast<std::size_t>(size.x) * size.y;
+    std::size_t step = std::max<std::size_t>(1, count / 4096);
+    unsigned long long sum[4] = {0, 0, 0, 0};
+    std::size_t samples = 0;
+    for (std::size_t p = 0; p < count; p += step) {
+        for (int c = 0; c < 4; ++c) {
+            sum[c] += pixels[p * 4 + c];
+        }
+        ++samples;
+    }
+    return sf::Color(static_cast<sf::Uint8>(sum[0] / samples), static_cast<sf::Uint8>(sum[1] / samples),
+                     static_cast<sf::Uint8>(sum[2] / samples), static_cast<sf::Uint8>(sum[3] / samples));
+}
+
+std::size_t TextureCache::getPageCount() const {
+    std::size_t count = 0;
+    for (const auto& page : pages) {
+        if (page.texture && page.images > 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+// Function to find room for an image on the shelves of an atlas page, or to start a new shelf. It returns false if the page is full
+bool TextureCache::placeInAtlas(Page& page, unsigned int width, unsigned int height, unsigned int& x, unsigned int& y) {
+    unsigned int size = page.texture->getSize().x;
+    for (auto& shelf : page.shelves) {
+        if (height <= shelf.height && shelf.used + width <= size) {
+            x = shelf.used;
+            y = shelf.top;
+            shelf.used += width + atlasPadding;
+            return true;
+        }
+    }
+    unsigned int top = page.shelves.empty() ? 0 : page.shelves.back().top + page.shelves.back().height + atlasPadding;
+    if (top + height > size || width > size) {
+        return false;
+    }
+    Shelf shelf;
+    shelf.top = top;
+    shelf.height = height;
+    shelf.used = width + atlasPadding;
+    page.shelves.push_back(shelf);
+    x = 0;
+    y = top;
+    return true;
+}
+
+/**
+ * This function copies a decoded image to the graphics card. A small image goes into the first atlas page with room for it,
+ * a new page is created when they are all full. A big image gets a page of its own.
+ *
+ * */
+TextureHandle TextureCache::insert(const std::string& path, const sf::Image& image) {
+    sf::Vector2u size = image.getSize();
+    if (size.x == 0 || size.y == 0) {
+        return noTexture;
+    }
+    std::size_t pageIndex = pages.size();
+    unsigned int x = 0;
+    unsigned int y = 0;
+    if (size.x <= maxPackedSize && size.y <= maxPackedSize) {
+        for (std::size_t p = 0; p < pages.size(); ++p) {
+            if (pages[p].atlas && pages[p].texture && placeInAtlas(pages[p], size.x, size.y, x, y)) {
+                pageIndex = p;
+                break;
+            }
+        }
+        if (pageIndex == pages.size()) {
+            // Every atlas is full: start a new one, no bigger than the graphics card allows
+            unsigned int pageSize = std::min(atlasSize, sf::Texture::getMaximumSize());
+            Page page;
+            page.texture.reset(new sf::Texture());
+            if (!page.texture->create(pageSize, pageSize)) {
+                return noTexture;
+            }
+            pages.push_back(std::move(page));
+            if (!placeInAtlas(pages.back(), size.x, size.y, x, y)) {
+                return noTexture; // Bigger than the page the graphics card allows
+            }
+        }
+        pages[pageIndex].texture->update(image, x, y);
+    } else {
+        // Reuse the slot of a big image that was released, or add one
+        for (std::size_t p = 0; p < pages.size(); ++p) {
+            if (!pages[p].atlas && !pages[p].texture) {
+                pageIndex = p;
+                break;
+            }
+        }
+        std::unique_ptr<sf::Texture> texture(new sf::Texture());
+        if (!texture->loadFromImage(image)) {
+            return noTexture;
+        }
+        if (pageIndex == pages.size()) {
+            pages.emplace_back();
+            pages.back().atlas = false;
+        }
+        pages[pageIndex].texture = std::move(texture);
+    }
+    ++pages[pageIndex].images;
+
+    TextureHandle handle;
+    if (!freeEntries.empty()) {
+        handle = freeEntries.back();
+        freeEntries.pop_back();
+    } else {
+        entries.emplace_back();
+        handle = static_cast<TextureHandle>(entries.size());
+    }
+    Entry& entry = entries[handle - 1];
+    entry.path = path;
+    entry.page = pageIndex;
+    entry.rect = sf::FloatRect(static_cast<float>(x), static_cast<float>(y), static_cast<float>(size.x), static_cast<float>(size.y));
+    entry.average = averageColor(image);
+    entry.references = 0;
+    byPath[path] = handle;
+    return handle;
+}
@@ -0,0 +1,87 @@
+/**
+ * This class loads every texture file once and shares it between all bodies that use it.
+ * A texture is identified by its path: the second body that asks for the same file gets the same texture and only a reference count changes.
+ * Small textures are packed into big atlas textures (shelf packing: rows of images, each row as high as its tallest image),
+ * so bodies with different small textures still share a texture, and BodyRenderer draws them in one draw call.
+ * A body only keeps a TextureHandle (a number), the pixels live in the cache.
+ *
+ * The files can be decoded in parallel on a ThreadPool with preload(). Decoding an image doesn't need the graphics card,
+ * only the copy into the atlas does, and that is done by the calling thread.
+ *
+ */
+
+#ifndef TEXTURECACHE_HPP
+#define TEXTURECACHE_HPP
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ThreadPool.hpp"
+
+// Reference to a texture of the cache, noTexture (0) for no texture
+typedef std::uint32_t TextureHandle;
+const TextureHandle noTexture = 0;
+
+class TextureCache {
+public:
+    // Constructor with the size of an atlas page and the size above which a texture gets a page of its own, in pixels
+    explicit TextureCache(unsigned int atlasSize = 2048, unsigned int maxPackedSize = 256);
+
+    TextureCache(const TextureCache&) = delete; // The handles point into this object, so it can't be copied
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Function to decode the files that aren't in the cache yet, in parallel on the pool, and pack them. It returns the number of textures added.
+    // The textures stay in the cache without any reference until they are acquired and released.
+    std::size_t preload(const std::vector<std::string>& paths, ThreadPool& pool);
+    TextureHandle acquire(const std::string& path); // Function to get the texture of a file and add a reference to it, returns noTexture if it can't be loaded
+    void release(TextureHandle handle); // Function to remove a reference, the texture is freed with its last reference
+
+    const sf::Texture* getTexture(TextureHandle handle) const; // Function to get the texture (atlas page) of a handle, nullptr for noTexture
+    sf::FloatRect getRect(TextureHandle handle) const; // Function to get the part of the page that holds the image, in pixels
+    const std::string& getPath(TextureHandle handle) const; // Function to get the file of a handle, empty for noTexture
+    sf::Color getAverageColor(TextureHandle handle) const; // Function to get the mean color of the image, white for noTexture. Used to draw a body too small for its texture
+    std::size_t getTextureCount() const { return byPath.size() - failedPaths; } // Number of files in the cache
+    std::size_t getPageCount() const; // Number of textures on the graphics card
+
+private:
+    // One row of images in an atlas page
+    struct Shelf {
+        unsigned int top = 0;
+        unsigned int height = 0;
+        unsigned int used = 0; // Width taken by the images of the row
+    };
+
+    // One texture on the graphics card: an atlas holding many images, or a single big image
+    struct Page {
+        std::unique_ptr<sf::Texture> texture; // On the heap, so the pointers given to the renderer stay valid when the vector grows
+        std::vector<Shelf> shelves;
+        std::size_t images = 0; // Number of images on the page, the page is emptied when it drops to 0
+        bool atlas = true;
+    };
+
+    // One file of the cache
+    struct Entry {
+        std::string path;
+        std::size_t page = 0;
+        sf::FloatRect rect;
+        sf::Color average;
+        std::size_t references = 0;
+    };
+
+    TextureHandle insert(const std::string& path, const sf::Image& image); // Function to put a decoded image on a page
+    bool placeInAtlas(Page& page, unsigned int width, unsigned int height, unsigned int& x, unsigned int& y); // Function to find room on a page
+
+    unsigned int atlasSize;
+    unsigned int maxPackedSize;
+    std::vector<Page> pages;
+    std::vector<Entry> entries; // The entry of handle h is entries[h - 1]
+    std::vector<TextureHandle> freeEntries; // Entries of released textures, reused by insert
+    std::unordered_map<std::string, TextureHandle> byPath; // Handle of every file, noTexture for a file that can't be loaded
+    std::size_t failedPaths = 0; // Number of files in byPath that can't be loaded
+};
+
+#endif
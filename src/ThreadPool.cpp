@@ -0,0 +1,101 @@
+/**
+ * Purpose: Implement the methods of the ThreadPool class that are declared in the ThreadPool.hpp header file.
+ *  The elements of a loop are handed out in chunks with an atomic counter, so the threads don't need a lock to take work.
+ *  The mutex is only used to start a loop and to wait for its end.
+ *
+ * */
+
+#include <algorithm>
+#include <chrono>
+#include "ThreadPool.hpp"
+
+// Constructor: the calling thread works on every loop too, so one thread less is started
+ThreadPool::ThreadPool(std::size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = 1; // hardware_concurrency() returns 0 when the number of cores is unknown
+    }
+    for (std::size_t i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+// Destructor: wake up all workers, tell them to stop, and wait until they have finished
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+float ThreadPool::parallelFor(std::size_t count, std::size_t minChunk, const std::function<void(std::size_t, std::size_t)>& task) {
+    if (count == 0) {
+        return 0.0f;
+    }
+    minChunk = std::max<std::size_t>(minChunk, 1);
+    std::size_t threads = getThreadCount();
+    if (threads == 1 || count <= minChunk) {
+        task(0, count); // Not worth waking up the workers
+        return 0.0f;
+    }
+
+    // Publish the loop: about four chunks per thread, so a thread that finishes early can help the others
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        currentCount = count;
+        chunkSize = std::max(minChunk, (count + threads * 4 - 1) / (threads * 4));
+        nextIndex.store(0);
+        activeWorkers = workers.size();
+        ++generation;
+    }
+    workAvailable.notify_all();
+
+    runChunks(); // The calling thread works too
+
+    // Barrier: wait until every worker has left the loop, and measure how long it takes
+    auto waitStart = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        workFinished.wait(lock, [this] { return activeWorkers == 0; });
+        currentTask = nullptr;
+    }
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - waitStart).count();
+}
+
+void ThreadPool::runChunks() {
+    while (true) {
+        std::size_t begin = nextIndex.fetch_add(chunkSize);
+        if (begin >= currentCount) {
+            return;
+        }
+        (*currentTask)(begin, std::min(begin + chunkSize, currentCount));
+    }
+}
+
+void ThreadPool::workerLoop() {
+    std::size_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --activeWorkers;
+            if (activeWorkers == 0) {
+                workFinished.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+/**
+ * This class represents a fixed group of worker threads that split loops over many bodies between them.
+ * The threads are created once and wait for work, so a parallel loop doesn't pay for creating threads every frame.
+ * The thread that calls parallelFor also works on the loop, and the call returns when all parts of the loop are finished (a barrier).
+ *
+ */
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency()); // Constructor to start the worker threads, the calling thread counts as one of them
+    ~ThreadPool(); // Destructor to stop and join the worker threads
+
+    ThreadPool(const ThreadPool&) = delete; // A thread pool can't be copied
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Function to run task(begin, end) on consecutive chunks of [0, count), in parallel on all threads.
+     * A chunk has at least minChunk elements, so small loops run on the calling thread only.
+     * It returns the time in seconds the calling thread waited for the other threads after finishing its own chunks (the barrier cost).
+     */
+    float parallelFor(std::size_t count, std::size_t minChunk, const std::function<void(std::size_t, std::size_t)>& task);
+
+    std::size_t getThreadCount() const { return workers.size() + 1; } // Number of threads working on a loop, including the calling thread
+
+private:
+    void workerLoop(); // Function run by every worker thread
+    void runChunks(); // Function to take chunks of the current loop until there are none left
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workAvailable; // Signaled when a new loop starts or when the pool stops
+    std::condition_variable workFinished; // Signaled when the last worker leaves the current loop
+    const std::function<void(std::size_t, std::size_t)>* currentTask = nullptr; // Loop body of the current loop
+    std::size_t currentCount = 0; // Number of elements of the current loop
+    std::size_t chunkSize = 1; // Number of elements taken at once
+    std::atomic<std::size_t> nextIndex{0}; // First element that hasn't been taken yet
+    std::size_t generation = 0; // Incremented for every loop, so a worker knows when there is new work
+    std::size_t activeWorkers = 0; // Number of workers still working on the current loop
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ * Purpose: Implement the methods of the UpdateScheduler class that are declared in the UpdateScheduler.hpp header file.
+ *  An update has two steps:
+ *  1. The orbit kernel, the Kepler solver and the rotation run on contiguous chunks of the store. They don't depend on other bodies, so all chunks run in parallel.
+ *  2. The relative positions are added to the positions of the parents, level by level, with a barrier between the levels.
+ *  evaluateAt() replaces step 1 with the closed-form angles at a given time.
+ *  evaluateEphemeris() replaces both steps with a lookup of the positions in a table.
+ *
+ * */
+
+#include <chrono>
+#include <iostream>
+#include "UpdateScheduler.hpp"
+#include "OrbitKernel.hpp"
+#include "Ephemeris.hpp"
+
+// Smallest number of bodies given to one thread: below this the cost of waking a thread is higher than the work
+static const std::size_t minBodiesPerChunk = 2048;
+
+UpdateScheduler::UpdateScheduler(ThreadPool& pool) : pool(pool) {
+}
+
+/**
+ * This function computes the depth of every body by following its parents, then sorts the bodies by depth with a counting sort.
+ * The sort is stable, so the bodies of one level keep the order of the store and the memory is still read mostly sequentially.
+ * A body whose parents form a cycle is put at depth 0, like a body without a parent.
+ *
+ * */
+void UpdateScheduler::rebuildLevels(const BodyStore& bodies) {
+    std::size_t count = bodies.size();
+    const int unknown = -1;
+    const int visiting = -2;
+    std::vector<int> depth(count, unknown);
+    std::vector<std::size_t> chain; // Bodies whose depth depends on the body at the end of the chain
+    int maxDepth = 0;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        // Walk up the parents until a body with a known depth or a root is found
+        std::size_t current = i;
+        while (depth[current] == unknown) {
+            depth[current] = visiting;
+            chain.push_back(current);
+            int parentIndex = bodies.parent[current];
+            if (parentIndex < 0) {
+                break;
+            }
+            current = static_cast<std::size_t>(parentIndex);
+        }
+        int base = 0;
+        if (depth[current] >= 0) {
+            base = depth[current] + 1;
+        } else if (bodies.parent[current] >= 0) {
+            std::cerr << "Orbit cycle found at '" << bodies.name[current] << "', it is updated as a root" << std::endl;
+        }
+        // Assign the depths from the top of the chain down to the body we started from
+        for (std::size_t k = chain.size(); k-- > 0;) {
+            depth[chain[k]] = base++;
+            if (depth[chain[k]] > maxDepth) {
+                maxDepth = depth[chain[k]];
+            }
+        }
+        chain.clear();
+    }
+
+    // Counting sort by depth
+    levelStart.assign(static_cast<std::size_t>(maxDepth) + 2, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        ++levelStart[static_cast<std::size_t>(depth[i]) + 1];
+    }
+    for (std::size_t d = 1; d < levelStart.size(); ++d) {
+        levelStart[d] += levelStart[d - 1];
+    }
+    order.resize(count);
+    std::vector<std::size_t> next(levelStart.begin(), levelStart.end() - 1);
+    for (std::size_t i = 0; i < count; ++i) {
+        order[next[static_cast<std::size_t>(depth[i])]++] = i;
+    }
+
+    builtVersion = bodies.getHierarchyVersion();
+    built = true;
+}
+
+void UpdateScheduler::update(BodyStore& bodies, float deltaTime) {
+    auto start = std::chrono::steady_clock::now();
+    if (!built || builtVersion != bodies.getHierarchyVersion()) {
+        rebuildLevels(bodies);
+    }
+
+    // Step 1: orbit kernel, Kepler solver and rotation, on contiguous chunks
+    float barrier = pool.parallelFor(bodies.size(), minBodiesPerChunk, [&bodies, deltaTime](std::size_t begin, std::size_t end) {
+        propagateOrbits(&bodies.angle[begin], &bodies.orbitSpeed[begin], &bodies.distance[begin],
+                        &bodies.offsetX[begin], &bodies.offsetY[begin], end - begin, deltaTime);
+        bodies.applyKeplerOrbits(begin, end);
+        for (std::size_t i = begin; i < end; ++i) {
+            bodies.rotation[i] += bodies.rotationSpeed[i] * deltaTime;
+        }
+    });
+
+    // Step 2: positions, one level after the other
+    barrier += updatePositions(bodies);
+    finishStats(start, barrier);
+}
+
+/**
+ * This function sets the state of all bodies at a simulated time instead of advancing it.
+ * The angles are computed in closed form in parallel chunks, then the orbit kernel runs with a time step of 0 to get the offsets,
+ * and the positions are calculated level by level like in update().
+ *
+ * */
+void UpdateScheduler::evaluateAt(BodyStore& bodies, double time) {
+    auto start = std::chrono::steady_clock::now();
+    if (!built || builtVersion != bodies.getHierarchyVersion()) {
+        rebuildLevels(bodies);
+    }
+    float barrier = pool.parallelFor(bodies.size(), minBodiesPerChunk, [&bodies, time](std::size_t begin, std::size_t end) {
+        bodies.evaluateAnglesAt(time, begin, end);
+        propagateOrbits(&bodies.angle[begin], &bodies.orbitSpeed[begin], &bodies.distance[begin],
+                        &bodies.offsetX[begin], &bodies.offsetY[begin], end - begin, 0.0f);
+        bodies.applyKeplerOrbits(begin, end);
+    });
+    barrier += updatePositions(bodies);
+    finishStats(start, barrier);
+}
+
+/**
+ * This function looks the positions up in the table, in parallel: the bodies don't depend on each other, so there are no levels to wait for.
+ * The rotations are still evaluated in closed form. When some bodies aren't in the table, all bodies are first evaluated like in evaluateAt.
+ *
+ * */
+void UpdateScheduler::evaluateEphemeris(BodyStore& bodies, Ephemeris& ephemeris, double time) {
+    auto start = std::chrono::steady_clock::now();
+    if (!built || builtVersion != bodies.getHierarchyVersion()) {
+        rebuildLevels(bodies); // Only for the stats and for the bodies missing from the table
+    }
+    float barrier = 0.0f;
+    bool complete = ephemeris.mapBodies(bodies);
+    if (!complete) {
+        evaluateAt(bodies, time);
+        barrier = stats.barrierSeconds;
+    }
+    barrier += pool.parallelFor(bodies.size(), minBodiesPerChunk, [&bodies, &ephemeris, time, complete](std::size_t begin, std::size_t end) {
+        if (complete) {
+            bodies.evaluateAnglesAt(time, begin, end);
+        }
+        ephemeris.evaluate(bodies, time, begin, end);
+    });
+    finishStats(start, barrier);
+}
+
+float UpdateScheduler::updatePositions(BodyStore& bodies) {
+    float barrier = 0.0f;
+    for (std::size_t d = 0; d + 1 < levelStart.size(); ++d) {
+        const std::size_t* level = &order[levelStart[d]];
+        barrier += pool.parallelFor(levelStart[d + 1] - levelStart[d], minBodiesPerChunk, [&bodies, level](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                bodies.updatePosition(level[k]);
+            }
+        });
+    }
+    return barrier;
+}
+
+void UpdateScheduler::finishStats(std::chrono::steady_clock::time_point start, float barrier) {
+    stats.barrierSeconds = barrier;
+    stats.levels = levelStart.size() - 1;
+    stats.threads = pool.getThreadCount();
+    stats.updateSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,51 @@
+/**
+ * This class updates all bodies of a BodyStore in parallel, in the order of the orbit hierarchy.
+ * The bodies are sorted by depth: depth 0 for the bodies orbiting the world origin, depth 1 for the bodies orbiting them, and so on.
+ * A level is only updated after the level before it, so a moon always uses the position of its parent in the current frame,
+ * whatever the order of the rows in the database. The bodies of one level are split between the threads of a ThreadPool.
+ *
+ */
+
+#ifndef UPDATESCHEDULER_HPP
+#define UPDATESCHEDULER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+#include "BodyStore.hpp"
+#include "ThreadPool.hpp"
+
+class Ephemeris;
+
+// Timing of the last update, in seconds
+struct SchedulerStats {
+    float updateSeconds = 0.0f; // Time of the whole update
+    float barrierSeconds = 0.0f; // Time the main thread waited for the other threads at the end of each parallel loop, summed over the frame
+    std::size_t levels = 0; // Number of depth levels of the orbit hierarchy
+    std::size_t threads = 0; // Number of threads working on the update
+};
+
+class UpdateScheduler {
+public:
+    explicit UpdateScheduler(ThreadPool& pool); // Constructor to create a scheduler that uses the threads of the specified pool
+
+    void update(BodyStore& bodies, float deltaTime); // Function to update the orbit and rotation of all bodies
+    void evaluateAt(BodyStore& bodies, double time); // Function to set all bodies to their state at a simulated time, in closed form (see BodyStore::evaluateAnglesAt)
+    // Function to set all bodies to their positions at a simulated time from an ephemeris table. The bodies missing from the table keep their scripted orbits
+    void evaluateEphemeris(BodyStore& bodies, Ephemeris& ephemeris, double time);
+    const SchedulerStats& getStats() const { return stats; } // Function to get the timing of the last update
+
+private:
+    void rebuildLevels(const BodyStore& bodies); // Function to sort the bodies by depth, called when the hierarchy has changed
+    float updatePositions(BodyStore& bodies); // Function to add the offsets to the positions of the parents, level by level. It returns the barrier time
+    void finishStats(std::chrono::steady_clock::time_point start, float barrier); // Function to fill the stats at the end of an update
+
+    ThreadPool& pool;
+    std::vector<std::size_t> order; // Indices of the bodies sorted by depth
+    std::vector<std::size_t> levelStart; // The bodies of level d are order[levelStart[d]] to order[levelStart[d + 1] - 1]
+    std::size_t builtVersion = 0; // Hierarchy version of the store the levels were built for
+    bool built = false;
+    SchedulerStats stats;
+};
+
+#endif
@@ -1,63 +1,410 @@
 #include <SFML/Graphics.hpp> // Include the SFML graphics library for graphics rendering
 #include "Planet.hpp"
+#include "BodyStore.hpp"
 #include "Database.hpp"
+#include "CatalogLoader.hpp"
+#include "CatalogListener.hpp"
+#include "ThreadPool.hpp"
+#include "UpdateScheduler.hpp"
+#include "SpatialGrid.hpp"
+#include "GravitySimulation.hpp"
+#include "Log.hpp"
+#include "BodyRenderer.hpp"
+#include "Options.hpp"
+#include "Headless.hpp"
+#include "Profiler.hpp"
+#include "SimulationClock.hpp"
+#include "Camera.hpp"
+#include "OrbitTrails.hpp"
+#include "OrbitPaths.hpp"
+#include "Ephemeris.hpp"
+#include "Recording.hpp"
+#include <chrono>
+#include <memory>
 #include <vector>
+#include <cmath> // For std::pow
 #include <cstdlib> // For std::getenv
-#include <iostream> // For std::cerr
+#include <iostream> // For std::cerr and std::cout
 
-int main() {
-    // Create a window with a resolution of 800x600 pixels -> 1600x1200 pixels(changed to see the whole solar system)
-    sf::RenderWindow window(sf::VideoMode(1600, 1200), "Solar System Simulation");
+int main(int argc, char* argv[]) {
+    // Read the options from the command line
+    SimulationOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // The benchmark of the N-body mode needs no planets
+    if (options.benchmarkNBody) {
+        ThreadPool pool;
+        return runGravityBenchmark(options, pool);
+    }
 
-    // Retrieve the connection string from an environment variable
+    // Retrieve the connection string from an environment variable. Without it the planets can only come from a snapshot or a recording.
     const char* db_conn = std::getenv("DB_CONNECTION_STRING");
-    if (!db_conn) {
+    if (!db_conn && options.snapshotPath.empty() && options.replayPath.empty()) {
         std::cerr << "DB_CONNECTION_STRING environment variable not set" << std::endl;
         return 1;
     }
-    std::string connectionString = db_conn;
-    // Create a database connection
-    Database db(connectionString);
+    std::string connectionString = db_conn ? db_conn : "";
+
+    // Start the log if a level is set in the SOLAR_LOG_LEVEL environment variable (debug, info, warning or error)
+    const char* logLevel = std::getenv("SOLAR_LOG_LEVEL");
+    if (logLevel && Log::parseLevel(logLevel) != LogLevel::Off) {
+        const char* logFile = std::getenv("SOLAR_LOG_FILE");
+        Log::start(logFile ? logFile : "solar_system.log", Log::parseLevel(logLevel));
+    }
+
+    // A recording brings its own bodies and positions: nothing is loaded from the database and no model runs
+    Replay replay;
+    if (!options.replayPath.empty() && !replay.open(options.replayPath)) {
+        Log::stop();
+        return 1;
+    }
+
+    // Recording of the positions of every frame
+    Recorder recorder;
+    if (!options.recordPath.empty() && !recorder.open(options.recordPath, options.recordPrecision, options.recordKeyframe)) {
+        Log::stop();
+        return 1;
+    }
+
+    // Connect to the database and load the planets in the background, the window doesn't wait for it
+    std::unique_ptr<CatalogLoader> loader;
+    if (!replay.isOpen()) {
+        loader.reset(new CatalogLoader(connectionString, options.snapshotPath));
+    }
 
-    // Create a vector to store the planets
+    // Create a store for the state of all bodies and a vector of handles to the planets
+    BodyStore bodies;
     std::vector<Planet> planets;
 
-    // Load planets from the database
-    planets = db.loadPlanets();
+    // Profiler for the time of every phase of a frame
+    Profiler profiler;
 
+    // Create a pool of worker threads and a scheduler that updates the planets on them, parents before their moons
+    ThreadPool pool;
+    UpdateScheduler scheduler(pool);
+    std::unique_ptr<GravitySimulation> gravity; // Moves the bodies with their mutual gravity in the N-body mode, instead of the scheduler
+    if (options.nbody && options.ephemerisPath.empty() && !replay.isOpen()) {
+        gravity.reset(new GravitySimulation(pool, options));
+    }
+
+    // Table of the positions of the bodies, read instead of running their model
+    Ephemeris ephemeris;
+    if (!options.ephemerisPath.empty() && !replay.isOpen() && !ephemeris.open(options.ephemerisPath)) {
+        Log::stop();
+        return 1;
+    }
+
+    // Fit an ephemeris table from the model of all planets and stop
+    if (!options.ephemerisOutput.empty()) {
+        if (!loader) {
+            std::cerr << "An ephemeris is fitted from the planets of the catalog, not from a recording" << std::endl;
+            Log::stop();
+            return 1;
+        }
+        loader->wait(bodies, planets, pool);
+        if (loader->hasFailed()) {
+            Log::stop();
+            return 1;
+        }
+        int exitCode = runEphemerisBuild(options, bodies, scheduler, gravity.get(), pool);
+        Log::stop();
+        return exitCode;
+    }
 
-    // Set the orbiting planet for all planets except the sun
-        for (auto& planet : planets) {
-            if (planet.getName() != "Sun") {
-                planet.setOrbitingPlanet("Sun", planets);
+    // In headless mode, run the simulation without a window and stop
+    if (options.headless) {
+        // There is nothing to show while loading, so wait for all planets
+        if (loader) {
+            loader->wait(bodies, planets, pool);
+            profiler.addSample(ProfilePhase::DbLoad, loader->getLoadSeconds());
+            if (loader->hasFailed()) {
+                Log::stop();
+                return 1;
             }
         }
+        int exitCode = runHeadless(options, bodies, scheduler, gravity.get(), ephemeris.isOpen() ? &ephemeris : nullptr,
+                                   replay.isOpen() ? &replay : nullptr, recorder.isOpen() ? &recorder : nullptr, profiler);
+        if (recorder.isOpen() && !recorder.finish() && exitCode == 0) {
+            exitCode = 1;
+        }
+        if (!options.profileOutput.empty() && !profiler.exportStats(options.profileOutput)) {
+            std::cerr << "Can't write " << options.profileOutput << std::endl;
+        }
+        Log::stop();
+        return exitCode;
+    }
+
+    // Create a window with a resolution of 800x600 pixels -> 1600x1200 pixels(changed to see the whole solar system)
+    sf::RenderWindow window(sf::VideoMode(options.width, options.height), "Solar System Simulation");
+
+    BodyRenderer renderer; // Draws all planets with one draw call per texture
+    Camera camera(window.getSize(), options.zoom); // Center and zoom of the window, its center is the origin subtracted from the positions before drawing
+    std::string followName = options.follow; // Body to follow as soon as it is loaded
+    bool following = false; // Set while the camera moves with a body
+    bool recenter = false; // Set when the camera starts to follow a body: it jumps to the body first
+    BodyHandle followed; // The body the camera follows
+    sf::Vector2<double> followedAt; // Where that body was drawn in the last frame
+    bool dragging = false; // Set while the right or middle mouse button is held: the world moves with the mouse
+    sf::Vector2i dragFrom; // Mouse position of the last move of the drag
+    const float panSpeed = 800.0f; // Pixels per second of the arrow keys
+    OrbitTrails trails(options.trailMemory << 20); // Recent paths of the bodies, drawn behind them
+    trails.setShowAll(options.trails);
+    OrbitPaths orbitPaths; // Orbit of every body, drawn under the trails
+    bool showOrbits = options.orbits;
+    SpatialGrid grid; // Bodies sorted by position, kept up to date every frame: the renderer skips the bodies outside the view and a click finds the body under the mouse
+
+    // Frame-time overlay, toggled with F3. Without a font only the bars are drawn.
+    bool showOverlay = options.showOverlay;
+    sf::Font overlayFont;
+    bool hasOverlayFont = !options.overlayFont.empty() && overlayFont.loadFromFile(options.overlayFont);
 
     sf::Clock clock; // Create a clock to measure time
+    SimulationClock simulationClock(options.tickSeconds, options.maxTicksPerFrame); // Turns the frame time into fixed simulation ticks
+    simulationClock.setTimeWarp(options.timeWarp);
+    simulationClock.seek(options.startTime);
+    bool seeked = true; // Set when the simulated time jumps, so the stepped orbits start from the closed-form state
+    bool restartGravity = true; // Set when the simulated time jumps, so the N-body mode starts again from the scripted orbits
+    bool loading = loader != nullptr; // Set until the loader has added the last planet
+    double sessionSeconds = 0.0; // Wall-clock time since the first frame, the time of the frames of the recording
+    std::unique_ptr<CatalogListener> listener; // Applies the changes of the table, started once the catalog is loaded so no row is added twice
 
     // Main game loop
     while (window.isOpen()) {
+        auto frameStart = std::chrono::steady_clock::now(); // The Frame sample is added just before endFrame(), so it belongs to this frame
+
         // Event handling
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                window.close();
+        {
+            ScopedTimer timer(profiler, ProfilePhase::Events);
+            sf::Event event;
+            while (window.pollEvent(event)) {
+                if (event.type == sf::Event::Closed) {
+                    window.close();
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3) {
+                    showOverlay = !showOverlay;
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Period) {
+                    simulationClock.setTimeWarp(simulationClock.getTimeWarp() * 2.0); // Fast-forward
+                    LOG_INFO("Time warp: %gx", simulationClock.getTimeWarp());
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Comma) {
+                    simulationClock.setTimeWarp(simulationClock.getTimeWarp() / 2.0);
+                    LOG_INFO("Time warp: %gx", simulationClock.getTimeWarp());
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Home) {
+                    simulationClock.seek(0.0); // Jump back to the start
+                    seeked = true;
+                    restartGravity = true;
+                    trails.clear(); // The old paths would join the new positions with a long line
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::O) {
+                    showOrbits = !showOrbits;
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::T) {
+                    // Trail of the followed body, or of every body when none is followed
+                    int index = following ? bodies.resolve(followed) : -1;
+                    if (index >= 0) {
+                        bodies.setTrail(index, !bodies.trail[index]);
+                    } else {
+                        trails.setShowAll(!trails.isShowingAll());
+                    }
+                } else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
+                    // Print the data of the clicked body, found with the grid of the frame on the screen, and follow it
+                    int picked = grid.pick(bodies, camera.mapPixelToWorld(sf::Vector2i(event.mouseButton.x, event.mouseButton.y)));
+                    if (picked >= 0) {
+                        std::cout << "Name: " << bodies.name[picked] << ", Distance: " << bodies.distance[picked]
+                                  << ", Orbit speed: " << bodies.orbitSpeed[picked] << ", Rotation speed: " << bodies.rotationSpeed[picked]
+                                  << ", Position: (" << bodies.positionX[picked] << ", " << bodies.positionY[picked] << ")" << std::endl;
+                        followed = bodies.handleOf(picked);
+                        following = true;
+                        recenter = true;
+                    }
+                } else if (event.type == sf::Event::MouseButtonPressed && (event.mouseButton.button == sf::Mouse::Right || event.mouseButton.button == sf::Mouse::Middle)) {
+                    dragging = true;
+                    dragFrom = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+                } else if (event.type == sf::Event::MouseButtonReleased && (event.mouseButton.button == sf::Mouse::Right || event.mouseButton.button == sf::Mouse::Middle)) {
+                    dragging = false;
+                } else if (event.type == sf::Event::MouseMoved && dragging) {
+                    sf::Vector2i mouse(event.mouseMove.x, event.mouseMove.y);
+                    camera.pan(sf::Vector2f(static_cast<float>(mouse.x - dragFrom.x), static_cast<float>(mouse.y - dragFrom.y)));
+                    dragFrom = mouse;
+                } else if (event.type == sf::Event::MouseWheelScrolled && event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel) {
+                    // Zoom around the mouse, by 1.25 per notch of the wheel (touchpads send fractions of a notch)
+                    camera.zoomAt(std::pow(1.25, event.mouseWheelScroll.delta), sf::Vector2i(event.mouseWheelScroll.x, event.mouseWheelScroll.y));
+                } else if (event.type == sf::Event::KeyPressed && (event.key.code == sf::Keyboard::Add || event.key.code == sf::Keyboard::Equal)) {
+                    camera.zoomAt(2.0, sf::Vector2i(window.getSize().x / 2, window.getSize().y / 2));
+                } else if (event.type == sf::Event::KeyPressed && (event.key.code == sf::Keyboard::Subtract || event.key.code == sf::Keyboard::Hyphen)) {
+                    camera.zoomAt(0.5, sf::Vector2i(window.getSize().x / 2, window.getSize().y / 2));
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape) {
+                    following = false;
+                } else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::R) {
+                    camera.lookAt(sf::Vector2<double>(0.0, 0.0), options.zoom); // Back to the view of the start
+                    following = false;
+                } else if (event.type == sf::Event::Resized) {
+                    camera.setSize(sf::Vector2u(event.size.width, event.size.height)); // Show more of the world instead of stretching it
+                }
             }
         }
 
+        // Add the planets that arrived from the database since the last frame. The scheduler sorts the bodies again when the store changed.
+        if (loading) {
+            if (loader->poll(bodies, planets, pool) > 0) {
+                seeked = true; // The new bodies start from the closed-form state of the current time
+            }
+            if (loader->isFinished()) {
+                loading = false;
+                profiler.addSample(ProfilePhase::DbLoad, loader->getLoadSeconds());
+                LOG_INFO("Loaded %zu planets in %.3f s", planets.size(), loader->getLoadSeconds());
+                if (options.liveUpdates && !connectionString.empty()) {
+                    listener.reset(new CatalogListener(connectionString));
+                }
+            }
+        }
+
+        // Apply the rows changed in the database since the last frame
+        if (listener && listener->poll(bodies, planets, simulationClock.getSimulationTime()) > 0) {
+            seeked = true;
+            recorder.invalidateCatalog(); // A new radius, color or texture doesn't change the versions of the store
+        }
+
         float deltaTime = clock.restart().asSeconds(); // Restart the clock and get the elapsed time since the last frame in seconds
-        // Clear the window
-        window.clear();
+        sessionSeconds += deltaTime;
+
+        // Move the camera with the arrow keys, at the same speed on the screen whatever the zoom
+        if (window.hasFocus()) {
+            sf::Vector2f arrows(0.0f, 0.0f);
+            arrows.x += sf::Keyboard::isKeyPressed(sf::Keyboard::Left) ? panSpeed : 0.0f;
+            arrows.x -= sf::Keyboard::isKeyPressed(sf::Keyboard::Right) ? panSpeed : 0.0f;
+            arrows.y += sf::Keyboard::isKeyPressed(sf::Keyboard::Up) ? panSpeed : 0.0f;
+            arrows.y -= sf::Keyboard::isKeyPressed(sf::Keyboard::Down) ? panSpeed : 0.0f;
+            if (arrows.x != 0.0f || arrows.y != 0.0f) {
+                camera.pan(sf::Vector2f(arrows.x * deltaTime, arrows.y * deltaTime));
+            }
+        }
+
+        // Advance the simulated time by a whole number of fixed ticks
+        float alpha = 1.0f;
+        {
+            ScopedTimer timer(profiler, ProfilePhase::Update);
+            int ticks = simulationClock.advance(deltaTime);
+            float barrierSeconds = 0.0f;
+            bool scheduled = false; // Set when the scheduler ran in this frame, the barrier time is only meaningful then
+            if (replay.isOpen()) {
+                // Show the recorded frames around the time being rendered, the simulated time is the time of the recording
+                alpha = replay.seek(bodies, simulationClock.getSimulationTime() + simulationClock.getAlpha() * simulationClock.getTickSeconds());
+            } else if (ephemeris.isOpen()) {
+                // Look the positions up in the table at the time being rendered: the cost doesn't depend on the model the table was fitted from
+                scheduler.evaluateEphemeris(bodies, ephemeris, simulationClock.getSimulationTime() + simulationClock.getAlpha() * simulationClock.getTickSeconds());
+                barrierSeconds = scheduler.getStats().barrierSeconds;
+                scheduled = true;
+            } else if (gravity) {
+                // Integrate the gravity tick by tick, from the state before the ticks of this frame. Only a jump in time restarts from the
+                // scripted orbits: the bodies added by the loader or the listener join the running simulation (see GravitySimulation::step)
+                double tickSeconds = simulationClock.getTickSeconds();
+                if (restartGravity) {
+                    gravity->reset(bodies, simulationClock.getSimulationTime() - ticks * tickSeconds);
+                    bodies.savePreviousPositions();
+                    restartGravity = false;
+                }
+                for (int tick = 0; tick < ticks; ++tick) {
+                    if (tick == ticks - 1) {
+                        bodies.savePreviousPositions();
+                    }
+                    gravity->step(bodies, tickSeconds);
+                }
+                alpha = simulationClock.getAlpha();
+                LOG_DEBUG("N-body: %d ticks, tree %.2f ms, forces %.2f ms, %zu cells", ticks, gravity->getStats().buildSeconds * 1000.0f,
+                          gravity->getStats().forceSeconds * 1000.0f, gravity->getStats().nodes);
+            } else if (options.steppedOrbits) {
+                // Step the orbits tick by tick. Only the state before the last tick is needed to interpolate the rendering.
+                if (seeked) {
+                    scheduler.evaluateAt(bodies, simulationClock.getSimulationTime());
+                    bodies.savePreviousPositions();
+                }
+                float tickSeconds = static_cast<float>(simulationClock.getTickSeconds());
+                for (int tick = 0; tick < ticks; ++tick) {
+                    if (tick == ticks - 1) {
+                        bodies.savePreviousPositions();
+                    }
+                    scheduler.update(bodies, tickSeconds);
+                    barrierSeconds += scheduler.getStats().barrierSeconds;
+                    scheduled = true;
+                }
+                alpha = simulationClock.getAlpha();
+            } else {
+                // Evaluate the orbits in closed form directly at the time being rendered: the cost doesn't depend on the time warp and nothing drifts
+                scheduler.evaluateAt(bodies, simulationClock.getSimulationTime() + simulationClock.getAlpha() * simulationClock.getTickSeconds());
+                barrierSeconds = scheduler.getStats().barrierSeconds;
+                scheduled = true;
+            }
+            seeked = false;
+            if (scheduled) {
+                profiler.addSample(ProfilePhase::Barrier, barrierSeconds); // Time the main thread waited for the other threads
+            }
+            grid.update(bodies, pool); // Follow the new positions, the bodies are only sorted again when they have moved far enough
+            if (recorder.isOpen()) {
+                recorder.record(bodies, alpha, sessionSeconds); // The positions as they are drawn in this frame
+            }
+        }
 
-        // Update and draw each planet
-        for (auto& planet : planets) {
-            planet.update(deltaTime); // Update the planet's position with the actual delta time
-            planet.draw(window); // Draw the planet on the window
+        // Move the camera with the body it follows, by as much as the body moved since the last frame. A body named with --follow is followed once it is loaded
+        int named = followName.empty() ? -1 : bodies.findIndex(followName);
+        if (named >= 0) {
+            followed = bodies.handleOf(named);
+            following = true;
+            recenter = true;
+            followName.clear();
+        }
+        if (following) {
+            int index = bodies.resolve(followed);
+            if (index < 0) {
+                following = false; // The body was removed from the catalog, the camera stays where it is
+            } else {
+                sf::Vector2<double> position = bodies.interpolatedPosition(index, alpha);
+                camera.move(position - (recenter ? camera.getOrigin() : followedAt)); // The body stays where the user moved it on the screen
+                followedAt = position;
+                recenter = false;
+            }
+        }
+        camera.update(deltaTime);
+        trails.record(bodies, camera.getZoom());
+
+        // Clear the window and draw all planets
+        {
+            ScopedTimer timer(profiler, ProfilePhase::Draw);
+            window.clear();
+            window.setView(camera.getView());
+            if (showOrbits) {
+                orbitPaths.render(bodies, window, alpha, camera.getOrigin());
+            }
+            trails.render(bodies, window, alpha, camera.getOrigin()); // Under the bodies
+            renderer.render(bodies, window, alpha, &grid, camera.getOrigin());
+            if (showOverlay) {
+                profiler.drawOverlay(window, hasOverlayFont ? &overlayFont : nullptr);
+            }
         }
 
         // Display the window contents
-        window.display();
+        {
+            ScopedTimer timer(profiler, ProfilePhase::Display);
+            window.display();
+        }
+        profiler.addSample(ProfilePhase::Frame, std::chrono::duration<float>(std::chrono::steady_clock::now() - frameStart).count());
+        profiler.endFrame();
+    }
+
+    if (gravity) {
+        // How well the integrator kept the energy and the angular momentum since the last restart
+        EnergyReport energy = gravity->getEnergyReport();
+        std::cout << "N-body " << gravity->getIntegratorName() << ": largest energy drift " << energy.maxEnergyDrift
+                  << ", largest angular momentum drift " << energy.maxAngularMomentumDrift << " in " << energy.samples << " checks" << std::endl;
     }
 
+    if (recorder.isOpen()) {
+        recorder.finish();
+    }
+
+    // Write the frame-time statistics
+    if (!options.profileOutput.empty() && !profiler.exportStats(options.profileOutput)) {
+        std::cerr << "Can't write " << options.profileOutput << std::endl;
+    }
+    Log::stop(); // Write the remaining messages to the log file
     return 0;
 }
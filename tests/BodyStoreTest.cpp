@@ -0,0 +1,103 @@
+/**
+ * Purpose: Check the removal of bodies from the BodyStore: the children are attached to the parent of the removed body,
+ *  a name is found again when another body has it, and a Planet handle to a removed body changes nothing.
+ *  Also check that a change of speed while the simulation runs doesn't move or turn the body.
+ *
+ * */
+
+#include <cmath>
+#include <string>
+#include "Planet.hpp"
+#include "Test.hpp"
+
+// Function to add a body with only a name, the other values don't matter for these tests
+static std::size_t addNamed(BodyStore& bodies, const std::string& name) {
+    return bodies.addBody(name, 1.0f, 10.0f, 1.0f, 1.0f, sf::Color::White, sf::Vector2f(0.0f, 0.0f));
+}
+
+TEST_CASE(BodyStoreRemoveReparents) {
+    BodyStore bodies;
+    std::size_t sun = addNamed(bodies, "Sun");
+    std::size_t earth = addNamed(bodies, "Earth");
+    std::size_t moon = addNamed(bodies, "Moon");
+    std::size_t station = addNamed(bodies, "Station");
+    bodies.setParentByName(earth, "Sun");
+    bodies.setParentByName(moon, "Earth");
+    bodies.setParentByName(station, "Earth");
+
+    bodies.removeBody(earth);
+    CHECK(!bodies.isAlive(earth));
+    CHECK(bodies.parent[moon] == static_cast<int>(sun));
+    CHECK(bodies.parent[station] == static_cast<int>(sun));
+
+    // The moon and the station are now children of the Sun: removing it again moves them to the world origin
+    bodies.removeBody(sun);
+    CHECK(bodies.parent[moon] == -1);
+    CHECK(bodies.parent[station] == -1);
+
+    // A reused slot starts without children: its new child is the only one moved when it is removed
+    std::size_t planet = addNamed(bodies, "Planet");
+    bodies.setParentByName(moon, "Planet");
+    bodies.removeBody(planet);
+    CHECK(bodies.parent[moon] == -1);
+    CHECK(bodies.parent[station] == -1);
+}
+
+TEST_CASE(BodyStoreRemoveKeepsName) {
+    BodyStore bodies;
+    std::size_t first = addNamed(bodies, "Ceres");
+    std::size_t second = addNamed(bodies, "Ceres");
+    std::size_t third = addNamed(bodies, "Ceres");
+    CHECK(bodies.findIndex("Ceres") == static_cast<int>(first));
+
+    bodies.removeBody(second); // Not the indexed one: the name doesn't move
+    CHECK(bodies.findIndex("Ceres") == static_cast<int>(first));
+    bodies.removeBody(first);
+    CHECK(bodies.findIndex("Ceres") == static_cast<int>(third));
+    bodies.removeBody(third);
+    CHECK(bodies.findIndex("Ceres") == -1);
+}
+
+TEST_CASE(BodyStoreStalePlanet) {
+    BodyStore bodies;
+    std::size_t index = addNamed(bodies, "Vesta");
+    Planet vesta(bodies, index);
+    CHECK(vesta.isValid());
+    bodies.removeBody(index);
+    std::size_t reused = addNamed(bodies, "Pallas");
+    CHECK(reused == index); // The slot was given to another body
+
+    vesta.setRadius(42.0f);
+    vesta.setColor(sf::Color::Red);
+    vesta.setMass(5.0f);
+    vesta.setPosition(sf::Vector2<double>(7.0, 7.0));
+    CHECK(!vesta.isValid());
+    CHECK(bodies.radius[reused] == 1.0f);
+    CHECK(bodies.color[reused] == sf::Color::White);
+    CHECK(bodies.mass[reused] == 0.0f);
+    CHECK(bodies.positionX[reused] == 0.0);
+    CHECK(vesta.getName().empty());
+    CHECK(Planet(bodies, reused).getName() == "Pallas");
+}
+
+TEST_CASE(BodyStoreSpeedChangeKeepsPlace) {
+    BodyStore bodies;
+    std::size_t earth = addNamed(bodies, "Earth"); // Around the world origin, so only its own orbit moves it
+    bodies.setOrbitElements(earth, 0.3f, 0.2f, 1.0f, 0.5);
+    const double time = 1000.0; // Long after time 0: the phase must move by the change of speed times this
+
+    sf::Vector2<double> before = bodies.positionAt(earth, time);
+    Planet(bodies, earth).setOrbitSpeed(2.5f, time);
+    sf::Vector2<double> after = bodies.positionAt(earth, time);
+    CHECK(std::hypot(after.x - before.x, after.y - before.y) < 1e-9);
+
+    // From there the planet moves at the new speed: after a full period at 2.5 rad/s it is back at the same place
+    sf::Vector2<double> period = bodies.positionAt(earth, time + 6.283185307179586 / 2.5);
+    CHECK(std::hypot(period.x - before.x, period.y - before.y) < 1e-9);
+
+    bodies.evaluateAnglesAt(time, earth, earth + 1);
+    float turned = bodies.rotation[earth];
+    Planet(bodies, earth).setRotationSpeed(-7.0f, time);
+    bodies.evaluateAnglesAt(time, earth, earth + 1);
+    CHECK(std::abs(bodies.rotation[earth] - turned) < 1e-3f);
+}
@@ -0,0 +1,79 @@
+/**
+ * Purpose: Check the ephemeris: a table fitted from the scripted orbits (eccentric planets and fast moons) gives the positions of the
+ *  closed-form model within the tolerance of the fit, also at times between the samples of the fit, and a damaged table is refused.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "Ephemeris.hpp"
+#include "Test.hpp"
+#include "TestHelpers.hpp"
+
+static const double startTime = 5.0;
+static const double spanSeconds = 200.0;
+static const unsigned systemSeed = 7;
+
+// Function to fit a table of the system to a file, it returns false if the build failed
+static bool buildTable(const std::string& path, BodyStore& bodies, UpdateScheduler& scheduler, ThreadPool& pool, SimulationOptions& options) {
+    options.ephemerisOutput = path;
+    options.ephemerisSpan = spanSeconds;
+    options.ephemerisWindow = 4.0; // Short enough for the fastest planets at periapsis, see the warning of runEphemerisBuild
+    options.startTime = startTime;
+    return runEphemerisBuild(options, bodies, scheduler, nullptr, pool) == 0;
+}
+
+TEST_CASE(EphemerisFitWithinTolerance) {
+    ThreadPool pool;
+    UpdateScheduler scheduler(pool);
+    BodyStore bodies;
+    addRandomSystem(bodies, systemSeed, 200, 5); // Eccentric and inclined planets, a fast moon around every fifth one
+    SimulationOptions options;
+    std::string path = testFilePath("orbits.ephemeris");
+    CHECK(buildTable(path, bodies, scheduler, pool, options));
+
+    Ephemeris ephemeris;
+    CHECK(ephemeris.open(path));
+    CHECK(ephemeris.getBodyCount() == bodies.size());
+    CHECK(ephemeris.mapBodies(bodies));
+    if (ephemeris.isOpen()) {
+        // Random times, so most of them fall between the samples the table was fitted to
+        std::mt19937 random(11);
+        std::uniform_real_distribution<double> time(startTime, startTime + spanSeconds);
+        double worst = 0.0;
+        for (int k = 0; k < 200; ++k) {
+            double t = time(random);
+            scheduler.evaluateAt(bodies, t);
+            std::vector<double> x(bodies.positionX), y(bodies.positionY);
+            scheduler.evaluateEphemeris(bodies, ephemeris, t);
+            for (std::size_t i = 0; i < bodies.size(); ++i) {
+                worst = std::max(worst, std::hypot(x[i] - bodies.positionX[i], y[i] - bodies.positionY[i]));
+            }
+        }
+        std::printf("  largest error %g world units, tolerance %g\n", worst, options.ephemerisTolerance);
+        CHECK(worst <= options.ephemerisTolerance);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE(EphemerisRefusesDamagedFile) {
+    ThreadPool pool;
+    UpdateScheduler scheduler(pool);
+    BodyStore bodies;
+    addRandomSystem(bodies, systemSeed, 200, 5); // Eccentric and inclined planets, a fast moon around every fifth one
+    SimulationOptions options;
+    std::string path = testFilePath("damaged.ephemeris");
+    CHECK(buildTable(path, bodies, scheduler, pool, options));
+
+    std::vector<char> bytes = readTestFile(path);
+    CHECK(bytes.size() > 20);
+    if (bytes.size() > 20) {
+        bytes[20] = 0x7f; // High bytes of the number of bodies: the bodies no longer fit in the file
+        CHECK(!opensFile<Ephemeris>(path, bytes));
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,134 @@
+/**
+ * Purpose: Check that the symplectic integrators keep the energy of a two-body orbit: over many orbits its error must stay bounded
+ *  (the last orbits are no worse than the first ones) instead of drifting like with an Euler step.
+ *  The Kepler solver of wisdom-holman is also checked alone, on an eccentric ellipse and on a hyperbola.
+ *  The forces are the direct sum of BarnesHutTree, so the test doesn't depend on the opening angle of the tree.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "BarnesHutTree.hpp"
+#include "Integrator.hpp"
+#include "Test.hpp"
+
+static const double pi = 3.14159265358979323846;
+static const int orbits = 200;
+static const int stepsPerOrbit = 400;
+
+// Function to calculate the total energy of the two bodies, kinetic plus potential, without softening
+static double energy(const double* x, const double* y, const double* vx, const double* vy, const float* mass) {
+    double kinetic = 0.5 * mass[0] * (vx[0] * vx[0] + vy[0] * vy[0]) + 0.5 * mass[1] * (vx[1] * vx[1] + vy[1] * vy[1]);
+    return kinetic - mass[0] * mass[1] / std::hypot(x[1] - x[0], y[1] - y[0]);
+}
+
+/**
+ * This function runs an integrator on a star and a planet (mass ratio 1000, eccentricity 0.5, G = 1) and returns the largest relative
+ * error of the energy over the first ten and over the last ten orbits.
+ *
+ * */
+static void runTwoBody(const std::string& name, double& firstError, double& lastError) {
+    ThreadPool pool(1);
+    std::unique_ptr<Integrator> integrator = Integrator::create(name);
+    CHECK(integrator != nullptr);
+    if (!integrator) {
+        return;
+    }
+    const double eccentricity = 0.5;
+    const double semiMajorAxis = 1.0;
+    float mass[2] = {1.0f, 1e-3f};
+    double mu = mass[0] + mass[1];
+    // The planet starts at periapsis, the star moves so that the center of mass stays at rest
+    double distance = semiMajorAxis * (1.0 - eccentricity);
+    double speed = std::sqrt(mu * (1.0 + eccentricity) / distance);
+    double share = mass[1] / mu;
+    double x[2] = {-share * distance, (1.0 - share) * distance};
+    double y[2] = {0.0, 0.0};
+    double vx[2] = {0.0, 0.0};
+    double vy[2] = {-share * speed, (1.0 - share) * speed};
+    double ax[2], ay[2];
+
+    IntegratorState state;
+    state.x = x; state.y = y; state.vx = vx; state.vy = vy; state.ax = ax; state.ay = ay;
+    state.mass = mass;
+    state.count = 2;
+    AccelerationFunction accelerations = [&](const float* masses) {
+        BarnesHutTree::directAccelerations(x, y, masses, 2, 0, 2, ax, ay, 0.0f, 1.0, pool);
+    };
+
+    double period = 2.0 * pi * std::sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / mu);
+    double deltaTime = period / stepsPerOrbit;
+    double start = energy(x, y, vx, vy, mass);
+    firstError = 0.0;
+    lastError = 0.0;
+    for (int orbit = 0; orbit < orbits; ++orbit) {
+        for (int s = 0; s < stepsPerOrbit; ++s) {
+            integrator->step(state, deltaTime, accelerations, pool);
+            double error = std::abs(energy(x, y, vx, vy, mass) / start - 1.0);
+            if (orbit < 10) {
+                firstError = std::max(firstError, error);
+            } else if (orbit >= orbits - 10) {
+                lastError = std::max(lastError, error);
+            }
+        }
+    }
+    std::cout << "  " << name << ": energy error " << firstError << " in the first orbits, " << lastError << " in the last ones" << std::endl;
+}
+
+TEST_CASE(IntegratorLeapfrogEnergy) {
+    double firstError, lastError;
+    runTwoBody("leapfrog", firstError, lastError);
+    CHECK(firstError < 1e-3);
+    CHECK(lastError < 2.0 * firstError); // Bounded: no secular drift over 200 orbits
+}
+
+TEST_CASE(IntegratorYoshidaEnergy) {
+    double firstError, lastError;
+    runTwoBody("yoshida4", firstError, lastError);
+    CHECK(firstError < 1e-5); // Fourth order: hundreds of times smaller than leapfrog with the same step
+    CHECK(lastError < 2.0 * firstError + 1e-12); // Allow for the rounding of the energy itself
+}
+
+TEST_CASE(IntegratorWisdomHolmanEnergy) {
+    double firstError, lastError;
+    runTwoBody("wisdom-holman", firstError, lastError);
+    CHECK(firstError < 1e-8); // The two-body motion is solved exactly: only the rounding is left
+    CHECK(lastError < 2.0 * firstError + 1e-12);
+}
+
+/**
+ * keplerStep against the closed-form orbits around mu = 1: half a period of an ellipse of eccentricity 0.9 from periapsis ends at apoapsis
+ * (and ten more periods bring it back there), and a hyperbola of eccentricity 2 from periapsis reaches the point of eccentric anomaly H = 1 at t = (e sinh H - H) / n.
+ *
+ * */
+TEST_CASE(IntegratorKeplerStep) {
+    // Ellipse, a = 1: periapsis 0.1 and apoapsis 1.9, the period is 2 pi
+    double e = 0.9;
+    double x = 1.0 - e, y = 0.0, vx = 0.0, vy = std::sqrt((1.0 + e) / (1.0 - e));
+    CHECK(keplerStep(x, y, vx, vy, 1.0, pi));
+    double apoapsisSpeed = std::sqrt((1.0 - e) / (1.0 + e));
+    std::cout << "  ellipse: position error " << std::hypot(x + 1.0 + e, y) << ", velocity error " << std::hypot(vx, vy + apoapsisSpeed) << std::endl;
+    CHECK(std::hypot(x + 1.0 + e, y) < 1e-9);
+    CHECK(std::hypot(vx, vy + apoapsisSpeed) < 1e-9);
+    CHECK(keplerStep(x, y, vx, vy, 1.0, 20.0 * pi)); // Ten periods in one step: back at apoapsis
+    CHECK(std::hypot(x + 1.0 + e, y) < 1e-9);
+
+    // Hyperbola, |a| = 1: r = e cosh(H) - 1, x = e - cosh(H), y = sqrt(e^2 - 1) sinh(H), and dH/dt = n / r with n = 1
+    e = 2.0;
+    x = e - 1.0;
+    y = 0.0;
+    vx = 0.0;
+    vy = std::sqrt((e + 1.0) / (e - 1.0));
+    double H = 1.0;
+    CHECK(keplerStep(x, y, vx, vy, 1.0, e * std::sinh(H) - H));
+    double rate = 1.0 / (e * std::cosh(H) - 1.0);
+    double expectedX = e - std::cosh(H), expectedY = std::sqrt(e * e - 1.0) * std::sinh(H);
+    double expectedVX = -std::sinh(H) * rate, expectedVY = std::sqrt(e * e - 1.0) * std::cosh(H) * rate;
+    std::cout << "  hyperbola: position error " << std::hypot(x - expectedX, y - expectedY) << ", velocity error "
+              << std::hypot(vx - expectedVX, vy - expectedVY) << std::endl;
+    CHECK(std::hypot(x - expectedX, y - expectedY) < 1e-9);
+    CHECK(std::hypot(vx - expectedVX, vy - expectedVY) < 1e-9);
+}
@@ -0,0 +1,102 @@
+/**
+ * Purpose: Check every instruction set of the orbit kernel (avx2, sse2, scalar) against std::cos and std::sin,
+ *  within the bound documented in OrbitKernel.hpp: orbitKernelTolerance * distance.
+ *  The counts aren't multiples of 8, so the scalar tail of the SIMD loops is checked too.
+ *
+ * */
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "OrbitKernel.hpp"
+#include "Test.hpp"
+
+static const char* kernelNames[] = {"avx2", "sse2", "scalar"};
+static const std::size_t bodyCount = 1003;
+static const double pi = 3.14159265358979323846;
+
+// Function to solve Kepler's equation in double precision, the reference of the float solver
+static double eccentricAnomaly(double meanAnomaly, double eccentricity) {
+    double anomaly = eccentricity > 0.8 ? pi * (meanAnomaly < 0 ? -1 : 1) : meanAnomaly;
+    for (int k = 0; k < 100; ++k) {
+        anomaly -= (anomaly - eccentricity * std::sin(anomaly) - meanAnomaly) / (1.0 - eccentricity * std::cos(anomaly));
+    }
+    return anomaly;
+}
+
+TEST_CASE(OrbitKernelCircles) {
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::string selected = orbitKernelName(); // Used again at the end, for the other tests
+    for (const char* name : kernelNames) {
+        if (!selectOrbitKernel(name)) {
+            std::cout << "  " << name << " isn't supported by this processor, skipped" << std::endl;
+            continue;
+        }
+        std::vector<float> angle(bodyCount), speed(bodyCount), distance(bodyCount), x(bodyCount), y(bodyCount);
+        for (std::size_t i = 0; i < bodyCount; ++i) {
+            angle[i] = static_cast<float>((2.0 * unit(random) - 1.0) * pi);
+            speed[i] = 10.0f * unit(random) - 5.0f;
+            distance[i] = 1.0f + 5000.0f * unit(random);
+        }
+        std::vector<float> start(angle);
+        float deltaTime = 1.0f / 60.0f;
+        propagateOrbits(angle.data(), speed.data(), distance.data(), x.data(), y.data(), bodyCount, deltaTime);
+
+        double worst = 0.0;
+        for (std::size_t i = 0; i < bodyCount; ++i) {
+            double expected = static_cast<double>(start[i]) + static_cast<double>(speed[i]) * deltaTime; // The angle the per-planet path would use
+            double bound = orbitKernelTolerance * distance[i];
+            double error = std::max(std::fabs(x[i] - distance[i] * std::cos(expected)), std::fabs(y[i] - distance[i] * std::sin(expected)));
+            worst = std::max(worst, error / distance[i]);
+            CHECK(error <= bound);
+            CHECK(std::fabs(angle[i]) <= pi + 1e-6); // Wrapped
+        }
+        std::cout << "  " << name << ": largest error of the circles " << worst << " x distance" << std::endl;
+    }
+    selectOrbitKernel(selected);
+}
+
+TEST_CASE(OrbitKernelEllipses) {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::string selected = orbitKernelName(); // Used again at the end, for the other tests
+    for (const char* name : kernelNames) {
+        if (!selectOrbitKernel(name)) {
+            continue;
+        }
+        std::vector<float> anomaly(bodyCount), eccentricity(bodyCount), distance(bodyCount);
+        std::vector<float> px(bodyCount), py(bodyCount), qx(bodyCount), qy(bodyCount), x(bodyCount), y(bodyCount);
+        for (std::size_t i = 0; i < bodyCount; ++i) {
+            anomaly[i] = static_cast<float>((2.0 * unit(random) - 1.0) * pi);
+            eccentricity[i] = maxEccentricity * unit(random);
+            distance[i] = 1.0f + 5000.0f * unit(random);
+            // Axes of an orbit seen face-on and turned by w, see BodyStore::setOrbitElements
+            double w = 2.0 * pi * unit(random);
+            double b = std::sqrt(1.0 - static_cast<double>(eccentricity[i]) * eccentricity[i]);
+            px[i] = static_cast<float>(std::cos(w));
+            py[i] = static_cast<float>(std::sin(w));
+            qx[i] = static_cast<float>(-b * std::sin(w));
+            qy[i] = static_cast<float>(b * std::cos(w));
+        }
+        solveKeplerOrbits(anomaly.data(), eccentricity.data(), distance.data(), px.data(), py.data(), qx.data(), qy.data(),
+                          x.data(), y.data(), bodyCount);
+
+        double worst = 0.0;
+        for (std::size_t i = 0; i < bodyCount; ++i) {
+            double e = eccentricity[i];
+            double anomalyE = eccentricAnomaly(anomaly[i], e);
+            double planeX = distance[i] * (std::cos(anomalyE) - e);
+            double planeY = distance[i] * std::sin(anomalyE);
+            double expectedX = planeX * px[i] + planeY * qx[i];
+            double expectedY = planeX * py[i] + planeY * qy[i];
+            double error = std::max(std::fabs(x[i] - expectedX), std::fabs(y[i] - expectedY));
+            worst = std::max(worst, error / distance[i]);
+            CHECK(error <= orbitKernelTolerance * distance[i]);
+        }
+        std::cout << "  " << name << ": largest error of the ellipses " << worst << " x distance" << std::endl;
+    }
+    selectOrbitKernel(selected);
+}
@@ -0,0 +1,76 @@
+/**
+ * Purpose: Check the cache of the orbit paths: a group of orbits is built once, and built again only when one of its orbits changes,
+ *  not when nothing changed or when its parent only moved, and a group culled outside the view is drawn once its orbits grow into it.
+ *  The paths are drawn into an off-screen texture, so the tests are skipped when no OpenGL context can be created (a build machine without a display).
+ *
+ * */
+
+#include <iostream>
+#include "OrbitPaths.hpp"
+#include "Test.hpp"
+
+TEST_CASE(OrbitPathsRebuildOnlyChanged) {
+    sf::RenderTexture target;
+    if (!target.create(512, 512)) {
+        std::cout << "  no OpenGL context to draw into, skipped" << std::endl;
+        return;
+    }
+    target.setView(sf::View(sf::Vector2f(0.0f, 0.0f), sf::Vector2f(512.0f, 512.0f))); // One pixel per world unit, the origin in the middle
+
+    // Two planets around a sun and two moons around the first planet: two groups of orbits, all inside the view
+    BodyStore bodies;
+    std::size_t sun = bodies.addBody("Sun", 10.0f, 0.0f, 0.0f, 0.0f, sf::Color(), sf::Vector2f());
+    std::size_t first = bodies.addBody("First", 2.0f, 1000.0f, 1.0f, 0.0f, sf::Color(), sf::Vector2f());
+    std::size_t second = bodies.addBody("Second", 2.0f, 2000.0f, 0.5f, 0.0f, sf::Color(), sf::Vector2f());
+    std::size_t moon = bodies.addBody("Moon", 1.0f, 300.0f, 3.0f, 0.0f, sf::Color(), sf::Vector2f());
+    std::size_t station = bodies.addBody("Station", 1.0f, 200.0f, 5.0f, 0.0f, sf::Color(), sf::Vector2f());
+    bodies.setParent(first, static_cast<int>(sun));
+    bodies.setParent(second, static_cast<int>(sun));
+    bodies.setParent(moon, static_cast<int>(first));
+    bodies.setParent(station, static_cast<int>(first));
+
+    OrbitPaths paths;
+    paths.render(bodies, target, 1.0f, sf::Vector2<double>());
+    CHECK(paths.getBuildCount() == 2);
+    CHECK(paths.getDrawCallCount() == 2);
+
+    paths.render(bodies, target, 1.0f, sf::Vector2<double>());
+    CHECK(paths.getBuildCount() == 2); // Nothing changed
+
+    bodies.positionX[first] = bodies.previousX[first] = 50.0; // The moons' orbits move with their parent, they don't change
+    paths.render(bodies, target, 1.0f, sf::Vector2<double>());
+    CHECK(paths.getBuildCount() == 2);
+
+    bodies.setDistance(moon, 40.0f); // Only the group of the moons
+    paths.render(bodies, target, 1.0f, sf::Vector2<double>());
+    CHECK(paths.getBuildCount() == 3);
+
+    bodies.setOrbitElements(second, 0.3f, 0.2f, 1.0f, 0.0); // Only the group of the planets
+    paths.render(bodies, target, 1.0f, sf::Vector2<double>());
+    CHECK(paths.getBuildCount() == 4);
+}
+
+TEST_CASE(OrbitPathsCullFollowsOrbits) {
+    sf::RenderTexture target;
+    if (!target.create(512, 512)) {
+        std::cout << "  no OpenGL context to draw into, skipped" << std::endl;
+        return;
+    }
+    target.setView(sf::View(sf::Vector2f(0.0f, 0.0f), sf::Vector2f(512.0f, 512.0f)));
+
+    // A planet far outside the view with a small moon: the group of the moon is culled and never built
+    BodyStore bodies;
+    std::size_t planet = bodies.addBody("Far", 2.0f, 0.0f, 0.0f, 0.0f, sf::Color(), sf::Vector2f());
+    std::size_t moon = bodies.addBody("Moon", 1.0f, 10.0f, 1.0f, 0.0f, sf::Color(), sf::Vector2f());
+    bodies.setParent(moon, static_cast<int>(planet));
+    bodies.positionX[planet] = bodies.previousX[planet] = 3000.0;
+
+    OrbitPaths paths;
+    paths.render(bodies, target, 1.0f, sf::Vector2<double>());
+    CHECK(paths.getBuildCount() == 0);
+
+    bodies.setDistance(moon, 3000.0f); // The orbit now crosses the view: the group must no longer be culled by its old reach
+    paths.render(bodies, target, 1.0f, sf::Vector2<double>());
+    CHECK(paths.getBuildCount() == 1);
+    CHECK(paths.getDrawCallCount() == 1);
+}
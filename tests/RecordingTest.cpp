@@ -0,0 +1,125 @@
+/**
+ * Purpose: Check the recording of a session: every frame played back is within half a quantization step of what was recorded,
+ *  in order and after random seeks, across added and removed bodies, and a damaged or cut short recording is refused.
+ *
+ * */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "Recording.hpp"
+#include "UpdateScheduler.hpp"
+#include "Test.hpp"
+#include "TestHelpers.hpp"
+
+static const double step = 1e-3; // Quantization step of the positions, in world units
+static const int frameCount = 300;
+static const double frameSeconds = 1.0 / 60;
+
+// Positions of the living bodies of every recorded frame, in the order of their slots
+struct RecordedFrames {
+    std::vector<double> time;
+    std::vector<std::vector<double>> x, y;
+};
+
+/**
+ * This function records a session of a sun, 300 planets on eccentric orbits and some moons. A body is added at frame 100
+ * and one is removed at frame 200, so the replay has to load other catalogs; the time jumps ahead at frame 150.
+ *
+ * */
+static bool recordSession(const std::string& path, RecordedFrames& frames) {
+    ThreadPool pool;
+    UpdateScheduler scheduler(pool);
+    BodyStore bodies;
+    std::size_t sun = addRandomSystem(bodies, 3, 300, 10); // A moon around every tenth planet
+
+    Recorder recorder;
+    if (!recorder.open(path, step, 30)) {
+        return false;
+    }
+    for (int f = 0; f < frameCount; ++f) {
+        double time = f * frameSeconds + (f >= 150 ? 2.0 : 0.0);
+        if (f == 100) {
+            std::size_t late = bodies.addBody("Late", 2.0f, 500.0f, 1.0f, 0.0f, sf::Color(), sf::Vector2f());
+            bodies.setParent(late, static_cast<int>(sun));
+        }
+        if (f == 200) {
+            bodies.removeBody(static_cast<std::size_t>(bodies.findIndex("Planet 7")));
+        }
+        scheduler.evaluateAt(bodies, time);
+        recorder.record(bodies, 1.0f, time);
+        frames.time.push_back(time);
+        frames.x.emplace_back();
+        frames.y.emplace_back();
+        for (std::size_t i = 0; i < bodies.size(); ++i) {
+            if (bodies.isAlive(i)) {
+                frames.x.back().push_back(bodies.positionX[i]);
+                frames.y.back().push_back(bodies.positionY[i]);
+            }
+        }
+    }
+    return recorder.finish();
+}
+
+// Function to seek to a recorded frame and return the largest difference from it, or infinity if the bodies don't match
+static double frameError(Replay& replay, BodyStore& bodies, const RecordedFrames& frames, int f) {
+    float alpha = replay.seek(bodies, frames.time[f]);
+    std::size_t entry = 0;
+    double worst = 0.0;
+    for (std::size_t i = 0; i < bodies.size(); ++i) {
+        if (!bodies.isAlive(i)) {
+            continue;
+        }
+        if (entry >= frames.x[f].size()) {
+            return INFINITY;
+        }
+        sf::Vector2<double> position = bodies.interpolatedPosition(i, alpha);
+        worst = std::max({worst, std::abs(position.x - frames.x[f][entry]), std::abs(position.y - frames.y[f][entry])});
+        ++entry;
+    }
+    return entry == frames.x[f].size() ? worst : INFINITY;
+}
+
+TEST_CASE(RecordingReplayWithinHalfStep) {
+    std::string path = testFilePath("session.recording");
+    RecordedFrames frames;
+    CHECK(recordSession(path, frames));
+
+    Replay replay;
+    CHECK(replay.open(path));
+    if (replay.isOpen()) {
+        CHECK(replay.getFrameCount() == static_cast<std::size_t>(frameCount));
+        BodyStore bodies;
+        double worst = 0.0;
+        for (int f = 0; f < frameCount; ++f) {
+            worst = std::max(worst, frameError(replay, bodies, frames, f));
+        }
+        std::mt19937 random(5);
+        std::uniform_int_distribution<int> frame(0, frameCount - 1);
+        for (int k = 0; k < 200; ++k) { // Backwards and across keyframes and catalogs
+            worst = std::max(worst, frameError(replay, bodies, frames, frame(random)));
+        }
+        std::printf("  largest error %g world units, step %g\n", worst, step);
+        CHECK(worst <= step / 2 * (1.0 + 1e-6)); // Rounded to the nearest step, up to the rounding of the doubles themselves
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE(RecordingRefusesDamagedFile) {
+    std::string path = testFilePath("damaged.recording");
+    RecordedFrames frames;
+    CHECK(recordSession(path, frames));
+    std::vector<char> bytes = readTestFile(path);
+    CHECK(bytes.size() > 48);
+    if (bytes.size() > 48) {
+        std::vector<char> damaged = bytes;
+        damaged[40 + 7] = 0x7f; // Position of the keyframe index moved past the end of the file
+        CHECK(!opensFile<Replay>(path, damaged));
+        bytes.resize(bytes.size() - 16); // Cut short: the keyframe index is missing
+        CHECK(!opensFile<Replay>(path, bytes));
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,83 @@
+/**
+ * Purpose: Check the catalog snapshot: every field of every record written by SnapshotWriter is read back unchanged by CatalogSnapshot,
+ *  and a file that was cut short or written by another version is refused instead of being read.
+ *
+ * */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "CatalogSnapshot.hpp"
+#include "Test.hpp"
+#include "TestHelpers.hpp"
+
+static const std::size_t recordCount = 1000;
+static const std::uint64_t fingerprint = 0x0123456789ABCDEFull;
+
+// Function to make a record whose fields all depend on its index, so a record read at the wrong place doesn't match
+static PlanetRecord makeRecord(std::size_t i) {
+    PlanetRecord record;
+    record.name = "Body " + std::to_string(i);
+    record.radius = 0.5f + i * 0.25f;
+    record.distance = 10.0f * i;
+    record.orbitSpeed = 1.0f / (i + 1);
+    record.rotationSpeed = -0.125f * i;
+    record.color = sf::Color(static_cast<sf::Uint8>(i), static_cast<sf::Uint8>(i * 7), static_cast<sf::Uint8>(i * 13));
+    record.position = sf::Vector2f(400.0f + i, 300.0f - i);
+    record.eccentricity = (i % 10) * 0.09f;
+    record.inclination = (i % 7) * 0.1f;
+    record.periapsisArgument = (i % 5) * 1.2f;
+    record.meanAnomaly = i * 0.001234567890123;
+    record.parentName = i % 3 == 0 ? std::string() : "Body " + std::to_string(i / 3); // Empty strings too
+    record.texturePath = i % 4 == 0 ? "textures/rock" + std::to_string(i % 16) + ".png" : std::string();
+    record.mass = i % 2 == 0 ? 0.0f : 1e-6f * i;
+    return record;
+}
+
+static bool sameRecord(const PlanetRecord& a, const PlanetRecord& b) {
+    return a.name == b.name && a.radius == b.radius && a.distance == b.distance && a.orbitSpeed == b.orbitSpeed
+        && a.rotationSpeed == b.rotationSpeed && a.color == b.color && a.position == b.position && a.eccentricity == b.eccentricity
+        && a.inclination == b.inclination && a.periapsisArgument == b.periapsisArgument && a.meanAnomaly == b.meanAnomaly
+        && a.parentName == b.parentName && a.texturePath == b.texturePath && a.mass == b.mass;
+}
+
+// Function to write the test snapshot, it returns false if the writer failed
+static bool writeSnapshot(const std::string& path) {
+    SnapshotWriter writer(path);
+    for (std::size_t i = 0; i < recordCount; ++i) {
+        writer.add(makeRecord(i));
+    }
+    return writer.finish(fingerprint);
+}
+
+TEST_CASE(SnapshotRoundTrip) {
+    std::string path = testFilePath("catalog.snapshot");
+    CHECK(writeSnapshot(path));
+    {
+        CatalogSnapshot snapshot;
+        CHECK(snapshot.open(path));
+        CHECK(snapshot.size() == recordCount);
+        CHECK(snapshot.getFingerprint() == fingerprint);
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < snapshot.size(); ++i) {
+            mismatches += !sameRecord(snapshot.record(i), makeRecord(i));
+        }
+        CHECK(mismatches == 0);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE(SnapshotRefusesDamagedFile) {
+    std::string path = testFilePath("damaged.snapshot");
+    CHECK(writeSnapshot(path));
+    std::vector<char> bytes = readTestFile(path);
+    CHECK(bytes.size() > 8);
+    if (bytes.size() > 8) {
+        std::vector<char> otherVersion = bytes;
+        otherVersion[8] = static_cast<char>(otherVersion[8] + 1); // Written by another version of the format
+        CHECK(!opensFile<CatalogSnapshot>(path, otherVersion));
+        bytes.resize(bytes.size() / 2); // Cut short in the middle of the records
+        CHECK(!opensFile<CatalogSnapshot>(path, bytes));
+    }
+    std::remove(path.c_str());
+}
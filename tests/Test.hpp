@@ -0,0 +1,32 @@
+/**
+ * This file declares the small test framework of the project: a test is a function registered by name with TEST_CASE,
+ * and CHECK records a failure without stopping the test, so one run shows every broken check.
+ * The tests are built into one program (SolarSystemTests) and CTest runs every test by name, see CMakeLists.txt.
+ *
+ */
+
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <string>
+
+typedef void (*TestFunction)();
+
+// Object whose constructor adds a test to the list of the program, created by TEST_CASE before main starts
+struct TestRegistration {
+    TestRegistration(const char* name, TestFunction function);
+};
+
+// Function to record the result of a check, it prints the failed ones
+void checkCondition(bool condition, const char* expression, const char* file, int line);
+// Function to get the path of a temporary file for a test, in the directory the tests run in
+std::string testFilePath(const std::string& name);
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestRegistration name##Registration(#name, name); \
+    static void name()
+
+#define CHECK(condition) checkCondition((condition), #condition, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Purpose: Implement the fixtures shared by the tests, declared in TestHelpers.hpp.
+ *
+ * */
+
+#include <fstream>
+#include <iterator>
+#include <random>
+#include "TestHelpers.hpp"
+
+/**
+ * This function adds the system: planets between 100 and 700 world units from the sun (the distances of addBody are scaled down by 10),
+ * with orbit speeds from 0.05 to 0.55 rad/s, eccentricities up to 0.6 and any inclination, periapsis and starting point;
+ * the moons are close to their planet and fast, 3 rad/s.
+ *
+ * */
+std::size_t addRandomSystem(BodyStore& bodies, unsigned seed, int planetCount, int moonEvery) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::size_t sun = bodies.addBody("Sun", 10.0f, 0.0f, 0.0f, 5.0f, sf::Color(), sf::Vector2f());
+    for (int i = 0; i < planetCount; ++i) {
+        std::size_t planet = bodies.addBody("Planet " + std::to_string(i), 1.0f, static_cast<float>(1000.0 + 6000.0 * unit(random)),
+                                            static_cast<float>(0.05 + 0.5 * unit(random)), 30.0f, sf::Color(), sf::Vector2f());
+        bodies.setParent(planet, static_cast<int>(sun));
+        bodies.setOrbitElements(planet, static_cast<float>(0.6 * unit(random)), static_cast<float>(unit(random)),
+                                static_cast<float>(6.0 * unit(random)), 6.0 * unit(random));
+        if (i % moonEvery == 0) {
+            std::size_t moon = bodies.addBody("Moon " + std::to_string(i), 0.5f, 40.0f, 3.0f, 0.0f, sf::Color(), sf::Vector2f());
+            bodies.setParent(moon, static_cast<int>(planet));
+        }
+    }
+    return sun;
+}
+
+std::vector<char> readTestFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeTestFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
@@ -0,0 +1,30 @@
+/**
+ * This file declares the fixtures shared by the tests: a random system of bodies on eccentric orbits, and the reading and writing
+ * of the bytes of a test file, used to check that the readers of the binary formats refuse a damaged file.
+ *
+ */
+
+#ifndef TESTHELPERS_HPP
+#define TESTHELPERS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "BodyStore.hpp"
+
+// Function to add a sun, planets on random eccentric and inclined orbits around it, and a moon around every moonEvery-th planet.
+// The same seed gives the same system. It returns the index of the sun
+std::size_t addRandomSystem(BodyStore& bodies, unsigned seed, int planetCount, int moonEvery);
+
+std::vector<char> readTestFile(const std::string& path); // Function to read all the bytes of a file
+void writeTestFile(const std::string& path, const std::vector<char>& bytes); // Function to replace a file with bytes
+
+// Function to replace a file with bytes and tell if a new Reader (CatalogSnapshot, Ephemeris, Replay) accepts it
+template <typename Reader>
+bool opensFile(const std::string& path, const std::vector<char>& bytes) {
+    writeTestFile(path, bytes);
+    Reader reader;
+    return reader.open(path);
+}
+
+#endif
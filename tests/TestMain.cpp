@@ -0,0 +1,63 @@
+/**
+ * Purpose: Run the tests registered with TEST_CASE (see Test.hpp).
+ *  Without arguments every test runs; with names only those run, which is how CTest calls them one by one.
+ *  The exit code is 0 if every check passed, 1 otherwise.
+ *
+ * */
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Test.hpp"
+
+// One registered test
+struct RegisteredTest {
+    const char* name;
+    TestFunction function;
+};
+
+// List of the tests, created on first use because the registrations run before main in any order
+static std::vector<RegisteredTest>& registeredTests() {
+    static std::vector<RegisteredTest> tests;
+    return tests;
+}
+
+static int failedChecks = 0;
+
+TestRegistration::TestRegistration(const char* name, TestFunction function) {
+    registeredTests().push_back(RegisteredTest{name, function});
+}
+
+void checkCondition(bool condition, const char* expression, const char* file, int line) {
+    if (!condition) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+        ++failedChecks;
+    }
+}
+
+std::string testFilePath(const std::string& name) {
+    return "solar_test_" + name;
+}
+
+int main(int argc, char* argv[]) {
+    int run = 0;
+    for (const RegisteredTest& test : registeredTests()) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || test.name == std::string(argv[i]);
+        }
+        if (!selected) {
+            continue;
+        }
+        int failedBefore = failedChecks;
+        test.function();
+        std::cout << (failedChecks == failedBefore ? "passed: " : "FAILED: ") << test.name << std::endl;
+        ++run;
+    }
+    if (run == 0) {
+        std::cerr << "No test to run" << std::endl;
+        return 1;
+    }
+    return failedChecks == 0 ? 0 : 1;
+}